@@ -319,6 +319,18 @@ enum ClientErrors_enum {
     //      These error codes are for use by the client to allow general
     //      error information to be sent to the server for analysis.
 
+    ERROR_RFID_TAG_POOL                 = 0xFE01,
+    // Description:
+    //      RFID tag pool exhausted, tags were not tracked
+    // Payload:
+    //      0:2 - This error code
+    //      2:4 - the time the pool was first found exhausted
+    //      6:4 - the number of tag reads dropped since the last report
+    // Notes:
+    //      Sent to the server when new tags could not be tracked because the
+    //      tag pool ceiling and the role quota (PROP_RFID_TAG_POOL) were
+    //      reached, and no unadmitted tag of the role could be evicted.
+
 };
 typedef enum ClientErrors_enum ClientError_t;
 
@@ -29,6 +29,9 @@ extern "C" {
 
 #define FLETCHER_CHECKSUM_LENGTH 2 // fixed length [NOT "sizeof(ChecksumFletcher_t)"]
 
+#define CRC8_INIT           0xFF
+#define CRC16_INIT          0xFFFF
+
 typedef UInt8   ChecksumXOR_t;
 
 typedef struct {
@@ -54,6 +57,14 @@ void cksumCalcFletcher(const UInt8 *buf, int bufLen);
 utBool _cksumEqualsFletcher(ChecksumFletcher_t *fcsv, ChecksumFletcher_t *fcst);
 utBool cksumEqualsFletcher(ChecksumFletcher_t *fcst);
 
+UInt8 _cksumCalcCRC8(UInt8 crc, const UInt8 *buf, int bufLen);
+UInt8 cksumCalcCRC8(const UInt8 *buf, int bufLen);
+
+UInt16 _cksumCalcCRC16(UInt16 crc, const UInt8 *buf, int bufLen);
+UInt16 cksumCalcCRC16(const UInt8 *buf, int bufLen);
+
+utBool cksumSelfTest();
+
 // ----------------------------------------------------------------------------
 
 #ifdef __cplusplus
@@ -32,6 +32,13 @@
 //  2007/04/28  Martin D. Flynn
 //     -Changed to 'back-date' arrival/departure point to actual point of 
 //      arrival/departure.
+//  2026/10/18
+//     -Added support for 'GEOF_SWEPT_POINT_RADIUS' zones.
+//     -The path travelled between the previous and the new fix is now checked
+//      against the zone table, so that a zone passed through entirely between
+//      two fixes still generates an arrival/departure pair.
+//     -Added a per-zone bounding box table used to skip zones which cannot
+//      contain the point (or path) being checked.
 // ----------------------------------------------------------------------------
 #if defined (ENABLE_GEOZONE)
 #include "defaults.h"
@@ -40,6 +47,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
 
 #include "startup.h"
 #include "log.h"
@@ -89,6 +97,22 @@
 
 // ----------------------------------------------------------------------------
 
+// approximate number of meters in one degree of latitude
+#define METERS_PER_DEGREE           (EARTH_RADIUS_METERS * RADIANS)
+
+// Bounding box of a zone (in degrees, including the zone radius).
+// A box is kept for each entry in 'geoZoneList' and is used to quickly discard
+// zones which cannot contain the point, or path, being checked.
+typedef struct
+{
+    float               latMin;
+    float               latMax;
+    float               lonMin;
+    float               lonMax;
+} GeoZoneBounds_t;
+
+// ----------------------------------------------------------------------------
+
 #ifdef PROTOCOL_THREAD
 #include "threads.h"
 static threadMutex_t                geozMutex;
@@ -104,6 +128,7 @@ static threadMutex_t                geozMutex;
 static utBool           didInitialize   = utFalse;
 
 static GeoZone_t        geoZoneList[MAX_GEOZONES];
+static GeoZoneBounds_t  geoZoneBounds[MAX_GEOZONES];
 static UInt16           maxZones        = MAX_GEOZONES;
 static UInt16           usedZones       = 0;
 static utBool           geozIsDirty     = utFalse;
@@ -140,6 +165,66 @@ const char *geozGetVersion()
 
 // ----------------------------------------------------------------------------
 
+/* return a fix located at fraction 't' of the path from 'oldFix' to 'newFix' */
+static GPS_t *_geozInterpolateFix(GPS_t *gps, const GPS_t *oldFix, const GPS_t *newFix, double t)
+{
+    gpsCopy(gps, newFix);
+    gps->point.latitude  = oldFix->point.latitude  + t * (newFix->point.latitude  - oldFix->point.latitude);
+    gps->point.longitude = oldFix->point.longitude + t * (newFix->point.longitude - oldFix->point.longitude);
+    gps->fixtime = oldFix->fixtime + (time_t)(t * (double)(newFix->fixtime - oldFix->fixtime));
+    return gps;
+}
+
+/* check the path travelled between two fixes for a zone passed through */
+// Called only when both 'oldFix' and 'newFix' are outside of all zones.
+// Returns true if an arrival has been queued.  The matching departure is
+// either queued immediately, or left pending in 'departPoint' if a departure
+// delay is in effect.
+static utBool _geozCheckPath(const GPS_t *oldFix, const GPS_t *newFix)
+{
+    double tIn = 0.0, tOut = 0.0;
+
+    /* a valid path is required */
+    if (!gpsPointIsValid(&(oldFix->point)) || (oldFix->fixtime > newFix->fixtime)) {
+        return utFalse;
+    }
+
+    /* find first zone crossed */
+    GeoZone_t *crossZone = geozCrossedZone(&(oldFix->point), &(newFix->point), &tIn, &tOut);
+    if (!crossZone) {
+        return utFalse;
+    }
+    GeoZoneID_t zoneID = crossZone->zoneID;
+    GPS_t arriveFix, departFix;
+    _geozInterpolateFix(&arriveFix, oldFix, newFix, tIn);
+    _geozInterpolateFix(&departFix, oldFix, newFix, tOut);
+
+    /* check 'arrival' delay against the estimated time spent in the zone */
+    UInt16 arrDelay = (UInt16)propGetUInt32(PROP_GEOF_ARRIVE_DELAY, 0L);
+    if ((arrDelay != 0) && ((arriveFix.fixtime + (UInt32)arrDelay) > departFix.fixtime)) {
+        // did not stay long enough to be considered 'arrived'
+        return utFalse;
+    }
+    geozSetCurrentID(zoneID);
+    _queueGeofenceEvent(ARRIVE_PRIORITY, STATUS_GEOFENCE_ARRIVE, &arriveFix, zoneID);
+    logINFO(LOGSRC,"Arrived %u [%u] (path)\n", zoneID, geozGetCurrentID());
+
+    /* check 'departure' delay */
+    UInt16 depDelay = (UInt16)propGetUInt32(PROP_GEOF_DEPART_DELAY, 0L);
+    if ((depDelay == 0) || ((departFix.fixtime + (UInt32)depDelay) <= utcGetTimeSec())) {
+        _queueGeofenceEvent(DEPART_PRIORITY, STATUS_GEOFENCE_DEPART, &departFix, zoneID);
+        geozSetCurrentID(NO_ZONE);
+        gpsClear(&departPoint);
+        logINFO(LOGSRC,"Departed %u [%u] (path)\n", zoneID, geozGetCurrentID());
+    } else {
+        // the departure will be queued by 'geozCheckGPS' once the delay expires
+        gpsCopy(&departPoint, &departFix);
+    }
+    startupSaveProperties();
+    return utTrue;
+
+}
+
 /* check new GPS fix for various motion events */
 void geozCheckGPS(const GPS_t *oldFix, const GPS_t *newFix)
 {
@@ -229,6 +314,10 @@ void geozCheckGPS(const GPS_t *oldFix, const GPS_t *newFix)
             gpsClear(&arrivePoint);
         }
         
+    } else
+    if (!IS_VALID_ZONE(curZoneID) && oldFix && _geozCheckPath(oldFix, newFix)) {
+        // I was 'out' and I'm still 'out', but passed through a zone in between
+        gpsClear(&arrivePoint);
     } else {
         // My 'Zone' state has not changed
         // (ie. If I'm 'out', I'm still 'out'.  If I'm 'in', I'm still 'in'.)
@@ -265,6 +354,237 @@ static GPSPoint_t *_geozToGPSPoint(GPSPoint_t *gp, const GeoZonePoint_t *gzp)
     }
 }
 
+/* project 'gp' onto a plane (in meters) centered at 'ref' */
+// The equirectangular approximation used here is adequate over the few
+// kilometers that separate consecutive fixes.  Since the projection is
+// linear, a fraction along a projected line is also a fraction along the
+// original lat/lon line.
+static void _geozLocalXY(double *x, double *y, const GPSPoint_t *ref, const GPSPoint_t *gp)
+{
+    *x = (gp->longitude - ref->longitude) * METERS_PER_DEGREE * cos(ref->latitude * RADIANS);
+    *y = (gp->latitude  - ref->latitude ) * METERS_PER_DEGREE;
+}
+
+/* calculate the bounding box of the specified zone */
+static void _geozSetBounds(GeoZoneBounds_t *b, const GeoZone_t *geoz)
+{
+    float dLat = 0.0, dLon = 0.0;
+    if (geoz->type != GEOF_BOUNDED_RECT) {
+        // expand the points by the zone radius (longitude degrees shrink toward the poles)
+        double cosLat = cos((double)geoz->point[0].latitude * RADIANS);
+        dLat = (float)((double)geoz->radius / METERS_PER_DEGREE);
+        dLon = (cosLat > 0.01)? (float)((double)dLat / cosLat) : 180.0;
+    }
+    switch (geoz->type) {
+        case GEOF_BOUNDED_RECT:
+            b->latMax = geoz->point[0].latitude;
+            b->latMin = geoz->point[1].latitude;
+            b->lonMin = geoz->point[0].longitude;
+            b->lonMax = geoz->point[1].longitude;
+            break;
+#ifdef GEOF_DELTA_RECT
+        case GEOF_DELTA_RECT:
+            b->latMax = geoz->point[0].latitude  + geoz->point[1].latitude;
+            b->latMin = geoz->point[0].latitude  - geoz->point[1].latitude;
+            b->lonMin = geoz->point[0].longitude - geoz->point[1].longitude;
+            b->lonMax = geoz->point[0].longitude + geoz->point[1].longitude;
+            break;
+#endif
+        default:
+            // GEOF_DUAL_POINT_RADIUS, GEOF_SWEPT_POINT_RADIUS
+            b->latMin = b->latMax = geoz->point[0].latitude;
+            b->lonMin = b->lonMax = geoz->point[0].longitude;
+            if ((geoz->point[1].latitude != 0.0) || (geoz->point[1].longitude != 0.0)) {
+                if (geoz->point[1].latitude  < b->latMin) { b->latMin = geoz->point[1].latitude;  }
+                if (geoz->point[1].latitude  > b->latMax) { b->latMax = geoz->point[1].latitude;  }
+                if (geoz->point[1].longitude < b->lonMin) { b->lonMin = geoz->point[1].longitude; }
+                if (geoz->point[1].longitude > b->lonMax) { b->lonMax = geoz->point[1].longitude; }
+            }
+            break;
+    }
+    b->latMin -= dLat;
+    b->latMax += dLat;
+    b->lonMin -= dLon;
+    b->lonMax += dLon;
+}
+
+/* return true if the box [latMin..latMax, lonMin..lonMax] overlaps the zone bounds */
+static utBool _geozBoundsOverlap(const GeoZoneBounds_t *b, 
+    double latMin, double latMax, double lonMin, double lonMax)
+{
+    if ((latMax < (double)b->latMin) || (latMin > (double)b->latMax)) {
+        return utFalse;
+    }
+    if ((lonMax < (double)b->lonMin) || (lonMin > (double)b->lonMax)) {
+        return utFalse;
+    }
+    return utTrue;
+}
+
+/* clip the line (x,y)+t*(dx,dy) to the rectangle [xMin..xMax, yMin..yMax] */
+// On entry, '*tIn'/'*tOut' hold the range of 't' to clip, on return they hold
+// the range of 't' which lies within the rectangle (Liang-Barsky).
+static utBool _geozClipLine(double x, double y, double dx, double dy,
+    double xMin, double xMax, double yMin, double yMax, double *tIn, double *tOut)
+{
+    double p[4] = { -dx, dx, -dy, dy };
+    double q[4] = { x - xMin, xMax - x, y - yMin, yMax - y };
+    int i;
+    for (i = 0; i < 4; i++) {
+        if (p[i] == 0.0) {
+            if (q[i] < 0.0) {
+                // parallel to, and outside of, this edge
+                return utFalse;
+            }
+        } else {
+            double r = q[i] / p[i];
+            if (p[i] < 0.0) {
+                if (r > *tIn) { *tIn = r; }
+            } else {
+                if (r < *tOut) { *tOut = r; }
+            }
+        }
+    }
+    return (*tIn <= *tOut)? utTrue : utFalse;
+}
+
+/* intersect the line (x,y)+t*(dx,dy) with a circle of radius 'r' at (cx,cy) */
+// On return, '*tIn'/'*tOut' hold the range of 't' (clipped to 0..1) inside the circle.
+static utBool _geozClipCircle(double x, double y, double dx, double dy,
+    double cx, double cy, double r, double *tIn, double *tOut)
+{
+    double fx = x - cx, fy = y - cy;
+    double a = (dx * dx) + (dy * dy);
+    double b = 2.0 * ((fx * dx) + (fy * dy));
+    double c = (fx * fx) + (fy * fy) - (r * r);
+    if (a <= 0.0) {
+        // zero length path
+        *tIn = 0.0; *tOut = 1.0;
+        return (c <= 0.0)? utTrue : utFalse;
+    }
+    double disc = (b * b) - (4.0 * a * c);
+    if (disc < 0.0) {
+        return utFalse;
+    }
+    disc = sqrt(disc);
+    *tIn  = (-b - disc) / (2.0 * a);
+    *tOut = (-b + disc) / (2.0 * a);
+    if ((*tIn > 1.0) || (*tOut < 0.0)) {
+        return utFalse;
+    }
+    if (*tIn  < 0.0) { *tIn  = 0.0; }
+    if (*tOut > 1.0) { *tOut = 1.0; }
+    return utTrue;
+}
+
+/* check the path from 'gpS' to 'gpE' against the specified zone */
+// If the path crosses the zone, '*tIn'/'*tOut' are set to the fraction of the
+// path at which the zone is entered and exited.
+static utBool _geozPathInZone(GeoZone_t *geoz, const GPSPoint_t *gpS, const GPSPoint_t *gpE,
+    double *tIn, double *tOut)
+{
+    utBool crossed = utFalse;
+    if (geoz && gpS && gpE && IS_VALID_ZONE(geoz->zoneID)) {
+        
+        GPSPoint_t geozGP_0, geozGP_1;
+        double radiusMeters = (double)geoz->radius;
+        double ex, ey, ax, ay, bx, by, t0, t1;
+        _geozLocalXY(&ex, &ey, gpS, gpE); // path runs from (0,0) to (ex,ey)
+        switch (geoz->type) {
+
+#ifdef GEOF_SWEPT_POINT_RADIUS
+            case GEOF_SWEPT_POINT_RADIUS:
+                // union of the two end circles and the rectangle between them.
+                // Since this shape is convex, the path enters/exits it once.
+                _geozToGPSPoint(&geozGP_0, &(geoz->point[0]));
+                _geozToGPSPoint(&geozGP_1, &(geoz->point[1]));
+                if (!gpsPointIsValid(&geozGP_0) || !gpsPointIsValid(&geozGP_1)) {
+                    break;
+                }
+                _geozLocalXY(&ax, &ay, gpS, &geozGP_0);
+                _geozLocalXY(&bx, &by, gpS, &geozGP_1);
+                *tIn = 1.0; *tOut = 0.0;
+                if (_geozClipCircle(0.0, 0.0, ex, ey, ax, ay, radiusMeters, &t0, &t1)) {
+                    if (t0 < *tIn ) { *tIn  = t0; }
+                    if (t1 > *tOut) { *tOut = t1; }
+                    crossed = utTrue;
+                }
+                if (_geozClipCircle(0.0, 0.0, ex, ey, bx, by, radiusMeters, &t0, &t1)) {
+                    if (t0 < *tIn ) { *tIn  = t0; }
+                    if (t1 > *tOut) { *tOut = t1; }
+                    crossed = utTrue;
+                }
+                {
+                    // rotate the path into the frame of the zone axis
+                    double len = sqrt(((bx - ax) * (bx - ax)) + ((by - ay) * (by - ay)));
+                    if (len > 0.0) {
+                        double ux = (bx - ax) / len, uy = (by - ay) / len;
+                        double pu = -((ax * ux) + (ay * uy));
+                        double pv =   (ax * uy) - (ay * ux);
+                        double du =   (ex * ux) + (ey * uy);
+                        double dv =   (ey * ux) - (ex * uy);
+                        t0 = 0.0; t1 = 1.0;
+                        if (_geozClipLine(pu, pv, du, dv, 0.0, len, -radiusMeters, radiusMeters, &t0, &t1)) {
+                            if (t0 < *tIn ) { *tIn  = t0; }
+                            if (t1 > *tOut) { *tOut = t1; }
+                            crossed = utTrue;
+                        }
+                    }
+                }
+                break;
+#endif
+
+            case GEOF_DUAL_POINT_RADIUS:
+                // the earliest entry into either circle
+                _geozToGPSPoint(&geozGP_0, &(geoz->point[0]));
+                if (gpsPointIsValid(&geozGP_0)) {
+                    _geozLocalXY(&ax, &ay, gpS, &geozGP_0);
+                    if (_geozClipCircle(0.0, 0.0, ex, ey, ax, ay, radiusMeters, &t0, &t1)) {
+                        *tIn = t0; *tOut = t1;
+                        crossed = utTrue;
+                    }
+                }
+                _geozToGPSPoint(&geozGP_1, &(geoz->point[1]));
+                if (gpsPointIsValid(&geozGP_1)) {
+                    _geozLocalXY(&bx, &by, gpS, &geozGP_1);
+                    if (_geozClipCircle(0.0, 0.0, ex, ey, bx, by, radiusMeters, &t0, &t1)) {
+                        if (!crossed || (t0 < *tIn)) {
+                            *tIn = t0; *tOut = t1;
+                        }
+                        crossed = utTrue;
+                    }
+                }
+                break;
+
+            case GEOF_BOUNDED_RECT:
+                // clipped directly in lat/lon (will fail if zone spans +/- 180 degrees)
+                *tIn = 0.0; *tOut = 1.0;
+                crossed = _geozClipLine(gpS->longitude, gpS->latitude,
+                    gpE->longitude - gpS->longitude, gpE->latitude - gpS->latitude,
+                    (double)geoz->point[0].longitude, (double)geoz->point[1].longitude,
+                    (double)geoz->point[1].latitude,  (double)geoz->point[0].latitude,
+                    tIn, tOut);
+                break;
+
+#ifdef GEOF_DELTA_RECT
+            case GEOF_DELTA_RECT:
+                *tIn = 0.0; *tOut = 1.0;
+                crossed = _geozClipLine(gpS->longitude, gpS->latitude,
+                    gpE->longitude - gpS->longitude, gpE->latitude - gpS->latitude,
+                    (double)(geoz->point[0].longitude - geoz->point[1].longitude),
+                    (double)(geoz->point[0].longitude + geoz->point[1].longitude),
+                    (double)(geoz->point[0].latitude  - geoz->point[1].latitude),
+                    (double)(geoz->point[0].latitude  + geoz->point[1].latitude),
+                    tIn, tOut);
+                break;
+#endif
+
+        } // switch (geoz->type)
+        
+    } // if (...)
+    return crossed;
+}
+
 /* check new GPS fix for various motion events */
 static utBool _geozInZone(GeoZone_t *geoz, const GPSPoint_t *newGP)
 {
@@ -278,8 +598,24 @@ static utBool _geozInZone(GeoZone_t *geoz, const GPSPoint_t *newGP)
 
 #ifdef GEOF_SWEPT_POINT_RADIUS
             case GEOF_SWEPT_POINT_RADIUS:
-                // not supported in this implementation.
-                // default to dual point/radius below
+                // within 'radius' meters of the line from point[0] to point[1]
+                _geozToGPSPoint(&geozGP_0, &(geoz->point[0]));
+                _geozToGPSPoint(&geozGP_1, &(geoz->point[1]));
+                if (gpsPointIsValid(&geozGP_0) && gpsPointIsValid(&geozGP_1)) {
+                    double x, y, ax, ay, bx, by;
+                    _geozLocalXY(&x , &y , newGP, newGP);
+                    _geozLocalXY(&ax, &ay, newGP, &geozGP_0);
+                    _geozLocalXY(&bx, &by, newGP, &geozGP_1);
+                    double dx = bx - ax, dy = by - ay, len2 = (dx * dx) + (dy * dy);
+                    double t = (len2 > 0.0)? (((x - ax) * dx) + ((y - ay) * dy)) / len2 : 0.0;
+                    if (t < 0.0) { t = 0.0; } else if (t > 1.0) { t = 1.0; }
+                    dx = ax + (t * dx) - x;
+                    dy = ay + (t * dy) - y;
+                    if (((dx * dx) + (dy * dy)) <= (radiusMeters * radiusMeters)) {
+                        inZone = utTrue;
+                    }
+                }
+                break;
 #endif
                 
             case GEOF_DUAL_POINT_RADIUS:
@@ -363,6 +699,10 @@ GeoZone_t *geozInZone(const GPSPoint_t *newGP)
     UInt16 i;
     GEOZ_LOCK {
         for (i = 0; i < usedZones; i++) {
+            if (!_geozBoundsOverlap(&geoZoneBounds[i], 
+                    newGP->latitude, newGP->latitude, newGP->longitude, newGP->longitude)) {
+                continue;
+            }
             if (_geozInZone(&geoZoneList[i], newGP)) {
                 gz = &geoZoneList[i];
                 break;
@@ -372,6 +712,88 @@ GeoZone_t *geozInZone(const GPSPoint_t *newGP)
     return gz;
 }
 
+/* return the distance (meters) from 'gp' to the nearest zone boundary */
+// This is measured to the zone bounding boxes, and is only an estimate of how
+// soon a zone could be entered or exited.  Returns -1.0 if there are no zones.
+double geozBoundaryMeters(const GPSPoint_t *gp)
+{
+    double best = -1.0, cosLat = cos(gp->latitude * RADIANS);
+    double dLat, dLon, d;
+    UInt16 i;
+    GEOZ_LOCK {
+        for (i = 0; i < usedZones; i++) {
+            const GeoZoneBounds_t *b = &geoZoneBounds[i];
+            if (!IS_VALID_ZONE(geoZoneList[i].zoneID)) {
+                continue; // deleted zone, 'geoZoneBounds[i]' is stale
+            }
+            if ((gp->latitude  >= b->latMin) && (gp->latitude  <= b->latMax) &&
+                (gp->longitude >= b->lonMin) && (gp->longitude <= b->lonMax)) {
+                // inside the box, distance to the closest edge
+                dLat = gp->latitude - b->latMin;
+                if ((b->latMax - gp->latitude) < dLat) { dLat = b->latMax - gp->latitude; }
+                dLon = gp->longitude - b->lonMin;
+                if ((b->lonMax - gp->longitude) < dLon) { dLon = b->lonMax - gp->longitude; }
+                dLat *= METERS_PER_DEGREE;
+                dLon *= METERS_PER_DEGREE * cosLat;
+                d = (dLat < dLon)? dLat : dLon;
+            } else {
+                // outside the box, distance to the closest point of the box
+                dLat = (gp->latitude < b->latMin)? (b->latMin - gp->latitude) : 
+                    (gp->latitude > b->latMax)? (gp->latitude - b->latMax) : 0.0;
+                dLon = (gp->longitude < b->lonMin)? (b->lonMin - gp->longitude) : 
+                    (gp->longitude > b->lonMax)? (gp->longitude - b->lonMax) : 0.0;
+                dLat *= METERS_PER_DEGREE;
+                dLon *= METERS_PER_DEGREE * cosLat;
+                d = sqrt((dLat * dLat) + (dLon * dLon));
+            }
+            if ((best < 0.0) || (d < best)) {
+                best = d;
+            }
+        }
+    } GEOZ_UNLOCK
+    return best;
+}
+
+/* return the first zone crossed by the path from 'gpS' to 'gpE' */
+// '*tIn'/'*tOut' are set to the fraction of the path (0..1) at which the
+// returned zone is entered and exited.
+GeoZone_t *geozCrossedZone(const GPSPoint_t *gpS, const GPSPoint_t *gpE, double *tIn, double *tOut)
+{
+    GeoZone_t *gz = (GeoZone_t*)0;
+    double latMin, latMax, lonMin, lonMax;
+    double t0, t1;
+    UInt16 i;
+
+    /* path bounding box */
+    if (gpS->latitude < gpE->latitude) {
+        latMin = gpS->latitude; latMax = gpE->latitude;
+    } else {
+        latMin = gpE->latitude; latMax = gpS->latitude;
+    }
+    if (gpS->longitude < gpE->longitude) {
+        lonMin = gpS->longitude; lonMax = gpE->longitude;
+    } else {
+        lonMin = gpE->longitude; lonMax = gpS->longitude;
+    }
+
+    /* find earliest crossing */
+    GEOZ_LOCK {
+        for (i = 0; i < usedZones; i++) {
+            if (!_geozBoundsOverlap(&geoZoneBounds[i], latMin, latMax, lonMin, lonMax)) {
+                continue;
+            }
+            if (_geozPathInZone(&geoZoneList[i], gpS, gpE, &t0, &t1)) {
+                if (!gz || (t0 < *tIn)) {
+                    gz = &geoZoneList[i];
+                    *tIn  = t0;
+                    *tOut = t1;
+                }
+            }
+        }
+    } GEOZ_UNLOCK
+    return gz;
+}
+
 // ----------------------------------------------------------------------------
 
 static void _geozClearAll()
@@ -490,7 +912,7 @@ static CommandError_t _geozAddGeoZone(GeoZone_t *gz)
 #ifdef GEOF_SWEPT_POINT_RADIUS
     // A point radius swept over the globe from one point to another
     if (gz->type == GEOF_SWEPT_POINT_RADIUS) {
-        if (!gpsPointIsValid(&pt0) || !gpsPointIsValid(&pt0)) {
+        if (!gpsPointIsValid(&pt0) || !gpsPointIsValid(&pt1)) {
             // both points must be valid
             return COMMAND_LATLON;
         }
@@ -553,6 +975,7 @@ static CommandError_t _geozAddGeoZone(GeoZone_t *gz)
 
     /* add new geoZone */
     memcpy(&geoZoneList[zoneNdx], gz, sizeof(GeoZone_t));
+    _geozSetBounds(&geoZoneBounds[zoneNdx], &geoZoneList[zoneNdx]);
     geozIsDirty = utTrue;
     return COMMAND_OK;
     
@@ -734,6 +1157,7 @@ static utBool _geozLoadGeoZones(const char *geozName)
             ioCloseStream(file);
             return utFalse; // error
         }
+        _geozSetBounds(&geoZoneBounds[usedZones], geoz);
 #ifdef GEOZ_INCL_PRINT_GEOZONE
         //_geozPrintGeoZone(geoz);
 #endif
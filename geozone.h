@@ -53,7 +53,7 @@ extern "C" {
 // the server presents a format that the client does not support.
 #define GEOF_DUAL_POINT_RADIUS      0       // 2 point/radius zones
 #define GEOF_BOUNDED_RECT           1       // pt[0] is NorthWest, pt[1] is SouthEast
-#define GEOF_SWEPT_POINT_RADIUS     2       // swept point/radius (point to point) (if implemented)
+#define GEOF_SWEPT_POINT_RADIUS     2       // swept point/radius (point to point)
 //#define GEOF_DELTA_RECT           3       // pt[0] is center, pt[1] is delta lat/lon
 
 /* GeoZone ID definition */
@@ -93,6 +93,8 @@ const char *geozGetVersion();
 GeoZoneID_t geozGetCurrentID();
 void geozSetCurrentID(GeoZoneID_t zoneID);
 GeoZone_t *geozInZone(const GPSPoint_t *newGP);
+GeoZone_t *geozCrossedZone(const GPSPoint_t *gpS, const GPSPoint_t *gpE, double *tIn, double *tOut);
+double geozBoundaryMeters(const GPSPoint_t *gp);
 
 UInt16 geozGetGeoZoneCount();
 
@@ -0,0 +1,172 @@
+/* Output service for the alarm and QDAC power control files.
+ * The control files are kept open and written by a worker thread, so the
+ * RFID/QDAC threads neither block on them nor fork a shell to drive them.
+ * Requests are coalesced per output: only the latest state is written.
+ * The alarm control file is set by PROP_RFID_ALARM_OUTPUT; when it is not
+ * configured or cannot be opened, the worker runs the trig_alarm/disalarm
+ * scripts instead, as the readers used to do themselves. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "propman.h"
+#include "gpio_out.h"
+
+struct gpio_out {
+	const char *name;
+	char path[64];			/* control file, "" if none */
+	const char *active;		/* written to activate */
+	const char *inactive;
+	const char *active_cmd;		/* fallback without a control file */
+	const char *inactive_cmd;
+	int fd;
+};
+
+static struct gpio_out gpio_outs[NUM_GPIO_OUTS] = {
+	{"alarm", "", "1", "0", "/usr/local/bin/trig_alarm", "/usr/local/bin/disalarm", -1},
+	{"qdac power", "/sys/aatsi_devs_ctrl/qdac", "low", "high", NULL, NULL, -1},
+};
+
+static pthread_once_t gpio_once = PTHREAD_ONCE_INIT;
+static pthread_t gpio_thread;
+static bool gpio_thread_running = false;
+static pthread_mutex_t gpio_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gpio_request = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t gpio_done = PTHREAD_COND_INITIALIZER;
+static uint32_t gpio_pending;			/* bit per output */
+static bool gpio_desired[NUM_GPIO_OUTS];
+static uint32_t gpio_requested[NUM_GPIO_OUTS];	/* request generation */
+static uint32_t gpio_applied[NUM_GPIO_OUTS];
+static int gpio_result[NUM_GPIO_OUTS];
+
+static void *gpio_out_main(void *args);
+
+static int gpio_out_run(const char *cmd)
+{
+	pid_t pid;
+	int status;
+
+	if (cmd == NULL)
+		return -1;
+	pid = fork();
+	if (pid < 0)
+		return -1;
+	if (pid == 0) {
+		execl(cmd, cmd, (char *)NULL);
+		_exit(127);
+	}
+	if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		return -1;
+	return 0;
+}
+/* Write the state of an output, reopening its control file once if the
+ * cached descriptor fails.  Called by the worker only. */
+static int gpio_out_write(struct gpio_out *g, bool active)
+{
+	const char *val = active? g->active : g->inactive;
+	int retry;
+
+	for (retry = 0; retry < 2 && g->path[0] != '\0'; retry++) {
+		if (g->fd < 0 && (g->fd = open(g->path, O_WRONLY)) < 0)
+			break;
+		if (lseek(g->fd, 0, SEEK_SET) >= 0 && write(g->fd, val, strlen(val)) == (ssize_t)strlen(val))
+			return 0;
+		close(g->fd);
+		g->fd = -1;
+	}
+	if (g->active_cmd != NULL)
+		return gpio_out_run(active? g->active_cmd : g->inactive_cmd);
+	printf("Set %s output (%s) failed: %s\n", g->name, g->path, strerror(errno));
+	return -1;
+}
+static void gpio_out_init(void)
+{
+	const char *path = propGetString(PROP_RFID_ALARM_OUTPUT, "");
+
+	if (path != NULL && strlen(path) < sizeof(gpio_outs[GPIO_OUT_ALARM].path))
+		strcpy(gpio_outs[GPIO_OUT_ALARM].path, path);
+	if (pthread_create(&gpio_thread, NULL, gpio_out_main, NULL) != 0)
+		printf("Creating Thread Error\n");
+	else
+		gpio_thread_running = true;
+}
+/* Apply the latest request of every output, in request order per output */
+void *gpio_out_main(void *args)
+{
+	uint32_t gen;
+	bool active;
+	int i, rc;
+
+	pthread_mutex_lock(&gpio_mutex);
+	for (;;) {
+		while (gpio_pending == 0)
+			pthread_cond_wait(&gpio_request, &gpio_mutex);
+		for (i = 0; i < NUM_GPIO_OUTS; i++) {
+			if (!(gpio_pending & (1 << i)))
+				continue;
+			gpio_pending &= ~(1 << i);
+			active = gpio_desired[i];
+			gen = gpio_requested[i];
+			pthread_mutex_unlock(&gpio_mutex);
+			rc = gpio_out_write(&gpio_outs[i], active);
+			pthread_mutex_lock(&gpio_mutex);
+			gpio_applied[i] = gen;
+			gpio_result[i] = rc;
+		}
+		pthread_cond_broadcast(&gpio_done);
+	}
+	return NULL;
+}
+static uint32_t gpio_out_request(int out, bool active)
+{
+	uint32_t gen;
+
+	pthread_once(&gpio_once, gpio_out_init);
+	pthread_mutex_lock(&gpio_mutex);
+	gpio_desired[out] = active;
+	gen = ++gpio_requested[out];
+	gpio_pending |= (1 << out);
+	pthread_cond_signal(&gpio_request);
+	pthread_mutex_unlock(&gpio_mutex);
+	return gen;
+}
+/* Queue a new state for an output and return at once */
+void gpio_out_set(int out, bool active)
+{
+	if (out < 0 || out >= NUM_GPIO_OUTS)
+		return;
+	pthread_once(&gpio_once, gpio_out_init);
+	if (gpio_thread_running)
+		gpio_out_request(out, active);
+	else
+		gpio_out_set_wait(out, active);
+}
+/* Set an output and wait until it is written, returns 0 or -1 */
+int gpio_out_set_wait(int out, bool active)
+{
+	uint32_t gen;
+	int rc;
+
+	if (out < 0 || out >= NUM_GPIO_OUTS)
+		return -1;
+	gen = gpio_out_request(out, active);
+	pthread_mutex_lock(&gpio_mutex);
+	if (!gpio_thread_running) {
+		/* no worker, write it from the calling thread */
+		gpio_pending &= ~(1 << out);
+		gpio_applied[out] = gen;
+		gpio_result[out] = gpio_out_write(&gpio_outs[out], active);
+	}
+	while ((int32_t)(gpio_applied[out] - gen) < 0)
+		pthread_cond_wait(&gpio_done, &gpio_mutex);
+	rc = gpio_result[out];
+	pthread_mutex_unlock(&gpio_mutex);
+	return rc;
+}
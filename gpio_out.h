@@ -0,0 +1,12 @@
+#ifndef _GPIO_OUT_H
+#define _GPIO_OUT_H
+#include <stdbool.h>
+
+/* digital outputs driven through sysfs control files */
+#define GPIO_OUT_ALARM		0	/* temperature alarm output */
+#define GPIO_OUT_QDAC_POWER	1	/* QDAC hub power */
+#define NUM_GPIO_OUTS		2
+
+void gpio_out_set(int out, bool active);
+int gpio_out_set_wait(int out, bool active);
+#endif
@@ -62,6 +62,8 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <poll.h>
+#include <errno.h>
+#include <sched.h>
 
 #include "log.h"
 #include "gps.h"
@@ -76,7 +78,12 @@
 #include "propman.h"
 #include "statcode.h"
 #include "rfid.h"
-#include "float_point_handle.h"
+#include "motion.h"
+#if defined(ENABLE_GEOZONE)
+#include "geozone.h"
+#endif
+#include "nmea.h"
+#include "ubx.h"
 #include "diagnostic.h"
 // ----------------------------------------------------------------------------
 
@@ -112,6 +119,9 @@
 /* GPS bps */
 #define INIT_GPS_SPEED			4800
 
+/* UBX binary mode navigation solution period */
+#define UBX_MEAS_RATE_MS		1000
+
 /* minimum out-of-sync seconds between GPS time and system time */
 // delta must be at least this value to cause a system clock update
 #define MIN_DELTA_CLOCK_TIME    5L
@@ -153,8 +163,17 @@ long clock_delta;
 double minimumSpeed;
 bool gps_power_saving = false;
 uint32_t gps_power_saving_cycle = 3600;
+/* power saving duty cycle policy (PROP_GPS_DUTY_CYCLE) */
+static uint32_t gps_duty_min = 60;			/* off-period while moving (sec) */
+static uint32_t gps_duty_max = 14400;		/* longest off-period when parked and quiet (sec) */
+static uint32_t gps_duty_kph = 5;			/* speed considered moving */
+static uint32_t gps_duty_zone = 1000;		/* geozone boundary considered near (meters) */
+static uint32_t gps_duty_period = 3600;		/* current off-period */
+static GPSPoint_t gps_duty_point;			/* position at the previous wake */
+static volatile time_t gps_activity_time = 0;	/* last external motion activity */
 static bool gps_read_chip = false;
 static bool gps_read_publisher = true;
+static bool gps_binary = false;		/* receiver is in UBX binary mode */
 static int sock_gps;
 
 #if defined(GPS_DEVICE_SIMULATOR)
@@ -163,6 +182,24 @@ static utBool			gpsSimulator = utFalse;
 static ComPort_t		gpsCom = {.name = "ttyS3", .bps = 9600,};
 static GPS_t			gpsFixLast;
 static GPS_t			gpsFixUnsafe;
+/* 'gpsFixLast' is published with a sequence lock */
+// Only the GPS thread writes 'gpsFixLast'.  'gpsFixSeq' is odd while it is
+// being written, and readers retry until they copy it under the same even
+// sequence, so readers never block the GPS thread (or each other).
+static volatile UInt32	gpsFixSeq = 0;
+static volatile UInt32	gpsFixGeneration = 0;	/* bumped on every publish */
+static volatile UInt32	gpsFixConsumed = 0;		/* power saving: generation already handed out */
+static volatile UInt32	gpsFixWaiters = 0;		/* threads blocked in 'gpsAquire' */
+static volatile utBool	gpsReceiverOff = utFalse;	/* power saving: receiver is in its off-period */
+/* recent fix history, oldest first, also covered by 'gpsFixSeq' */
+#define GPS_HISTORY_SIZE		512		/* ~8 minutes of fixes at 1Hz */
+typedef struct {
+	time_t		when;		/* system time the fix was received */
+	GPSPoint_t	point;
+} GPSHistory_t;
+static GPSHistory_t		gpsHistory[GPS_HISTORY_SIZE];
+static int				gpsHistoryHead = 0;		/* oldest entry */
+static int				gpsHistoryCount = 0;
 static struct tm		July2011 = {0, 0, 0, 10, 6, 111, 0};
 static utBool			gpsFixValid = utFalse;
 static UInt32			gpsSampleCount_A = 0;
@@ -188,7 +225,7 @@ threadThread_t	gpsThread;
 #define AQUIRE_UNLOCK           MUTEX_UNLOCK(&gpsAquireMutex);
 //#define AQUIRE_WAIT             CONDITION_WAIT(&gpsAquireCond, &gpsAquireMutex);
 #define AQUIRE_WAIT(T)          CONDITION_TIMED_WAIT(&gpsAquireCond, &gpsMutex, (T));
-#define AQUIRE_NOTIFY           CONDITION_NOTIFY(&gpsAquireCond);
+#define AQUIRE_NOTIFY           CONDITION_NOTIFY_ALL(&gpsAquireCond);
 #else
 #define SAMPLE_LOCK     
 #define SAMPLE_UNLOCK   
@@ -200,9 +237,10 @@ threadThread_t	gpsThread;
 #define AQUIRE_NOTIFY           
 #endif
 #define GPS_SENTENCE_SIZE 96
-#define GPS_READ_LINES 6
-#define GPS_BUF_SIZE GPS_SENTENCE_SIZE * GPS_READ_LINES
+#define GPS_READ_LINES 8
+#define GPS_RBUF_SIZE (GPS_SENTENCE_SIZE * GPS_READ_LINES)
 #define GPS_PORT_TIMEOUT 86400
+#define GPS_AQUIRE_FRESH_SEC 7		/* 'gpsAquire' accepts fixes up to this age */
 
 static int gps_debug = 0;
 // ----------------------------------------------------------------------------
@@ -211,9 +249,13 @@ static GPSDiagnostics_t gpsStats = { 0L, 0L, 0L, 0L, 0L};
 // ----------------------------------------------------------------------------
 int gps_port_timeout;
 void * gps_thread_main(void * arg);
-static int parse_rmc(char *sentence);
-static int parse_gsa(char *sentence);
-static int parse_gga(char *sentence);
+static int parse_rmc(NMEAFields_t *f);
+static int parse_gsa(NMEAFields_t *f);
+static int parse_gga(NMEAFields_t *f);
+static int parse_vtg(NMEAFields_t *f);
+static int dispatch_sentence(char *sentence, int n, NMEAFields_t *f);
+static int dispatch_ubx(UInt8 *frame, int n);
+static void gps_signal_state(bool locked);
 static void make_nav_init(char * msg);
 static void checksum_nema(char * msg);
 int synchronize_system_clock(time_t new_time);
@@ -231,8 +273,25 @@ void print_data(int n, char *sentence);
 static int establish_gps_socket(void);
 static int subscribe_gps(void);
 static void cancel_gps_subscription(void);
-//float str_to_f(char *string);
-//double str_to_d(char *string);
+
+/* NMEA sentence dispatch table */
+// Sentences are matched on the formatter only ("RMC" of "$GPRMC"), so any 
+// talker ID ("GP" GPS, "GL" GLONASS, "GN" combined, "GA" Galileo, "BD") is
+// accepted.
+typedef int (*NMEAParseFtn_t)(NMEAFields_t *f);
+typedef struct
+{
+	const char		*formatter;
+	NMEAParseFtn_t	ftn;
+} NMEASentence_t;
+static NMEASentence_t	nmeaSentenceTable[] = {
+	{ "RMC",	parse_rmc },
+	{ "GGA",	parse_gga },
+	{ "GSA",	parse_gsa },
+	{ "VTG",	parse_vtg },
+	{ NULL,		NULL },
+};
+static UInt32			gpsSentenceErrors = 0;
 
 GPSDiagnostics_t *gpsGetDiagnostics(GPSDiagnostics_t *stats)
 {
@@ -339,18 +398,69 @@ static void _gpsConfigSiRF(ComPort_t *com)
 
 // ----------------------------------------------------------------------------
 
+static void _gpsWriteUBX(ComPort_t *com, UInt8 cls, UInt8 id, const UInt8 *payload, int len)
+{
+	UInt8 msg[UBX_OVERHEAD + 32];
+	int n = ubxBuildMessage(msg, sizeof(msg), cls, id, payload, len);
+
+	if (n > 0) {
+		write(com->read_fd, msg, n);
+		usleep(100000);
+	}
+}
+
+static void _gpsConfigUBX(ComPort_t *com)
+{
+	// This configures a u-blox receiver to output only UBX-NAV-PVT and
+	// UBX-NAV-DOP binary messages, once per navigation solution.
+	UInt32 bps = (UInt32)com->bps;
+	UInt8 prt[20] = {
+		0x01, 0x00,					// UART1, reserved
+		0x00, 0x00,					// txReady off
+		0xC0, 0x08, 0x00, 0x00,		// 8N1
+		bps & 0xFF, (bps >> 8) & 0xFF, (bps >> 16) & 0xFF, (bps >> 24) & 0xFF,
+		0x03, 0x00,					// input: UBX + NMEA
+		0x01, 0x00,					// output: UBX only
+		0x00, 0x00, 0x00, 0x00,
+	};
+	UInt8 rate[6] = {
+		UBX_MEAS_RATE_MS & 0xFF, (UBX_MEAS_RATE_MS >> 8) & 0xFF,
+		0x01, 0x00,					// one solution per measurement
+		0x00, 0x00,					// UTC aligned
+	};
+	UInt8 pvt[3] = { UBX_CLASS_NAV, UBX_NAV_PVT, 1 };
+	UInt8 dop[3] = { UBX_CLASS_NAV, UBX_NAV_DOP, 1 };
+
+	_gpsWriteUBX(com, UBX_CLASS_CFG, UBX_CFG_PRT, prt, sizeof(prt));
+	_gpsWriteUBX(com, UBX_CLASS_CFG, UBX_CFG_RATE, rate, sizeof(rate));
+	_gpsWriteUBX(com, UBX_CLASS_CFG, UBX_CFG_MSG, pvt, sizeof(pvt));
+	_gpsWriteUBX(com, UBX_CLASS_CFG, UBX_CFG_MSG, dop, sizeof(dop));
+	tcflush(com->read_fd, TCIFLUSH);
+	logDEBUG(LOGSRC,"u-blox GPS configured for UBX output");
+}
+
+// ----------------------------------------------------------------------------
+
 /* open gps serial port */
 static utBool _gpsOpen(bool initialize)
 {
 	if (gps_read_chip) {
 		const char *portName = propGetString(PROP_CFG_GPS_PORT, "");
 		const char *chip;
+		int rc;
 		if (power_up_gps(initialize) < 0)
 			return utFalse;
 
 		strncpy(gpsCom.name, portName, PORT_NAME_SIZE);
 		gpsCom.bps = propGetUInt32(PROP_CFG_GPS_BPS, 9600);
-		if (open_serial_text(&gpsCom) < 0) {
+		chip = propGetString(PROP_CFG_GPS_MODEL,"");
+		gps_binary = (strcmp(chip, GPS_RECEIVER_UBLOX) == 0)? true : false;
+		if (gps_binary) {
+			gpsCom.read_len = 1;
+			rc = open_serial_binary(&gpsCom);
+		} else
+			rc = open_serial_text(&gpsCom);
+		if (rc < 0) {
 		// The outer loop will retry the open later
 		// Generally, this should not occur on the GumStix
 			logWARNING(LOGSRC,"Unable to open GPS port '%s'", portName);
@@ -367,13 +477,15 @@ static utBool _gpsOpen(bool initialize)
 		}
 	#endif
 		/* specific GPS device configuration */
-		chip = propGetString(PROP_CFG_GPS_MODEL,"");
 		if (strcmp(chip, GPS_RECEIVER_SIRF) == 0) {
 		//W2SG0004 or W2SG0084 
 			_gpsConfigSiRF(&gpsCom);
 		} else if (strcmp(chip, GPS_RECEIVER_GARMIN) == 0) {
 		// Garmin 15, 18PC
 			_gpsConfigGarmin(&gpsCom);
+		} else if (gps_binary) {
+		// u-blox, UBX binary
+			_gpsConfigUBX(&gpsCom);
 		} else
 			printf("Unknown GPS Chip\n");
 		return utTrue;
@@ -446,6 +558,15 @@ void gpsReloadParameter(void)
 	gps_power_saving = (propGetUInt32AtIndex(PROP_GPS_POWER_SAVING, 0, 0))? true : false;
 	if (gps_power_saving) {
 		gps_power_saving_cycle = propGetUInt32AtIndex(PROP_GPS_POWER_SAVING, 1, 3600);
+		gps_duty_min = propGetUInt32AtIndex(PROP_GPS_DUTY_CYCLE, 0, 60);
+		gps_duty_max = propGetUInt32AtIndex(PROP_GPS_DUTY_CYCLE, 1, 14400);
+		gps_duty_kph = propGetUInt32AtIndex(PROP_GPS_DUTY_CYCLE, 2, 5);
+		gps_duty_zone = propGetUInt32AtIndex(PROP_GPS_DUTY_CYCLE, 3, 1000);
+		if (gps_duty_min < GPS_POWER_SAVING_WAKE_PERIOD)
+			gps_duty_min = GPS_POWER_SAVING_WAKE_PERIOD;
+		if (gps_duty_max < gps_power_saving_cycle)
+			gps_duty_max = gps_power_saving_cycle;
+		gps_duty_period = gps_power_saving_cycle;
 		clock_source |= CLOCK_SYNC_GPS;
 		time_delta = 3;
 	}
@@ -532,43 +653,11 @@ GPS_t *gpsAquire(GPS_t *gps, UInt32 timeoutMS)
 		return gpsGetLastGPS(gps, -1);
 	}
 	
-	/* indicate to GPS thread that we want a fix */
-	// This is only necessary if the gps interval is long and the gps thread is
-	// waiting to be told to make a gps aquisition.
-	AQUIRE_LOCK {
-		gpsAquireTimeoutMS = timeoutMS; // this value is > 0
-		gpsAquireRequest   = utTrue;
-		AQUIRE_NOTIFY
-	} AQUIRE_UNLOCK
-	// at this point, the gps thread should be working on getting a fix
-
-	/* wait until a fix is available */
-	UInt32 accumTimeoutMS = 0L;
-	for (;accumTimeoutMS < timeoutMS;) {
-		
-		/* get latest fix */
-		GPS_t *g = gpsGetLastGPS(gps, -1);
-		if (g && (utcGetTimerAgeSec(g->ageTimer) <= 7L)) {
-			// The latest fix occurred within the last 7 seconds.
-			return g;
-		}
-		
-		/* wait for next fix */
-		UInt32 tmo = timeoutMS - accumTimeoutMS;
-		if (tmo > 1000L) { tmo = 1000L; }
-		threadSleepMS(tmo);
-		accumTimeoutMS += tmo;
-
-	}
-
-	/* no fix (timeout?) */
-	return (GPS_t*)0;
-
 #if defined(GPS_DEVICE_SIMULATOR)
 	const char *gpsPortName = propGetString(PROP_CFG_GPS_PORT, DEFAULT_GPS_PORT);
 	gpsSimulator = strEqualsIgnoreCase(gpsPortName, GPS_SIMULATOR_PORT);
 	if (gpsSimulator) {
-		int rtn = _gpsReadGPSFix(tmo);
+		int rtn = _gpsReadGPSFix(timeoutMS);
 		if (rtn > 0) {
 			// valid fix aquired
 			return gpsGetLastGPS(gps, 15);
@@ -579,7 +668,7 @@ GPS_t *gpsAquire(GPS_t *gps, UInt32 timeoutMS)
 	} else
 #endif
 	if (comPortIsOpen(&gpsCom) || _gpsOpen(false)) {
-		int rtn = _gpsReadGPSFix(tmo);
+		int rtn = _gpsReadGPSFix(timeoutMS);
 		_gpsClose(true); // always close the port when runnin in non-thread mode
 		if (rtn > 0) {
 			// valid fix aquired (at least $GPRMC)
@@ -600,37 +689,203 @@ GPS_t *gpsAquire(GPS_t *gps, UInt32 timeoutMS)
 }
 #endif // defined(GPS_THREAD)
 
+/* start/end an update of 'gpsFixLast' (GPS thread only) */
+static void _gpsPublishBegin(void)
+{
+	gpsFixSeq++;
+	__sync_synchronize();
+}
+static void _gpsPublishEnd(void)
+{
+	gpsFixGeneration++;
+	__sync_synchronize();
+	gpsFixSeq++;
+	__sync_synchronize();	/* order the publish before reading 'gpsFixWaiters' */
+}
+
+/* start/end a read of the published fix, retry if the end returns true */
+static UInt32 _gpsReadBegin(void)
+{
+	UInt32 seq;
+
+	while ((seq = gpsFixSeq) & 1)
+		sched_yield();		/* writer in progress */
+	__sync_synchronize();
+	return seq;
+}
+static bool _gpsReadRetry(UInt32 seq)
+{
+	__sync_synchronize();
+	return (gpsFixSeq != seq);
+}
+
+/* copy a consistent snapshot of 'gpsFixLast', return its generation */
+static UInt32 _gpsReadLast(GPS_t *gps)
+{
+	UInt32 seq, gen;
+
+	do {
+		seq = _gpsReadBegin();
+		memcpy(gps, (const void *)&gpsFixLast, sizeof(GPS_t));
+		gen = gpsFixGeneration;
+	} while (_gpsReadRetry(seq));
+	return gen;
+}
+
+/* append a fix to 'gpsHistory' (GPS thread only, inside a publish) */
+static void _gpsHistoryAdd(time_t when, const GPSPoint_t *gp)
+{
+	int last;
+
+	if (gpsHistoryCount > 0) {
+		last = (gpsHistoryHead + gpsHistoryCount - 1) % GPS_HISTORY_SIZE;
+		if (when == gpsHistory[last].when) {
+			gpsHistory[last].point = *gp;
+			return;
+		}
+		if (when < gpsHistory[last].when) {
+			/* system clock stepped back, the history is no longer ordered */
+			gpsHistoryHead = gpsHistoryCount = 0;
+		}
+	}
+	if (gpsHistoryCount < GPS_HISTORY_SIZE)
+		last = (gpsHistoryHead + gpsHistoryCount++) % GPS_HISTORY_SIZE;
+	else {
+		last = gpsHistoryHead;
+		gpsHistoryHead = (gpsHistoryHead + 1) % GPS_HISTORY_SIZE;
+	}
+	gpsHistory[last].when = when;
+	gpsHistory[last].point = *gp;
+}
+
+/* look up the position at 'when' in 'gpsHistory' */
+static utBool _gpsHistoryLookup(time_t when, GPSPoint_t *gp)
+{
+	int count = gpsHistoryCount, head = gpsHistoryHead;
+	int lo = 0, hi, mid;
+	const GPSHistory_t *h0, *h1;
+	double f;
+
+	if (count <= 0)
+		return utFalse;
+	hi = count - 1;
+	h0 = &gpsHistory[head];
+	h1 = &gpsHistory[(head + hi) % GPS_HISTORY_SIZE];
+	if (when <= h0->when) {
+		*gp = h0->point;		/* older than the history, use the oldest fix */
+		return utTrue;
+	}
+	if (when >= h1->when) {
+		*gp = h1->point;
+		return utTrue;
+	}
+
+	/* find the first entry at or after 'when' */
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (gpsHistory[(head + mid) % GPS_HISTORY_SIZE].when < when)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	h1 = &gpsHistory[(head + lo) % GPS_HISTORY_SIZE];
+	h0 = &gpsHistory[(head + lo - 1) % GPS_HISTORY_SIZE];
+	if (h1->when <= h0->when) {
+		*gp = h1->point;
+		return utTrue;
+	}
+
+	/* interpolate between the fixes either side of 'when' */
+	f = (double)(when - h0->when) / (double)(h1->when - h0->when);
+	gp->latitude = h0->point.latitude + (h1->point.latitude - h0->point.latitude) * f;
+	gp->longitude = h0->point.longitude + (h1->point.longitude - h0->point.longitude) * f;
+	return utTrue;
+}
+
+/* return the position at system time 'when' from the recent fix history */
+// The position is interpolated between the fixes received either side of
+// 'when', clamped to the oldest/newest fix.  Returns false if no fix has
+// been received.
+utBool gpsHistoryPointAt(time_t when, GPSPoint_t *gp)
+{
+	UInt32 seq;
+	GPSPoint_t pt;
+	utBool found;
+
+	do {
+		seq = _gpsReadBegin();
+		found = _gpsHistoryLookup(when, &pt);
+	} while (_gpsReadRetry(seq));
+	if (found)
+		*gp = pt;
+	return found;
+}
+
+/* true if 'gps' (of generation 'gen') is a valid fix not yet handed out */
+// In power saving mode each published fix is only returned as valid once.
+static bool _gpsFixAvailable(const GPS_t *gps, UInt32 gen)
+{
+	return gpsIsValid(gps) && (!gps_power_saving || (gpsFixConsumed != gen));
+}
+
+/* return the generation of the last published fix */
+// This changes whenever 'gpsFixLast' is updated, so a caller can tell that
+// nothing new has arrived without copying the fix.
+UInt32 gpsGetFixGeneration(void)
+{
+	return gpsFixGeneration;
+}
+
+/* true while the receiver is powered down between power saving wakes */
+// No fresh fix can arrive until the off-period ends, so don't wait for one.
+utBool gpsIsReceiverOff(void)
+{
+	return gpsReceiverOff;
+}
+
 /* get last aquired GPS fix */
 GPS_t *gpsGetLastGPS(GPS_t *gps, int maxAgeSec)
 {
-	GPS_t *gps_got;
+	GPS_t last;
+	UInt32 gen, used;
+
 	/* get latest fix */
-	GPS_LOCK {
-	if (gpsIsValid(&gpsFixLast)) {
-		gps_got = gpsCopy(gps, &gpsFixLast);
-		if (gps_power_saving)
-			gpsInvalidate(&gpsFixLast);
-	} else
-	if (gpsPointIsValid(&gpsFixLast.point)) {
-		if (utcGetTimerAgeSec(gpsFixLast.ageTimer) > maxAgeSec)
-			    // The last fix ('gpsFixLast') is stale.
-			gps_got = (GPS_t*)0; // GPSPoint is stale
-		else
-			gps_got = gpsCopy(gps, &gpsFixLast);
-			    // The last fix ('gpsFixLast') is stale, but the caller doesn't care
+	gen = _gpsReadLast(&last);
+	if (gpsIsValid(&last) && gps_power_saving) {
+		used = gpsFixConsumed;
+		if ((used == gen) || !__sync_bool_compare_and_swap(&gpsFixConsumed, used, gen))
+			gpsInvalidate(&last);	/* another caller already got this one */
 	}
-	else 
-		gps_got = (GPS_t*)0; // GPSPoint is stale
-	} GPS_UNLOCK
-	return gps_got;
+	if (gpsIsValid(&last))
+		return gpsCopy(gps, &last);
+	if (gpsPointIsValid(&last.point) && 
+		(utcGetTimerAgeSec(last.ageTimer) <= maxAgeSec))
+		// The last fix ('gpsFixLast') is stale, but the caller doesn't care
+		return gpsCopy(gps, &last);
+	return (GPS_t*)0; // GPSPoint is stale
+}
+
+/* get last aquired GPS fix, without handing it out */
+// Like 'gpsGetLastGPS', but a power saving fix is left for 'gpsAcquireWait'.
+// For readers that only want to know where we are.
+GPS_t *gpsPeekLastGPS(GPS_t *gps, int maxAgeSec)
+{
+	GPS_t last;
+
+	_gpsReadLast(&last);
+	if (gpsIsValid(&last) || (gpsPointIsValid(&last.point) && 
+		(utcGetTimerAgeSec(last.ageTimer) <= maxAgeSec)))
+		return gpsCopy(gps, &last);
+	return (GPS_t*)0;
 }
 
 int gpsAcquireWait(void)
 {
 	int err = -1;
 	struct timespec later;
+	GPS_t last;
 	GPS_LOCK {
-	while (!gpsIsValid(&gpsFixLast) && (gpsRunThread)) {
+	while (!_gpsFixAvailable(&last, _gpsReadLast(&last)) && (gpsRunThread)) {
 		if ((err = clock_gettime(CLOCK_REALTIME, &later)) != 0) {
 			perror("Realtime Clock");
 			return err;
@@ -644,20 +899,190 @@ int gpsAcquireWait(void)
 	} GPS_UNLOCK
 	return err;
 }
+
+#if defined(GPS_THREAD)
+/* copy the last fix into 'gps' if it is valid and at most 'maxAgeSec' old */
+// A 'maxAgeSec' below 0 accepts any valid fix.  Unlike 'gpsGetLastGPS', this
+// never consumes a power saving fix, which belongs to 'gpsAcquireWait'.
+static GPS_t *_gpsReadFresh(GPS_t *gps, int maxAgeSec)
+{
+	_gpsReadLast(gps);
+	if (!gpsIsValid(gps))
+		return (GPS_t*)0;
+	if ((maxAgeSec >= 0) && (utcGetTimerAgeSec(gps->ageTimer) > maxAgeSec))
+		return (GPS_t*)0;
+	return gps;
+}
+
+/* aquire GPS fix */
+// Returns the last fix if it is fresh, otherwise blocks until the GPS thread
+// publishes a fresh valid fix or 'timeoutMS' elapses.  A 'timeoutMS' of 0
+// just returns the latest fix that we have (if any).
+GPS_t *gpsAquire(GPS_t *gps, UInt32 timeoutMS)
+{
+	struct timespec deadline;
+	GPS_t *g;
+	int err = 0;
+
+	/* null gps pointer specified */
+	if (!gps)
+		return (GPS_t*)0;
+	g = _gpsReadFresh(gps, (timeoutMS == 0L)? -1 : GPS_AQUIRE_FRESH_SEC);
+	if ((timeoutMS == 0L) || g)
+		return g;
+
+	/* absolute deadline, so wakeups without a fresh fix don't extend it */
+	if (clock_gettime(CLOCK_REALTIME, &deadline) != 0) {
+		perror("Realtime Clock");
+		return (GPS_t*)0;
+	}
+	deadline.tv_sec += timeoutMS / 1000L;
+	deadline.tv_nsec += (timeoutMS % 1000L) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	GPS_LOCK {
+	__sync_fetch_and_add(&gpsFixWaiters, 1);
+	for (;;) {
+		if ((g = _gpsReadFresh(gps, GPS_AQUIRE_FRESH_SEC)) != (GPS_t*)0)
+			break;
+		if (!gpsRunThread || (err == ETIMEDOUT)) {
+			g = (GPS_t*)0;
+			break;
+		}
+		err = AQUIRE_WAIT(&deadline);
+	}
+	__sync_fetch_and_sub(&gpsFixWaiters, 1);
+	} GPS_UNLOCK
+	return g;
+}
+#endif
 // ----------------------------------------------------------------------------
 #if defined(GPS_THREAD)
-static char gps_line[GPS_BUF_SIZE];
+static char gps_rbuf[GPS_RBUF_SIZE];
+static int gps_rbuf_head;		/* start of unframed data in 'gps_rbuf' */
+static int gps_rbuf_tail;		/* end of data in 'gps_rbuf' */
 static char gps_command[GPS_SENTENCE_SIZE];
 static int fd1;
 // ----------------------------------------------------------------------------
+/* discard any buffered GPS data */
+static void gps_rbuf_reset(void)
+{
+	gps_rbuf_head = gps_rbuf_tail = 0;
+}
+
+/* append whatever is available on the GPS port to 'gps_rbuf' */
+// A single read may return part of a sentence, or several sentences.
+static int gps_rbuf_fill(int fd)
+{
+	int n;
+
+	/* move any partial sentence to the front of the buffer */
+	if (gps_rbuf_head > 0) {
+		gps_rbuf_tail -= gps_rbuf_head;
+		if (gps_rbuf_tail > 0)
+			memmove(gps_rbuf, gps_rbuf + gps_rbuf_head, gps_rbuf_tail);
+		gps_rbuf_head = 0;
+	}
+	/* a full buffer without a sentence terminator is noise */
+	if (gps_rbuf_tail >= GPS_RBUF_SIZE)
+		gps_rbuf_tail = 0;
+	if ((n = read(fd, gps_rbuf + gps_rbuf_tail, GPS_RBUF_SIZE - gps_rbuf_tail)) > 0)
+		gps_rbuf_tail += n;
+	return n;
+}
+
+/* return the next complete "$...<LF>" sentence in 'gps_rbuf' */
+// Returns NULL if no complete sentence is buffered.  The sentence remains
+// valid until the next call to 'gps_rbuf_fill'.
+static char *gps_rbuf_next(int *len)
+{
+	char *start = NULL, *p = gps_rbuf + gps_rbuf_head, *end = gps_rbuf + gps_rbuf_tail;
+
+	for (; p < end; p++) {
+		if (*p == '$') {
+			/* restart at every '$', a sentence may have lost its tail */
+			start = p;
+		}
+		else if (*p == '\n' && start) {
+			*len = p - start + 1;
+			gps_rbuf_head = (p + 1) - gps_rbuf;
+			return start;
+		}
+	}
+	/* keep only the partial sentence (if any) */
+	gps_rbuf_head = start? (start - gps_rbuf) : gps_rbuf_tail;
+	return NULL;
+}
+
+/* return the next complete UBX frame in 'gps_rbuf' */
+static char *gps_rbuf_next_ubx(int *len)
+{
+	int start;
+
+	if (ubxNextFrame((UInt8 *)gps_rbuf + gps_rbuf_head, gps_rbuf_tail - gps_rbuf_head,
+			&start, len) == UBX_FRAME_OK) {
+		char *frame = gps_rbuf + gps_rbuf_head + start;
+		gps_rbuf_head += start + *len;
+		return frame;
+	}
+	gps_rbuf_head += start;
+	return NULL;
+}
+/* record motion activity reported outside the GPS (ie. RFID motion tags) */
+// In power saving mode this keeps the GPS off-period from growing.
+void gpsNoteMotionActivity(void)
+{
+	gps_activity_time = time(NULL);
+}
+
+/* choose the next GPS off-period in power saving mode */
+// Moving, recent motion activity, or a nearby geozone boundary selects the
+// shortest period.  While parked and quiet the period doubles on each wake,
+// from 'gps_power_saving_cycle' up to 'gps_duty_max'.
+static uint32_t gps_next_sleep_period(bool fixed)
+{
+	bool active = motionIsInMotion() || 
+		((time(NULL) - gps_activity_time) < (time_t)gps_duty_period);
+
+	if (fixed) {
+		if (gpsFixUnsafe.speedKPH >= (float)gps_duty_kph)
+			active = true;
+		else if (gpsPointIsValid(&gps_duty_point) &&
+			(gpsMetersToPoint(&gps_duty_point, &gpsFixUnsafe.point) >= gpsDistanceDelta))
+			active = true;	/* moved while the GPS was off */
+#if defined(ENABLE_GEOZONE)
+		else {
+			double d = geozBoundaryMeters(&gpsFixUnsafe.point);
+			if ((d >= 0.0) && (d < (double)gps_duty_zone))
+				active = true;
+		}
+#endif
+		gps_duty_point = gpsFixUnsafe.point;
+	}
+	if (active)
+		gps_duty_period = gps_duty_min;
+	else if (!fixed)
+		gps_duty_period = gps_power_saving_cycle;	/* no fix, no evidence either way */
+	else if (gps_duty_period < gps_power_saving_cycle)
+		gps_duty_period = gps_power_saving_cycle;
+	else if (gps_duty_period < gps_duty_max) {
+		gps_duty_period *= 2;
+		if (gps_duty_period > gps_duty_max)
+			gps_duty_period = gps_duty_max;
+	}
+	return gps_duty_period;
+}
+// ----------------------------------------------------------------------------
 void * gps_thread_main(void * arg)
 {
-	int i, n, nwake = 0;
+	int n, nwake = 0;
 	time_t now;
 	char * sentence;
-	struct sigevent sev3;
-	struct itimerspec it3;
-	timer_t timer3;
+	NMEAFields_t nmea;
+	struct pollfd fds1;
 
 	/*open GPS port*/
 	if (!_gpsOpen(true)) {
@@ -666,202 +1091,213 @@ void * gps_thread_main(void * arg)
 		return NULL;
 	}
 	fd1 = gpsCom.read_fd;
-	/*setup timer */
-	sev3.sigev_notify = SIGEV_SIGNAL;
-	sev3.sigev_signo = SIG_TIMEOUT;
-	sev3.sigev_value.sival_int = TIMER_GPS_1;
-	i = timer_create(CLOCK_REALTIME, &sev3, &timer3);
-	it3.it_interval.tv_sec = GPS_PORT_TIMEOUT;
-	it3.it_interval.tv_nsec = 0;
-	it3.it_value.tv_sec = GPS_PORT_TIMEOUT;
-	it3.it_value.tv_nsec = 0;
-	memset(gps_line, 0, GPS_BUF_SIZE);
-	sentence = gps_line;
-	i = 0;
+	fds1.fd = fd1;
+	fds1.events = POLLIN;
+	gps_rbuf_reset();
 	gps_led = LED_OFF;
 	while (gpsRunThread) {
-		timer_settime(timer3, 0, &it3, NULL);
-		if ((n = read(fd1, sentence, GPS_SENTENCE_SIZE)) < 0) {
-			w2sg0004_pc15_high();    /* GPS LED off if read error*/
-			if (errno == EINTR && gps_port_timeout == -1) {
-				printf("Reset GPS chip\n");
-					gpsClear(&gpsFixLast);
-					gpsClear(&gpsFixUnsafe);
-				_gpsClose(true);
-				sleep(60);
-				_gpsOpen(true);
-				fd1 = gpsCom.read_fd;
-				gps_port_timeout = 0;
-				continue;
-			}
-		}
-		print_data(n, sentence);
-		if (strncmp(sentence + 1, "GPGGA", 5) == 0) {
-//			print_data(n, sentence);
-			parse_gga(sentence);
+		if ((n = poll(&fds1, 1, GPS_PORT_TIMEOUT * 1000)) == 0) {
+			/* nothing from the GPS port for GPS_PORT_TIMEOUT */
+			w2sg0004_pc15_high();    /* GPS LED off */
+			printf("Reset GPS chip\n");
+				_gpsPublishBegin();
+				gpsClear(&gpsFixLast);
+				_gpsPublishEnd();
+				gpsClear(&gpsFixUnsafe);
+			_gpsClose(true);
+			sleep(60);
+			_gpsOpen(true);
+			fds1.fd = fd1 = gpsCom.read_fd;
+			gps_rbuf_reset();
+			continue;
 		}
-		else if (strncmp(sentence + 1, "GPGSA", 5) == 0) {
-//			print_data(n, sentence);
-			parse_gsa(sentence);
-		}
-		else if (strncmp(sentence + 1, "GPRMC", 5) == 0) {
-//			print_data(n, sentence);
-			parse_rmc(sentence);
-			now = time(NULL); 
+		if (n < 0 || (n = gps_rbuf_fill(fd1)) <= 0) {
+			w2sg0004_pc15_high();    /* GPS LED off if read error*/
+			if (n == 0 || errno != EINTR)
+				sleep(1);
+			continue;
 		}
-		if (gpsIsValid(&gpsFixUnsafe)) {
-				long tdiff;
-				GPS_LOCK
-				if (!gpsIsValid(&gpsFixLast))
-					AQUIRE_NOTIFY
-				gpsCopy(&gpsFixLast, &gpsFixUnsafe);
-				GPS_UNLOCK
-				if (clock_source & CLOCK_SYNC_GPS) {
-					tdiff = gpsFixUnsafe.fixtime - now;
-					if (tdiff > time_delta || tdiff < -time_delta) {
-						synchronize_system_clock(gpsFixUnsafe.fixtime);
+		while ((sentence = gps_binary? gps_rbuf_next_ubx(&n) : gps_rbuf_next(&n)) != NULL) {
+			if (gps_binary)
+				n = dispatch_ubx((UInt8 *)sentence, n);
+			else {
+				print_data(n, sentence);
+				n = dispatch_sentence(sentence, n, &nmea);
+			}
+			if (n == 0)
+				now = time(NULL); 
+			if (gpsIsValid(&gpsFixUnsafe)) {
+					long tdiff;
+					bool waking = gps_power_saving || !gpsIsValid(&gpsFixLast);
+					_gpsPublishBegin();
+					gpsCopy(&gpsFixLast, &gpsFixUnsafe);
+					_gpsHistoryAdd(time(NULL), &gpsFixUnsafe.point);
+					_gpsPublishEnd();
+					if (waking || gpsFixWaiters) {
+						/* new fix to hand out, wake 'gpsAcquireWait'/'gpsAquire' */
+						GPS_LOCK
+						AQUIRE_NOTIFY
+						GPS_UNLOCK
 					}
-				}
-				gpsFixValid = utTrue;
-		}
-		else {
-			if (gpsPointIsValid(&gpsFixLast.point)) {
-					GPS_LOCK
-					gpsFixLast.nmea = gpsFixUnsafe.nmea;
-					if (now - gpsFixLast.fixtime > gpsExpireInterval)  {
-						gpsClear(&gpsFixLast);
+					if (clock_source & CLOCK_SYNC_GPS) {
+						tdiff = gpsFixUnsafe.fixtime - now;
+						if (tdiff > time_delta || tdiff < -time_delta) {
+							synchronize_system_clock(gpsFixUnsafe.fixtime);
+						}
+					}
+					gpsFixValid = utTrue;
+			}
+			else {
+				if (gpsPointIsValid(&gpsFixLast.point)) {
+						_gpsPublishBegin();
+						gpsFixLast.nmea = gpsFixUnsafe.nmea;
+						if (time(NULL) - gpsFixLast.fixtime > gpsExpireInterval)  {
+							gpsClear(&gpsFixLast);
+						}
+						_gpsPublishEnd();
 					}
-					GPS_UNLOCK
+					if (gps_power_saving)
+						nwake++;
+			}
+
+			if (gps_power_saving && (nwake > GPS_POWER_SAVING_WAKE_PERIOD || gpsFixValid)) {
+				uint32_t period = gps_next_sleep_period(gpsFixValid);
+				_gpsClose(false);
+				gpsReceiverOff = utTrue;
+				if (gps_debug)
+					printf("GPS off for %u sec\n", period);
+				if (sleep((period > (uint32_t)nwake)? (period - nwake) : 1) > 0) {
+					sleep(2);
+					if (!gpsRunThread)
+						break;
 				}
-				if (gps_power_saving)
-					nwake++;
-		}
-	
-		if (++i == GPS_READ_LINES) {
-			memset(gps_line, 0, GPS_BUF_SIZE);
-			i = 0;
-			sentence = gps_line;
-		}
-		else
-			sentence += GPS_SENTENCE_SIZE;
-
-		if (gps_power_saving && (nwake > GPS_POWER_SAVING_WAKE_PERIOD || gpsFixValid)) {
-			it3.it_value.tv_sec = 0;
-			it3.it_value.tv_nsec = 0;
-			timer_settime(timer3, 0, &it3, NULL);
-			_gpsClose(false);
-			if (sleep(gps_power_saving_cycle - nwake) > 0) {
-				sleep(2);
-				if (!gpsRunThread)
-					break;
+				_gpsOpen(false);
+				gpsReceiverOff = utFalse;
+				fds1.fd = fd1 = gpsCom.read_fd;
+				gps_rbuf_reset();
+				/*initialize GPS*/
+				if (!gps_binary) {
+					make_nav_init(gps_command);
+					checksum_nema(gps_command);
+					usleep(100000);
+					write(fd1, gps_command, strlen(gps_command));
+				}
+				nwake = 0;
+				gpsFixValid = utFalse;
+				break;
 			}
-			_gpsOpen(false);
-			fd1 = gpsCom.read_fd;
-			/*initialize GPS*/
-			make_nav_init(gps_command);
-			checksum_nema(gps_command);
-			usleep(100000);
-			write(fd1, gps_command, strlen(gps_command));
-			nwake = 0;
-			gpsFixValid = utFalse;
 		}
 	}
 	_gpsClose(true);
 	gpsRunThread = 0;
 	return NULL;
 }
-int parse_rmc(char *sentence)
+/* tokenize a sentence and pass it to its parser in 'nmeaSentenceTable' */
+// Returns the parser's result (0 if the sentence gave fix data), or -1 if it
+// was rejected or not supported.  Supported sentences without a '*hh'
+// checksum are rejected.  Only malformed sentences count as errors.
+static int dispatch_sentence(char *sentence, int n, NMEAFields_t *f)
+{
+	NMEASentence_t *ns;
+	const char *addr;
+	int rc = nmeaTokenize(sentence, n, f);
+
+	if (rc <= 0) {
+		gpsSentenceErrors++;
+		if (gps_debug)
+			printf("NMEA %s [%u]\n", (rc == NMEA_ERR_CHECKSUM)? "checksum error" : "format error", 
+				gpsSentenceErrors);
+		return -1;
+	}
+	/* "ttFFF": 2 character talker ID, followed by the formatter */
+	addr = f->field[0];
+	if ((strlen(addr) != 5) || (*addr == 'P'))
+		return -1; // proprietary sentence
+	for (ns = nmeaSentenceTable; ns->formatter; ns++) {
+		if (strcmp(addr + 2, ns->formatter) == 0)
+			break;
+	}
+	if (!ns->formatter)
+		return -1;
+	/* fix data is only trusted with a verified checksum */
+	if (!f->hasChecksum) {
+		gpsSentenceErrors++;
+		if (gps_debug)
+			printf("NMEA %s no checksum [%u]\n", addr, gpsSentenceErrors);
+		return -1;
+	}
+	return (*ns->ftn)(f);	// -1 for a sentence without a fix, not an error
+}
+/* decode a UBX frame into 'gpsFixUnsafe' */
+// NAV-PVT stands in for RMC+GGA, NAV-DOP for GSA, so 'gpsIsValid' applies
+// unchanged.  Returns 0 if the frame was used, -1 otherwise.
+static int dispatch_ubx(UInt8 *frame, int n)
+{
+	UInt8 *payload = frame + UBX_HEADER_SIZE;
+	int plen = n - UBX_OVERHEAD;
+
+	if (frame[2] != UBX_CLASS_NAV)
+		return -1;
+	switch (frame[3]) {
+	case UBX_NAV_PVT:
+		if (ubxDecodeNavPVT(payload, plen, &gpsFixUnsafe)) {
+			gps_signal_state(true);
+			gpsFixUnsafe.ageTimer = utcGetTimer();
+			gpsFixUnsafe.nmea |= (NMEA0183_GPRMC | NMEA0183_GPGGA);
+		} else {
+			gps_signal_state(false);
+			gpsFixUnsafe.nmea &= ~(NMEA0183_GPRMC | NMEA0183_GPGGA);
+		}
+		return 0;
+	case UBX_NAV_DOP:
+		if (ubxDecodeNavDOP(payload, plen, &gpsFixUnsafe))
+			gpsFixUnsafe.nmea |= NMEA0183_GPGSA;
+		return 0;
+	}
+	return -1;
+}
+/* $xxRMC: time, status, lat, N/S, lon, E/W, knots, course, date, ... */
+int parse_rmc(NMEAFields_t *f)
 {
-	char item[5][32];
-	struct tm utctm;
-	float times = 0.0;
-	float lati = 0.0, longi = 0.0;
-	float knots = 0.0, angles = 0.0;
-	int idate = 0;
-	char flag = '\0', north = '\0', west = '\0';
-	char dtype[8];
-	int items, itime, iyear;	
-	time_t fixtime;
+	Int32 knots, angles;
+	UInt32 fixtime;
 	int result = -1;
-	int i = 0;
-/*	items = sscanf(sentence, "%6s,%f,%c,%f,%c,%f,%c,%f,%f,%d", dtype,
-		&times, &flag, &lati, &north, &longi, &west, &knots, 
-		&angles, &idate);
-*/
-	while(sentence[i] != '\n') {
-                if(sentence[i] == ',') sentence[i] = ' ';
-                i++;
-        }
-	items = sscanf(sentence, "%6s %s %c %s %c %s %c %s %s %d", dtype,
-		item[0], &flag, item[1], &north, item[2], &west, item[3], 
-		item[4], &idate);
-	times = str_to_f(item[0]);
-	lati = str_to_f(item[1]);
-	longi = str_to_f(item[2]);
-	knots = str_to_f(item[3]);
-	angles = str_to_f(item[4]);
-
-	if (flag == 'A') {
-		itime = (int)times;
-		utctm.tm_sec = itime % 100;
-		itime /= 100;
-		utctm.tm_min = itime % 100;
-		itime /= 100;
-		utctm.tm_hour = itime;
-		iyear = idate % 100;
-		idate /= 100;
-		if (iyear < 70)
-			iyear += 100;
-		utctm.tm_year = iyear;
-		utctm.tm_mon = idate % 100 - 1;
-		idate /= 100;
-		utctm.tm_mday = idate;
-		utctm.tm_isdst = 0;
-		utctm.tm_gmtoff = 0;
-		fixtime = mktime(&utctm);
+
+	if (*nmeaField(f, 2) == 'A') {
+		fixtime = nmeaFixTime(nmeaField(f, 9), nmeaField(f, 1));
 		if (fixtime > 0) {
+			if (!nmeaParseFixed(nmeaField(f, 7), 3, &knots))
+				knots = 0;
+			if (!nmeaParseFixed(nmeaField(f, 8), 2, &angles))
+				angles = 0;
 			gpsFixUnsafe.fixtime = fixtime;
-			gpsFixUnsafe.speedKPH = knots * KILOMETERS_PER_KNOT;
-			gpsFixUnsafe.heading = angles;
+			gpsFixUnsafe.speedKPH = (float)knots * (KILOMETERS_PER_KNOT / 1000.0);
+			gpsFixUnsafe.heading = (float)angles / 100.0;
 			gpsFixUnsafe.ageTimer = utcGetTimer();
 			gpsFixUnsafe.nmea |= NMEA0183_GPRMC;
 			result = 0;
 		}
 	}
 	else
-		gpsFixUnsafe.nmea &= ~NMEA0183_GPRMC;
+		gpsFixUnsafe.nmea &= ~(NMEA0183_GPRMC | NMEA0183_GPVTG);
 		
 	return result;
 }
-int parse_gsa(char *sentence)
+/* $xxGSA: mode, fix type, 12 x PRN, PDOP, HDOP, VDOP */
+int parse_gsa(NMEAFields_t *f)
 {
-	char item[3][32];
-	int items = 0, mode = 0;	
-	float pdop = 0.0, hdop = 0.0, vdop = 0.0;
-	char dtype[8];
-	char manual = '\0';
-	char *ppdop;
+	Int32 mode = 0, pdop = 0, hdop = 0, vdop = 0;
 	int result = -1;
-	int i = 0;
-	items = sscanf(sentence, "%6s,%c,%d", dtype, &manual, &mode);
+
+	nmeaParseFixed(nmeaField(f, 2), 0, &mode);
 	if (mode > 1) {
-		ppdop = strchr(sentence, '.');
-		if (ppdop == NULL)
+		if (!nmeaParseFixed(nmeaField(f, 15), 2, &pdop) ||
+			!nmeaParseFixed(nmeaField(f, 16), 2, &hdop) ||
+			!nmeaParseFixed(nmeaField(f, 17), 2, &vdop))
 			return result;
-		while (*(--ppdop) != ',')  ;;
-		++ppdop;
-		while(sentence[i] != '\n') {
-                	if(sentence[i] == ',') sentence[i] = ' ';
-                	i++;
-        	}
-//		items = sscanf(ppdop, "%f,%f,%f", &pdop, &hdop, &vdop);
-		items = sscanf(ppdop, "%s %s %s", item[0], item[1], item[2]);
-		pdop = str_to_f(item[0]);
-		hdop = str_to_f(item[1]);
-		vdop = str_to_f(item[2]);
-		gpsFixUnsafe.pdop = pdop;
-		gpsFixUnsafe.vdop = vdop;
-		gpsFixUnsafe.hdop = hdop;
+		gpsFixUnsafe.pdop = (float)pdop / 100.0;
+		gpsFixUnsafe.vdop = (float)vdop / 100.0;
+		gpsFixUnsafe.hdop = (float)hdop / 100.0;
 		gpsFixUnsafe.nmea |= NMEA0183_GPGSA;
 		result = 0;
 	}
@@ -869,41 +1305,42 @@ int parse_gsa(char *sentence)
 		gpsFixUnsafe.nmea &= ~NMEA0183_GPGSA;
 	return result;
 }
-int parse_gga(char *sentence)
+/* $xxGGA: time, lat, N/S, lon, E/W, quality, #sats, HDOP, altitude, M, ... */
+int parse_gga(NMEAFields_t *f)
 {
-	char item[5][32];
-	float times = 0.0, hdop = 0.0, altitude = 0.0;
-	double lati = 0.0, longi = 0.0;
-	int items = 0, nsat = 0, fixtype = 0;	
-	char dtype[8];
-	double lat_m, lon_m;
-	long lat_d, lon_d; 
-	char north = '\0', west = '\0', unit = '\0';
+	Int32 fixtype = 0, lati = 0, longi = 0, altitude = 0;
 	int result = -1;
-	int i = 0;
+
+	nmeaParseFixed(nmeaField(f, 6), 0, &fixtype);
+	if (((fixtype == 1) || (fixtype == 2)) &&
+		nmeaParseLatLon(nmeaField(f, 2), nmeaField(f, 3), &lati) &&
+		nmeaParseLatLon(nmeaField(f, 4), nmeaField(f, 5), &longi)) {
+		gps_signal_state(true);
+
+		if (!nmeaParseFixed(nmeaField(f, 9), 1, &altitude))
+			altitude = 0;
+		gpsFixUnsafe.point.latitude = (double)lati / NMEA_LATLON_SCALE;
+		gpsFixUnsafe.point.longitude = (double)longi / NMEA_LATLON_SCALE;
+		gpsFixUnsafe.fixtype = fixtype;
+		gpsFixUnsafe.altitude = (float)altitude / 10.0;
+		gpsFixUnsafe.nmea |= NMEA0183_GPGGA;
+		result = 0;
+	}
+	else {					// gps is not registered
+		gps_signal_state(false);
+		gpsFixUnsafe.nmea &= ~NMEA0183_GPGGA;
+	}
+	return result;
+}
+/* update GPS LED and 'GPS lost' diagnostic from the receiver fix status */
+static void gps_signal_state(bool locked)
+{
 	static int report_gps_lost = 0;
 	static unsigned int gps_lost_count = 0;
-	unsigned int gps_lost_tolerance = propGetUInt32(PROP_GPS_LOST_COUNTER, 0);
 	static bool gps_lost = false;
-/*	items = sscanf(sentence, "%6s,%f,%lf,%c,%lf,%c,%d,%d,%f,%f,%c",  dtype, 
-		&times, &lati, &north, &longi, &west, &fixtype, &nsat, &hdop,
-		&altitude, &unit);
-*/
-	while(sentence[i] != '\n') {
-                if(sentence[i] == ',') sentence[i] = ' ';
-                i++;
-        }
-        items = sscanf(sentence, "%6s %s %s %c %s %c %d %d %s %s %c",
-                dtype, item[0], item[1], &north, item[2], &west, 
-		&fixtype, &nsat, item[3], item[4], &unit);
-
-	times = str_to_f(item[0]);
-	lati = str_to_d(item[1]);
-	longi = str_to_d(item[2]);
-	hdop = str_to_f(item[3]);
-	altitude = str_to_f(item[4]);
-
-	if ((fixtype == 1) || (fixtype == 2)) {
+	unsigned int gps_lost_tolerance;
+
+	if (locked) {
 		w2sg0004_pc15_low(); /* GPS LED on*/
 		if (report_gps_lost) {
 			diagnostic_report(DIAGNOSTIC_GPS_LOST, 0, NULL);
@@ -913,42 +1350,38 @@ int parse_gga(char *sentence)
 			gps_lost = false;
 		}
 		gps_lost_count = 0;
-
-		lati /= 100.0;
-		longi /= 100.0;
-		lat_d = (long)lati;
-		lon_d = (long)longi;
-		lat_m = lati - lat_d;
-		lon_m = longi  - lon_d;
-		if (north == 'N')
-			gpsFixUnsafe.point.latitude = lat_d + lat_m * (10.0 / 6.0);
-		else
-			gpsFixUnsafe.point.latitude = -(lat_d + lat_m * (10.0 / 6.0));
-		if (west == 'W')
-			gpsFixUnsafe.point.longitude = -(lon_d + lon_m * (10.0 / 6.0));
-		else
-			gpsFixUnsafe.point.longitude = lon_d + lon_m * (10.0 / 6.0);
-		gpsFixUnsafe.fixtype = fixtype;
-		gpsFixUnsafe.altitude = altitude;
-		gpsFixUnsafe.nmea |= NMEA0183_GPGGA;
-		result = 0;
+		return;
 	}
-	else {					// gps is not registered
-		w2sg0004_pc15_high();    /* GPS LED off */
-		if(!gps_lost && (gps_lost_count >= gps_lost_tolerance)) {
-			printf("GPS lost\n");
-			gps_lost = true;
-		} else if (!gps_lost && (gps_lost_count < gps_lost_tolerance)) {
-			printf("GPS lost times %d\n", gps_lost_count);
-			gps_lost_count++;
-		}
-		if (gps_lost && !report_gps_lost) {
-			diagnostic_report(DIAGNOSTIC_GPS_LOST, 1, NULL);
-			report_gps_lost = 1;
-		}
-		gpsFixUnsafe.nmea &= ~NMEA0183_GPGGA;
+	w2sg0004_pc15_high();    /* GPS LED off */
+	gps_lost_tolerance = propGetUInt32(PROP_GPS_LOST_COUNTER, 0);
+	if(!gps_lost && (gps_lost_count >= gps_lost_tolerance)) {
+		printf("GPS lost\n");
+		gps_lost = true;
+	} else if (!gps_lost && (gps_lost_count < gps_lost_tolerance)) {
+		printf("GPS lost times %d\n", gps_lost_count);
+		gps_lost_count++;
 	}
-	return result;
+	if (gps_lost && !report_gps_lost) {
+		diagnostic_report(DIAGNOSTIC_GPS_LOST, 1, NULL);
+		report_gps_lost = 1;
+	}
+}
+
+/* $xxVTG: course, T, course, M, knots, N, kph, K[, mode] */
+// Only updates speed/heading of a fix already established by $xxRMC
+int parse_vtg(NMEAFields_t *f)
+{
+	Int32 kph, angles;
+
+	if ((*nmeaField(f, 9) == 'N') || !(gpsFixUnsafe.nmea & NMEA0183_GPRMC))
+		return -1;	// data not valid
+	if (!nmeaParseFixed(nmeaField(f, 7), 3, &kph))
+		return -1;
+	gpsFixUnsafe.speedKPH = (float)kph / 1000.0;
+	if (nmeaParseFixed(nmeaField(f, 1), 2, &angles))
+		gpsFixUnsafe.heading = (float)angles / 100.0;
+	gpsFixUnsafe.nmea |= NMEA0183_GPVTG;
+	return 0;
 }
 
 int synchronize_system_clock(time_t new_time)
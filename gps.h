@@ -65,13 +65,19 @@ extern uint32_t gps_power_saving_cycle;
 
 void gpsInitialize(eventAddFtn_t queueEvent);
 void gpsReloadParameter(void);
+void gpsNoteMotionActivity(void);
 
 #if !defined(GPS_THREAD)
 utBool gpsCheckMinimum(GPS_t *gps0, GPS_t *gps1)
 #endif
 int gpsAcquireWait(void);
+GPS_t *gpsAquire(GPS_t *gps, UInt32 timeoutMS);
 
 GPS_t *gpsGetLastGPS(GPS_t *gps, int maxAgeSec);
+GPS_t *gpsPeekLastGPS(GPS_t *gps, int maxAgeSec);
+UInt32 gpsGetFixGeneration(void);
+utBool gpsIsReceiverOff(void);
+utBool gpsHistoryPointAt(time_t when, GPSPoint_t *gp);
 
 int synchronize_system_clock(time_t new_time);
 // ----------------------------------------------------------------------------
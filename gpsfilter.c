@@ -0,0 +1,247 @@
+// ----------------------------------------------------------------------------
+// Description:
+//  Optional GPS fix smoothing, applied to each sampled fix before it is passed
+//  to the GPS event modules (motion, odometer, geozone).
+// Notes:
+//  - Each axis (east/north, in meters from a local reference point) is
+//    tracked by an independent constant-velocity Kalman filter, updated with
+//    the reported position and the reported speed/heading.
+//  - A stationary detector holds the position at the average of the fixes
+//    seen while parked, and reports a speed of 0, so position jitter does not
+//    produce phantom motion or odometer creep.
+//  - Enabled by PROP_GPS_FILTER ("gps.filter").  Tuning properties:
+//      PROP_GPS_FILTER_ACCEL   - process noise, expected acceleration (m/s/s)
+//      PROP_GPS_FILTER_STILL   - below this speed (kph) the vehicle may be parked
+//      PROP_GPS_FILTER_RADIUS  - leaving this radius (meters) ends 'parked'
+// ----------------------------------------------------------------------------
+
+#include "defaults.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "log.h"
+
+#include "stdtypes.h"
+#include "gpstools.h"
+
+#include "propman.h"
+
+#include "gpsfilter.h"
+
+// ----------------------------------------------------------------------------
+
+#define METERS_PER_DEGREE       (EARTH_RADIUS_METERS * RADIANS)
+#define FILTER_MAX_GAP_SEC      300L        // reset if fixes are further apart
+#define FILTER_MAX_RANGE_M      50000.0     // reset if this far from the reference
+#define FILTER_UERE_M           5.0         // position error per unit of HDOP
+#define FILTER_MIN_POS_SIGMA_M  3.0
+#define FILTER_VEL_SIGMA_MPS    0.5         // reported (doppler) speed error
+#define FILTER_STILL_COUNT      3           // slow fixes needed to declare 'parked'
+#define FILTER_ANCHOR_WEIGHT    30          // max fixes averaged into the parked position
+
+/* one axis: position/velocity, and its covariance */
+typedef struct {
+    double          pos;        // meters
+    double          vel;        // meters/sec
+    double          pp, pv, vv; // covariance
+} FilterAxis_t;
+
+static utBool       filterInit = utFalse;
+static time_t       filterTime = 0L;
+static GPSPoint_t   filterRef;
+static double       filterRefCos = 1.0;
+static FilterAxis_t filterE, filterN;
+
+static utBool       filterParked = utFalse;
+static int          filterSlowCount = 0;
+static int          filterAnchorCount = 0;
+static double       filterAnchorE = 0.0, filterAnchorN = 0.0;
+
+/* last filtered output, returned again for a repeated fix */
+static GPSPoint_t   filterOutPoint;
+static float        filterOutKPH = 0.0;
+static float        filterOutHeading = 0.0;
+
+// ----------------------------------------------------------------------------
+
+static void _filterAxisInit(FilterAxis_t *a, double pos, double vel, double posVar)
+{
+    a->pos = pos;
+    a->vel = vel;
+    a->pp  = posVar;
+    a->pv  = 0.0;
+    a->vv  = FILTER_VEL_SIGMA_MPS * FILTER_VEL_SIGMA_MPS;
+}
+
+/* advance by 'dt' seconds, with acceleration variance 'q' */
+static void _filterAxisPredict(FilterAxis_t *a, double dt, double q)
+{
+    double dt2 = dt * dt;
+    a->pos += a->vel * dt;
+    a->pp  += (2.0 * a->pv * dt) + (a->vv * dt2) + (q * dt2 * dt2 / 4.0);
+    a->pv  += (a->vv * dt) + (q * dt2 * dt / 2.0);
+    a->vv  += q * dt2;
+}
+
+/* update with a measured position (variance 'r') */
+static void _filterAxisPosition(FilterAxis_t *a, double z, double r)
+{
+    double s = a->pp + r;
+    double kp = a->pp / s, kv = a->pv / s, y = z - a->pos;
+    a->pos += kp * y;
+    a->vel += kv * y;
+    a->vv  -= kv * a->pv;
+    a->pp  *= (1.0 - kp);
+    a->pv  *= (1.0 - kp);
+}
+
+/* update with a measured velocity (variance 'r') */
+static void _filterAxisVelocity(FilterAxis_t *a, double z, double r)
+{
+    double s = a->vv + r;
+    double kp = a->pv / s, kv = a->vv / s, y = z - a->vel;
+    a->pos += kp * y;
+    a->vel += kv * y;
+    a->pp  -= kp * a->pv;
+    a->pv  *= (1.0 - kv);
+    a->vv  *= (1.0 - kv);
+}
+
+/* remember the output for 'filterTime' */
+static GPS_t *_filterOutput(GPS_t *gps)
+{
+    filterOutPoint   = gps->point;
+    filterOutKPH     = gps->speedKPH;
+    filterOutHeading = gps->heading;
+    return gps;
+}
+
+// ----------------------------------------------------------------------------
+
+/* initialize filter */
+void gpsFilterInitialize()
+{
+    gpsFilterReset();
+}
+
+/* discard the filter state, the next fix restarts the filter */
+void gpsFilterReset()
+{
+    filterInit = utFalse;
+    filterParked = utFalse;
+    filterSlowCount = 0;
+    filterAnchorCount = 0;
+}
+
+/* smooth 'gps' in place */
+// The point, speed and heading of 'gps' are replaced with the filtered
+// values.  Returns 'gps'.  Does nothing if the filter is disabled.
+GPS_t *gpsFilterApply(GPS_t *gps)
+{
+    if (!gps || !gpsPointIsValid(&gps->point)) {
+        return gps;
+    }
+    if (!propGetBoolean(PROP_GPS_FILTER, utFalse)) {
+        filterInit = utFalse;
+        return gps;
+    }
+
+    /* measurement in local meters */
+    double posSigma = (gps->accuracy > GPS_UNDEFINED_ACCURACY)? gps->accuracy : (gps->hdop * FILTER_UERE_M);
+    if (posSigma < FILTER_MIN_POS_SIGMA_M) { posSigma = FILTER_MIN_POS_SIGMA_M; }
+    double r  = posSigma * posSigma;
+    double mps = gps->speedKPH / 3.6;
+    double ve = mps * sin(gps->heading * RADIANS);
+    double vn = mps * cos(gps->heading * RADIANS);
+    double ze, zn;
+
+    /* the main loop may hand over the same fix again, it carries no new data */
+    long dt = filterInit? (long)(gps->fixtime - filterTime) : 0L;
+    if (filterInit && (dt == 0L)) {
+        gps->point    = filterOutPoint;
+        gps->speedKPH = filterOutKPH;
+        gps->heading  = filterOutHeading;
+        return gps;
+    }
+
+    /* (re)start */
+    if (!filterInit || (dt < 0L) || (dt > FILTER_MAX_GAP_SEC)) {
+        filterRef    = gps->point;
+        filterRefCos = cos(filterRef.latitude * RADIANS);
+        _filterAxisInit(&filterE, 0.0, ve, r);
+        _filterAxisInit(&filterN, 0.0, vn, r);
+        filterTime   = gps->fixtime;
+        filterInit   = utTrue;
+        filterParked = utFalse;
+        filterSlowCount = 0;
+        return _filterOutput(gps);
+    }
+    ze = (gps->point.longitude - filterRef.longitude) * METERS_PER_DEGREE * filterRefCos;
+    zn = (gps->point.latitude  - filterRef.latitude ) * METERS_PER_DEGREE;
+    if ((fabs(ze) > FILTER_MAX_RANGE_M) || (fabs(zn) > FILTER_MAX_RANGE_M)) {
+        filterInit = utFalse;
+        return gpsFilterApply(gps);
+    }
+
+    /* predict/update */
+    double accel = propGetDouble(PROP_GPS_FILTER_ACCEL, 1.0);
+    double q = accel * accel;
+    _filterAxisPredict(&filterE, (double)dt, q);
+    _filterAxisPredict(&filterN, (double)dt, q);
+    _filterAxisVelocity(&filterE, ve, FILTER_VEL_SIGMA_MPS * FILTER_VEL_SIGMA_MPS);
+    _filterAxisVelocity(&filterN, vn, FILTER_VEL_SIGMA_MPS * FILTER_VEL_SIGMA_MPS);
+    filterTime = gps->fixtime;
+    _filterAxisPosition(&filterE, ze, r);
+    _filterAxisPosition(&filterN, zn, r);
+
+    /* stationary detector */
+    double stillKPH = propGetDouble(PROP_GPS_FILTER_STILL, 3.0);
+    double fkph = sqrt((filterE.vel * filterE.vel) + (filterN.vel * filterN.vel)) * 3.6;
+    if (filterParked) {
+        double radius = (double)propGetUInt32(PROP_GPS_FILTER_RADIUS, 25L);
+        double de = ze - filterAnchorE, dn = zn - filterAnchorN;
+        if ((gps->speedKPH >= stillKPH) || (((de * de) + (dn * dn)) > (radius * radius))) {
+            // moving again
+            filterParked = utFalse;
+            filterSlowCount = 0;
+        } else {
+            // refine the parked position
+            if (filterAnchorCount < FILTER_ANCHOR_WEIGHT) { filterAnchorCount++; }
+            filterAnchorE += de / (double)filterAnchorCount;
+            filterAnchorN += dn / (double)filterAnchorCount;
+        }
+    } else
+    if ((gps->speedKPH < stillKPH) && (fkph < stillKPH)) {
+        if (++filterSlowCount >= FILTER_STILL_COUNT) {
+            filterParked = utTrue;
+            filterAnchorCount = 1;
+            filterAnchorE = filterE.pos;
+            filterAnchorN = filterN.pos;
+        }
+    } else {
+        filterSlowCount = 0;
+    }
+    if (filterParked) {
+        filterE.pos = filterAnchorE;
+        filterN.pos = filterAnchorN;
+        filterE.vel = filterN.vel = 0.0;
+    }
+
+    /* filtered fix */
+    gps->point.latitude  = filterRef.latitude  + (filterN.pos / METERS_PER_DEGREE);
+    gps->point.longitude = filterRef.longitude + (filterE.pos / (METERS_PER_DEGREE * filterRefCos));
+    if (filterParked) {
+        gps->speedKPH = 0.0;
+    } else {
+        gps->speedKPH = (float)fkph;
+        if (fkph >= stillKPH) {
+            double h = atan2(filterE.vel, filterN.vel) / RADIANS;
+            if (h < 0.0) { h += 360.0; }
+            gps->heading = (float)((h >= 360.0)? 0.0 : h);
+        }
+    }
+    return _filterOutput(gps);
+}
@@ -0,0 +1,27 @@
+// ----------------------------------------------------------------------------
+// Description:
+//  Optional GPS fix smoothing (constant-velocity Kalman filter with a
+//  stationary detector) applied before the GPS event modules.
+// ----------------------------------------------------------------------------
+
+#ifndef _GPSFILTER_H
+#define _GPSFILTER_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stdtypes.h"
+#include "gpstools.h"
+
+// ----------------------------------------------------------------------------
+
+void gpsFilterInitialize();
+void gpsFilterReset();
+GPS_t *gpsFilterApply(GPS_t *gps);
+
+// ----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -37,6 +37,7 @@
 #include "gps.h"
 #include "gpsmods.h"
 
+#include "gpsfilter.h"
 #include "motion.h"
 #include "odometer.h"
 #if defined(ENABLE_GEOZONE)
@@ -53,6 +54,9 @@
 void gpsModuleInitialize(eventAddFtn_t queueEvent)
 {
 
+    /* fix smoothing */
+    gpsFilterInitialize();
+
     /* motion */
     motionInitialize(queueEvent);
 
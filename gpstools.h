@@ -80,6 +80,7 @@ typedef struct
 #define NMEA0183_GPRMC              0x00000001L
 #define NMEA0183_GPGGA              0x00000002L
 #define NMEA0183_GPGSA              0x00000004L
+#define NMEA0183_GPVTG              0x00000008L
 
 typedef struct 
 {
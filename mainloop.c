@@ -60,6 +60,7 @@
 #include "transport.h"
 #include "gps.h"
 #include "gpsmods.h"
+#include "gpsfilter.h"
 #include "stdtypes.h"
 #include "utctools.h"
 #include "gpstools.h"
@@ -211,13 +212,6 @@ void timeout_handler(int sig, siginfo_t *sinfo, void *context)
 		network_link_status = NETWORK_STATUS_TIMEOUT;
 		pthread_cond_signal(&network_down_sema);
 	}
-	else if (sinfo->si_value.sival_int == TIMER_RFID_1) {
-		if (!pthread_equal(pthread_self(), thread_rfid_reader)) {
-			pthread_kill(thread_rfid_reader, sig);
-			printf("Redirect timeout signal %d to rfid thread\n", 
-					sig);
-		}
-	}
 	else if (sinfo->si_value.sival_int == TIMER_GPS_1) {
 		if (!pthread_equal(pthread_self(), gpsThread.thread)) {
 			pthread_kill(gpsThread.thread, sig);
@@ -401,6 +395,8 @@ static void * _mainLoopRun(void *arg)
 			if (!mainRunThread)
 				break;
 			gps = gpsGetLastGPS(&lastValidGPSFix, gpsAquireTimeoutSec);
+			gpsFilterReset();
+			gpsFilterApply(&lastValidGPSFix);
 			logINFO(LOGSRC,"GPS fix: %.5lf/%.5lf", 
 					gps->point.latitude, gps->point.longitude);
 			_queueMotionEvent(PRIORITY_NORMAL, STATUS_INITIALIZED, &lastValidGPSFix);
@@ -415,6 +411,7 @@ static void * _mainLoopRun(void *arg)
 		// acquire GPS fix 
 		gps = gpsGetLastGPS(&newFix, gpsAquireTimeoutSec);
 		if (gps) {
+			gpsFilterApply(&newFix);
 			gpsModuleCheckEvents(&lastValidGPSFix, &newFix);
 			gpsCopy(&lastValidGPSFix, &newFix);
 		}
@@ -115,6 +115,21 @@ static TimerSec_t           lastMovingMessageTimer      = 0L;
 #endif
 static eventAddFtn_t	ftnQueueEvent = 0;
 static threadMutex_t	motionMutex;
+
+/* motion properties, reloaded only when 'motionCfgVersion' changes */
+typedef struct {
+	UInt32	version;
+	UInt32	startType;		// PROP_MOTION_START_TYPE
+	double	start;			// PROP_MOTION_START (kph or meters)
+	UInt32	inMotion;		// PROP_MOTION_IN_MOTION (sec, 0 = USHRT_MAX)
+	UInt32	stopType;		// PROP_MOTION_STOP_TYPE
+	UInt32	stop;			// PROP_MOTION_STOP (sec)
+	UInt32	dormantInterval;	// PROP_MOTION_DORMANT_INTRVL (sec)
+	UInt32	dormantCount;	// PROP_MOTION_DORMANT_COUNT
+	double	excessSpeed;	// PROP_MOTION_EXCESS_SPEED (kph)
+} MotionConfig_t;
+static MotionConfig_t	motionCfg;				// version 0, never current
+static volatile UInt32	motionCfgVersion = 1;
 /*static UInt32	motion_debug = 0; */
 extern UInt32 gpsDistanceDelta;
 #define MOTION_LOCK         MUTEX_LOCK(&motionMutex);
@@ -130,6 +145,36 @@ void motionResetStatus(void)
 	gpsClear(&lastMotionFix);
 }
 
+/* note that the motion properties have changed */
+// Called from the property SET notification (any thread).  The next
+// 'motionCheckGPS' reloads 'motionCfg'.
+void motionConfigChanged(void)
+{
+	motionCfgVersion++;
+}
+
+/* reload 'motionCfg' from the properties */
+static void _motionLoadConfig(void)
+{
+	motionCfg.version = motionCfgVersion;
+	motionCfg.startType = propGetUInt32(PROP_MOTION_START_TYPE, 0);
+	motionCfg.start = propGetDouble(PROP_MOTION_START, 0.0);
+	motionCfg.inMotion = propGetUInt32(PROP_MOTION_IN_MOTION, 0);
+	if (motionCfg.inMotion == 0)
+		motionCfg.inMotion = USHRT_MAX;
+	motionCfg.stopType = propGetUInt32(PROP_MOTION_STOP_TYPE, 0);
+	motionCfg.stop = propGetUInt32(PROP_MOTION_STOP, 0);
+	motionCfg.dormantInterval = propGetUInt32(PROP_MOTION_DORMANT_INTRVL, 0);
+	motionCfg.dormantCount = propGetUInt32(PROP_MOTION_DORMANT_COUNT, 0L);
+	motionCfg.excessSpeed = propGetDouble(PROP_MOTION_EXCESS_SPEED, 120.0);
+}
+
+/* return true if the last motion check found the vehicle moving */
+utBool motionIsInMotion(void)
+{
+	return isInMotion;
+}
+
 /* initialize motion module */
 void motionInitialize(eventAddFtn_t queueEvent)
 {
@@ -176,9 +221,7 @@ static void _queueMotionEvent(PacketPriority_t priority, StatusCode_t code, UInt
 /* motion in motion */
 static void motion_in_motion(double speed, UInt32 now, const GPS_t *newFix)
 {
-	double speed_limit;
-	speed_limit = propGetDouble(PROP_MOTION_EXCESS_SPEED, 120.0);
-	if (speed > speed_limit)
+	if (speed > motionCfg.excessSpeed)
 		_queueMotionEvent(EXCESS_SPEED_PRIORITY, STATUS_MOTION_EXCESS_SPEED, now, newFix);
 	else 
 		_queueMotionEvent(IN_MOTION_PRIORITY, STATUS_MOTION_IN_MOTION, now, newFix);
@@ -188,25 +231,23 @@ static void motion_in_motion(double speed, UInt32 now, const GPS_t *newFix)
 void motionCheckGPS(const GPS_t *oldFix, const GPS_t *newFix)
 {
 	double speedKPH = 0.0, deltaMeters = 0.0;
-	double defMotionDistance, defMotionStart;
-	UInt32 defDormantInterval, maxDormantCount, nowTime;
-	UInt32 defMotionStop, defStartType, defStopType, defMotionInterval, val1;
+	UInt32 defDormantInterval, nowTime;
+	UInt32 defMotionStop, defMotionInterval;
 	utBool isMoving = utFalse;
+	if (motionCfg.version != motionCfgVersion)
+		_motionLoadConfig();
 	/* 'start' definition */
-	// defStartType:
+	// motionCfg.startType:
 	//   0 - check GPS speed (kph)
 	//   1 - check GPS distance (meters)
-	defStartType = propGetUInt32(PROP_MOTION_START_TYPE, 0);
 	speedKPH = newFix->speedKPH;
-	if (defStartType == MOTION_START_GPS_METERS) {
-		defMotionDistance = propGetDouble(PROP_MOTION_START, 0.0);
+	if (motionCfg.startType == MOTION_START_GPS_METERS) {
 		deltaMeters = gpsMetersToPoint(&oldFix->point, &newFix->point);
-		if (deltaMeters > defMotionDistance)
+		if (deltaMeters > motionCfg.start)
 			isMoving = utTrue;
 	}
 	else {
-		defMotionStart = propGetDouble(PROP_MOTION_START, 0.0);
-		if (speedKPH > defMotionStart)
+		if (speedKPH > motionCfg.start)
 			isMoving = utTrue;
 	}
 	if (!gpsIsValid(&lastMotionFix)) {
@@ -234,10 +275,7 @@ void motionCheckGPS(const GPS_t *oldFix, const GPS_t *newFix)
 		} 
 		else {
 			++inMotionMessageCycle;
-			val1 = propGetUInt32(PROP_MOTION_IN_MOTION, 0);
-			if (val1 == 0)
-				val1 = USHRT_MAX;
-			defMotionInterval = (val1 + gpsEventCycle - 1) / gpsEventCycle;
+			defMotionInterval = (motionCfg.inMotion + gpsEventCycle - 1) / gpsEventCycle;
 			// In-motion interval has been defined - we want in-motion events.
 			if (inMotionMessageCycle >= defMotionInterval) {
 					// we're moving, and the in-motion interval has expired
@@ -252,11 +290,10 @@ void motionCheckGPS(const GPS_t *oldFix, const GPS_t *newFix)
 		if (isInMotion) {
 		// I was moving, but stops now.
 			++stopTimer;
-			defStopType = propGetUInt32(PROP_MOTION_STOP_TYPE, 0);
-			if (defStopType == MOTION_STOP_WHEN_STOPPED)
+			if (motionCfg.stopType == MOTION_STOP_WHEN_STOPPED)
 				defMotionStop = 0;
 			else 
-				defMotionStop = propGetUInt32(PROP_MOTION_STOP, 0) / gpsEventCycle; 
+				defMotionStop = motionCfg.stop / gpsEventCycle; 
 			if (stopTimer >= defMotionStop) {
 				_queueMotionEvent(MOTION_STOP_PRIORITY, STATUS_MOTION_STOP, nowTime, newFix);
 				isInMotion = utFalse;
@@ -265,10 +302,7 @@ void motionCheckGPS(const GPS_t *oldFix, const GPS_t *newFix)
 			}
 			else {
 				++inMotionMessageCycle;
-				val1 = propGetUInt32(PROP_MOTION_IN_MOTION, 0);
-				if (val1 == 0)
-					val1 = USHRT_MAX;
-				defMotionInterval = (val1 + gpsEventCycle - 1) / gpsEventCycle;
+				defMotionInterval = (motionCfg.inMotion + gpsEventCycle - 1) / gpsEventCycle;
 				if (inMotionMessageCycle >= defMotionInterval) {
 					// we're moving, and the in-motion interval has expired
 					motion_in_motion(speedKPH, nowTime, newFix);
@@ -277,10 +311,8 @@ void motionCheckGPS(const GPS_t *oldFix, const GPS_t *newFix)
 			} 
 		} //isInMotion
 		else {
-			val1 = propGetUInt32(PROP_MOTION_DORMANT_INTRVL, 0);
-			defDormantInterval = (val1 + gpsEventCycle - 1) / gpsEventCycle;
-			maxDormantCount = propGetUInt32(PROP_MOTION_DORMANT_COUNT, 0L);
-			if (dormantCount < maxDormantCount && defDormantInterval > 0) {
+			defDormantInterval = (motionCfg.dormantInterval + gpsEventCycle - 1) / gpsEventCycle;
+			if (dormantCount < motionCfg.dormantCount && defDormantInterval > 0) {
 				if (++dormantMessageCycle >= defDormantInterval) {
 					// send dormant message
 					_queueMotionEvent(DORMANT_PRIORITY, STATUS_MOTION_DORMANT, nowTime, newFix);
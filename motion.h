@@ -44,6 +44,8 @@ void motionResetMovingMessageTimer();
 
 void motionCheckGPS(const GPS_t *oldFix, const GPS_t *newFix);
 void motionResetStatus(void);
+utBool motionIsInMotion(void);
+void motionConfigChanged(void);
 
 // ----------------------------------------------------------------------------
 
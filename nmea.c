@@ -0,0 +1,212 @@
+// ----------------------------------------------------------------------------
+// Description:
+//  NMEA-0183 sentence tokenizer and fixed-point field converters.
+// Notes:
+//  - 'nmeaTokenize' splits a sentence into fields in a single pass, in place
+//    (no copies, no allocation), verifying the '*hh' checksum as it goes.
+//  - Numeric fields are converted directly to scaled integers.  Latitude and
+//    longitude are returned in 1e-7 degrees ('NMEA_LATLON_SCALE').
+//  - 'nmeaFixTime' caches the UTC seconds of the last date seen, so the fix
+//    time of every sentence within the same day is a single addition.  The
+//    cache is not locked, and should only be used from the GPS thread.
+// ----------------------------------------------------------------------------
+
+#define SKIP_TRANSPORT_MEDIA_CHECK // only if TRANSPORT_MEDIA not used in this file 
+#include "defaults.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stdtypes.h"
+#include "utctools.h"
+#include "nmea.h"
+
+// ----------------------------------------------------------------------------
+
+/* cached start-of-day for 'nmeaFixTime' */
+static Int32    nmeaCachedDate      = -1L;  // ddmmyy
+static UInt32   nmeaCachedDayBase   = 0L;   // UTC seconds at 00:00:00 of 'nmeaCachedDate'
+
+// ----------------------------------------------------------------------------
+
+static int _nmeaHexValue(char c)
+{
+    if ((c >= '0') && (c <= '9')) { return c - '0'; }
+    if ((c >= 'A') && (c <= 'F')) { return c - 'A' + 10; }
+    if ((c >= 'a') && (c <= 'f')) { return c - 'a' + 10; }
+    return -1;
+}
+
+/* split 'sentence' into fields, in place */
+// 'len' is the number of bytes available at 'sentence' (which need not be
+// null terminated).  The sentence must be terminated by '*hh', <CR>, or <LF>
+// within 'len' bytes.  Field separators are replaced with '\0'.
+// Returns the number of fields, or NMEA_ERR_FORMAT/NMEA_ERR_CHECKSUM.
+int nmeaTokenize(char *sentence, int len, NMEAFields_t *f)
+{
+    char *p, *end;
+    UInt8 sum = 0;
+
+    f->count = 0;
+    f->hasChecksum = utFalse;
+    if (!sentence || (len < 7) || (*sentence != '$')) {
+        return NMEA_ERR_FORMAT;
+    }
+
+    end = sentence + len;
+    f->field[f->count++] = sentence + 1;
+    for (p = sentence + 1; p < end; p++) {
+        char c = *p;
+        if (c == ',') {
+            sum ^= (UInt8)c;
+            *p = '\0';
+            if (f->count >= NMEA_MAX_FIELDS) {
+                return NMEA_ERR_FORMAT;
+            }
+            f->field[f->count++] = p + 1;
+        } else
+        if (c == '*') {
+            *p = '\0';
+            if ((end - p) < 3) {
+                return NMEA_ERR_FORMAT;
+            }
+            int hi = _nmeaHexValue(p[1]), lo = _nmeaHexValue(p[2]);
+            if ((hi < 0) || (lo < 0)) {
+                return NMEA_ERR_FORMAT;
+            }
+            if ((UInt8)((hi << 4) | lo) != sum) {
+                return NMEA_ERR_CHECKSUM;
+            }
+            f->hasChecksum = utTrue;
+            return f->count;
+        } else
+        if ((c == '\r') || (c == '\n') || (c == '\0')) {
+            // no checksum present (it is optional in NMEA-0183)
+            *p = '\0';
+            return f->count;
+        } else {
+            sum ^= (UInt8)c;
+        }
+    }
+
+    /* unterminated (truncated) sentence */
+    return NMEA_ERR_FORMAT;
+}
+
+/* return the specified field, or "" if the sentence is too short */
+const char *nmeaField(const NMEAFields_t *f, int ndx)
+{
+    return ((ndx >= 0) && (ndx < f->count))? f->field[ndx] : "";
+}
+
+// ----------------------------------------------------------------------------
+
+/* parse a decimal field into an integer scaled by 10^decimals */
+// ie. "12.3456" with 'decimals' == 3 returns 12345.  Digits beyond 'decimals'
+// are truncated.  Returns false if the field is empty or not numeric.
+utBool nmeaParseFixed(const char *s, int decimals, Int32 *val)
+{
+    Int32 v = 0L;
+    int frac = -1;
+    utBool neg = utFalse;
+
+    if (!s || !*s) {
+        return utFalse;
+    }
+    if (*s == '-') {
+        neg = utTrue;
+        s++;
+    } else
+    if (*s == '+') {
+        s++;
+    }
+    for (; *s; s++) {
+        if (*s == '.') {
+            if (frac >= 0) {
+                return utFalse;
+            }
+            frac = 0;
+        } else
+        if ((*s < '0') || (*s > '9')) {
+            return utFalse;
+        } else
+        if (frac < decimals) {
+            v = (v * 10L) + (*s - '0');
+            if (frac >= 0) { frac++; }
+        }
+    }
+    if (frac < 0) {
+        frac = 0;
+    }
+    for (; frac < decimals; frac++) {
+        v *= 10L;
+    }
+    *val = neg? -v : v;
+    return utTrue;
+}
+
+/* parse a "[d]ddmm.mmmm" field (and 'N'/'S'/'E'/'W' hemisphere) */
+// The result is in 1e-7 degrees ('NMEA_LATLON_SCALE')
+utBool nmeaParseLatLon(const char *s, const char *hemi, Int32 *val)
+{
+    Int32 minutes, degrees;
+
+    /* minutes * 1e5 (max "18000.00000" fits in 31 bits) */
+    if (!nmeaParseFixed(s, 5, &minutes) || (minutes < 0L)) {
+        return utFalse;
+    }
+    degrees  = minutes / 10000000L; // 'dd' of "ddmm" at 1e5 scale
+    minutes -= degrees * 10000000L;
+    if (minutes >= 6000000L) {
+        return utFalse;
+    }
+
+    /* minutes to 1e-7 degrees */
+    Int32 v = (degrees * NMEA_LATLON_SCALE) + (((minutes * 100L) + 30L) / 60L);
+    if (hemi && ((*hemi == 'S') || (*hemi == 'W'))) {
+        v = -v;
+    }
+    *val = v;
+    return utTrue;
+}
+
+/* parse a "hhmmss[.sss]" field into seconds of the day */
+// Returns -1 if the field is invalid
+Int32 nmeaParseTimeOfDay(const char *s)
+{
+    Int32 hms;
+    if (!nmeaParseFixed(s, 0, &hms) || (hms < 0L)) {
+        return -1L;
+    }
+    Int32 hh = hms / 10000L, mm = (hms / 100L) % 100L, ss = hms % 100L;
+    if ((hh > 23L) || (mm > 59L) || (ss > 60L)) {
+        return -1L;
+    }
+    return (hh * 3600L) + (mm * 60L) + ss;
+}
+
+/* return the UTC seconds for a "ddmmyy" date and "hhmmss" time field */
+// Returns 0 if either field is invalid
+UInt32 nmeaFixTime(const char *date, const char *time)
+{
+    Int32 ddmmyy, tod = nmeaParseTimeOfDay(time);
+    if ((tod < 0L) || !nmeaParseFixed(date, 0, &ddmmyy) || (ddmmyy <= 0L)) {
+        return 0L;
+    }
+    if (ddmmyy != nmeaCachedDate) {
+        // new day, recalculate the day base
+        YMDHMS_t yh;
+        int yy = (int)(ddmmyy % 100L);
+        memset(&yh, 0, sizeof(yh));
+        yh.wDay   = (int)(ddmmyy / 10000L);
+        yh.wMonth = (int)((ddmmyy / 100L) % 100L);
+        yh.wYear  = (yy < 70)? (2000 + yy) : (1900 + yy);
+        if ((yh.wMonth < 1) || (yh.wMonth > 12) || (yh.wDay < 1) || (yh.wDay > 31)) {
+            return 0L;
+        }
+        nmeaCachedDayBase = utcYmdHmsToSeconds(&yh);
+        nmeaCachedDate    = ddmmyy;
+    }
+    return nmeaCachedDayBase + (UInt32)tod;
+}
@@ -0,0 +1,50 @@
+// ----------------------------------------------------------------------------
+// Description:
+//  NMEA-0183 sentence tokenizer and fixed-point field converters.
+// ----------------------------------------------------------------------------
+
+#ifndef _NMEA_H
+#define _NMEA_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stdtypes.h"
+#include "utctools.h"
+
+// ----------------------------------------------------------------------------
+
+/* maximum number of fields in a sentence (including the address field) */
+// $GPGSA has the most fields of the sentences we parse (18)
+#define NMEA_MAX_FIELDS             24
+
+/* tokenizer return codes */
+#define NMEA_ERR_FORMAT             -1      // not a '$' sentence, or too short
+#define NMEA_ERR_CHECKSUM           -2      // '*hh' checksum does not match
+
+/* fixed-point scale of parsed lat/lon values */
+#define NMEA_LATLON_SCALE           10000000L   // 1e-7 degrees
+
+typedef struct
+{
+    int             count;                      // number of fields
+    utBool          hasChecksum;                // sentence had a '*hh' suffix
+    const char      *field[NMEA_MAX_FIELDS];    // field[0] is the address (ie. "GPRMC")
+} NMEAFields_t;
+
+// ----------------------------------------------------------------------------
+
+int nmeaTokenize(char *sentence, int len, NMEAFields_t *f);
+const char *nmeaField(const NMEAFields_t *f, int ndx);
+
+utBool nmeaParseFixed(const char *s, int decimals, Int32 *val);
+utBool nmeaParseLatLon(const char *s, const char *hemi, Int32 *val);
+Int32 nmeaParseTimeOfDay(const char *s);
+UInt32 nmeaFixTime(const char *date, const char *time);
+
+// ----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+}
+#endif
+#endif
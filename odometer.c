@@ -60,6 +60,14 @@ static utBool	odom_enable = utFalse;
 
 static eventAddFtn_t  ftnQueueEvent = 0;
 
+/* odometer properties, reloaded only when 'odomCfgVersion' changes */
+typedef struct {
+    UInt32          version;
+    UInt32          minDeltaMeters;     // PROP_GPS_DISTANCE_DELTA
+} OdomConfig_t;
+static OdomConfig_t     odomCfg;                // version 0, never current
+static volatile UInt32  odomCfgVersion = 1;
+
 static struct {
     Key_t           value;
     Key_t           limit;
@@ -100,6 +108,24 @@ static GPSOdometer_t *_odomGetState(UInt16 ndx)
 
 // ----------------------------------------------------------------------------
 
+/* note that the odometer properties have changed */
+// Called from the property SET notification (any thread).  The next
+// 'odomCheckGPS' reloads 'odomCfg'.
+void odomConfigChanged()
+{
+    odomCfgVersion++;
+}
+
+/* reload 'odomCfg' from the properties */
+static void _odomLoadConfig()
+{
+    odomCfg.version = odomCfgVersion;
+    odomCfg.minDeltaMeters = propGetUInt32(PROP_GPS_DISTANCE_DELTA, 500L);
+    if (odomCfg.minDeltaMeters < 10L) { odomCfg.minDeltaMeters = 10L; }
+}
+
+// ----------------------------------------------------------------------------
+
 /* initialize odometer */
 void odomInitialize(eventAddFtn_t queueEvent)
 {
@@ -190,8 +216,9 @@ void odomCheckGPS(const GPS_t *oldFix, const GPS_t *newFix)
     /* get actual odometer, if available */
     UInt32 actualOdomMeters = ROUND(odomGetActualOdometerMeters());
     /* loop through odometers */
-    UInt32 minDeltaMeters = propGetUInt32(PROP_GPS_DISTANCE_DELTA, 500L);    
-    if (minDeltaMeters < 10L) { minDeltaMeters = 10L; }
+    if (odomCfg.version != odomCfgVersion) {
+        _odomLoadConfig();
+    }
     int i;
     for (i = 0; i < ODOMETER_COUNT; i++) {
         GPSOdometer_t *gps = _odomGetState(i);
@@ -222,7 +249,7 @@ void odomCheckGPS(const GPS_t *oldFix, const GPS_t *newFix)
         if (newFix) {
             // GPS based odometer
             UInt32 deltaMeters = ROUND(gpsMetersToPoint(&(newFix->point), &(gps->point)));
-            if (deltaMeters >= minDeltaMeters) {
+            if (deltaMeters >= odomCfg.minDeltaMeters) {
                 // I've moved at least the minimum required distance to set a new steak in the ground
                 newOdomMeters = ODOM_IsFirst(i)? deltaMeters : (deltaMeters + oldOdomMeters);
                 propSetUInt32(odomTable[i].value, newOdomMeters);
@@ -30,6 +30,7 @@ extern "C" {
 
 void odomInitialize(eventAddFtn_t queueEvent);
 void odomCheckGPS(const GPS_t *oldFix, const GPS_t *newFix);
+void odomConfigChanged();
 
 double odomGetActualOdometerMeters();
 double odomGetDeviceDistanceMeters();
@@ -215,6 +215,8 @@ static KeyValue_t properties[] = {
 	{PROP_RFID_SENSOR_REPORT_INTRVL,	"rfid.sensor.rpt.intrvl",		KVT_UINT32,SAVE,		1,	"30"},
 	{PROP_RFID_HUMIDITY_ID_RANGE,	"rfid.humidity.id.range", 	KVT_UINT32,	SAVE,	5,	"0,0,30,45,120"},
 	{PROP_RFID_HUMIDITY_REPORT_INTRVL,	"rfid.humidity.rpt.intrvl",		KVT_UINT32,SAVE,		1,	"30"},
+	{PROP_RFID_TAG_POOL,			"rfid.tag.pool",			KVT_UINT32,	SAVE,	2,	"1024,512"},
+	{PROP_RFID_ALARM_OUTPUT,		"rfid.alarm.output",		KVT_STRING,	SAVE,	1,	""},
 //================================================================================
 	// QDAC properties
 	{PROP_QDAC_UNKNOWN_TAG, "qdac.unknown.tag", KVT_UINT32, SAVE, 3, "30,45,120"},
@@ -336,10 +338,15 @@ static KeyValue_t properties[] = {
 	{PROP_GPS_EXPIRATION,	"gps.expire",		KVT_UINT16,	SAVE,	1,  "1200"},
 	{PROP_GPS_CLOCK_DELTA,	"gps.updclock",		KVT_UINT32, SAVE,	2,  "10,1"},
 	{PROP_GPS_LOST_COUNTER, "gps.lost.counter", KVT_UINT32,	 SAVE,	1,  "5"}, 
+	{PROP_GPS_DUTY_CYCLE,	"gps.duty",			KVT_UINT32,	SAVE,	4,  "60,14400,5,1000"},
 //	{PROP_GPS_ACCURACY,	"gps.accuracy",			KVT_UINT16,	SAVE,	1,  "0"},
 	{PROP_GPS_MIN_SPEED,	"gps.minspd",		KVT_UINT16|KVT_DEC(1), SAVE, 1, "1.7"},
 	{PROP_GPS_DISTANCE_DELTA,"gps.dstdelt",		KVT_UINT32,	SAVE,	1,  "150"},
 	{PROP_GPS_HIGH_ACCURACY,"gps.high.accuracy",		KVT_UINT32,	SAVE,	1,  "1"},
+	{PROP_GPS_FILTER,		"gps.filter",		KVT_BOOLEAN,SAVE,	1,  "0"},
+	{PROP_GPS_FILTER_ACCEL,	"gps.filter.accel",	KVT_UINT16|KVT_DEC(1), SAVE, 1, "1.0"},
+	{PROP_GPS_FILTER_STILL,	"gps.filter.still",	KVT_UINT16|KVT_DEC(1), SAVE, 1, "3.0"},
+	{PROP_GPS_FILTER_RADIUS,"gps.filter.radius",	KVT_UINT16,	SAVE,	1,  "25"},
     // --- GeoZone properties
 	{PROP_CMD_GEOF_ADMIN,	"gf.admin",		KVT_COMMAND,	WO,	 1,  0},
 	{PROP_GEOF_COUNT,	"gf.count",		KVT_UINT16,	RO,	 1,  "0"},
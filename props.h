@@ -207,6 +207,10 @@ extern "C" {
 /* humidity tag */
 #define PROP_RFID_HUMIDITY_ID_RANGE 			0xEF97  /*RW, uint32* x 5 */
 #define PROP_RFID_HUMIDITY_REPORT_INTRVL		0xEF98 /*RW, uint32*/
+/* tag pool */
+#define PROP_RFID_TAG_POOL					0xEF99 /*RW, uint32 x 2: max tags, max tags per role */
+/* alarm output */
+#define PROP_RFID_ALARM_OUTPUT				0xEF9A /*RW, string: control file written "1"/"0", "" runs trig_alarm/disalarm */
 
 #define PROP_RFID_UPPER_BOUND	0xEF9F
 //-------------------------------------------------------------------------------
@@ -334,8 +338,13 @@ extern "C" {
 #define PROP_GPS_EXPIRATION	0xF513 
 #define PROP_GPS_CLOCK_DELTA	0xF515
 #define PROP_GPS_LOST_COUNTER	0xF516
+#define PROP_GPS_DUTY_CYCLE		0xF517
 #define PROP_GPS_MIN_SPEED              0xF522
 #define PROP_GPS_HIGH_ACCURACY	0xF523
+#define PROP_GPS_FILTER			0xF524
+#define PROP_GPS_FILTER_ACCEL	0xF525
+#define PROP_GPS_FILTER_STILL	0xF526
+#define PROP_GPS_FILTER_RADIUS	0xF527
 #define PROP_GPS_DISTANCE_DELTA         0xF531
 // ----------------------------------------------------------------------------
 // GeoZone properties:
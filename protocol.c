@@ -1485,6 +1485,12 @@ static utBool _protocolDuplexTransport(ProtocolVars_t *pv)
         }
     }
 
+    /* check for RFID tag pool exhaustion */
+    UInt32 rfidSince, rfidDropped;
+    if (rfid_tag_pool_exhausted(&rfidSince, &rfidDropped)) {
+        _protocolQueueError(pv,"%2x%4u%4u", (UInt32)ERROR_RFID_TAG_POOL, rfidSince, rfidDropped);
+    }
+
     /* default speak freely permission on new connections */
     pv->speakFreely = utFalse;
     pv->speakFreelyMaxEvents = -1;
@@ -1615,6 +1621,12 @@ static utBool _protocolSimplexTransport(ProtocolVars_t *pv)
         }
     }
 
+    /* check for RFID tag pool exhaustion */
+    UInt32 rfidSince, rfidDropped;
+    if (rfid_tag_pool_exhausted(&rfidSince, &rfidDropped)) {
+        _protocolQueueError(pv,"%2x%4u%4u", (UInt32)ERROR_RFID_TAG_POOL, rfidSince, rfidDropped);
+    }
+
     /* send queued packets/events */
     int simMaxEvents = -1;
     if (!_protocolSendAllPackets(pv, TRANSPORT_SIMPLEX, utFalse, simMaxEvents)) {
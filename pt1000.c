@@ -0,0 +1,95 @@
+/* PT1000 probe conversion for the high temperature tags.
+ * The probe is calibrated every 10 ADC counts.  The table below holds every
+ * ADC value from PT1000_ADC_MIN to PT1000_ADC_MAX, interpolated between the
+ * calibration points and rounded to the nearest 0.1 degree when it is
+ * compiled, so a reading is converted by a single lookup. */
+#include <stdint.h>
+#include "pt1000.h"
+
+/* calibration point t0 plus k tenths of the way to the next point t1 */
+#define PT1000_STEP(t0, t1, k)	((t0) + ((((t1) - (t0)) * (k) + 5) / 10))
+#define PT1000_SPAN4(t0, t1) \
+	PT1000_STEP(t0, t1, 0), PT1000_STEP(t0, t1, 1), \
+	PT1000_STEP(t0, t1, 2), PT1000_STEP(t0, t1, 3)
+#define PT1000_SPAN(t0, t1) \
+	PT1000_SPAN4(t0, t1), \
+	PT1000_STEP(t0, t1, 4), PT1000_STEP(t0, t1, 5), \
+	PT1000_STEP(t0, t1, 6), PT1000_STEP(t0, t1, 7), \
+	PT1000_STEP(t0, t1, 8), PT1000_STEP(t0, t1, 9)
+
+/* temperature in 0.1 degree C by ADC reading, one span per calibration
+ * point, commented with the ADC value of the point */
+static const int16_t pt1000_table[PT1000_ADC_MAX - PT1000_ADC_MIN + 1] = {
+	PT1000_SPAN(-570, -521),		/* 400 */
+	PT1000_SPAN(-521, -472),		/* 410 */
+	PT1000_SPAN(-472, -423),		/* 420 */
+	PT1000_SPAN(-423, -374),		/* 430 */
+	PT1000_SPAN(-374, -325),		/* 440 */
+	PT1000_SPAN(-325, -276),		/* 450 */
+	PT1000_SPAN(-276, -227),		/* 460 */
+	PT1000_SPAN(-227, -178),		/* 470 */
+	PT1000_SPAN(-178, -128),		/* 480 */
+	PT1000_SPAN(-128, -79),		/* 490 */
+	PT1000_SPAN(-79, -29),		/* 500 */
+	PT1000_SPAN(-29, 20),		/* 510 */
+	PT1000_SPAN(20, 70),		/* 520 */
+	PT1000_SPAN(70, 120),		/* 530 */
+	PT1000_SPAN(120, 169),		/* 540 */
+	PT1000_SPAN(169, 219),		/* 550 */
+	PT1000_SPAN(219, 269),		/* 560 */
+	PT1000_SPAN(269, 319),		/* 570 */
+	PT1000_SPAN(319, 369),		/* 580 */
+	PT1000_SPAN(369, 419),		/* 590 */
+	PT1000_SPAN(419, 470),		/* 600 */
+	PT1000_SPAN(470, 520),		/* 610 */
+	PT1000_SPAN(520, 570),		/* 620 */
+	PT1000_SPAN(570, 621),		/* 630 */
+	PT1000_SPAN(621, 671),		/* 640 */
+	PT1000_SPAN(671, 722),		/* 650 */
+	PT1000_SPAN(722, 773),		/* 660 */
+	PT1000_SPAN(773, 823),		/* 670 */
+	PT1000_SPAN(823, 874),		/* 680 */
+	PT1000_SPAN(874, 925),		/* 690 */
+	PT1000_SPAN(925, 976),		/* 700 */
+	PT1000_SPAN(976, 1027),		/* 710 */
+	PT1000_SPAN(1027, 1079),		/* 720 */
+	PT1000_SPAN(1079, 1130),		/* 730 */
+	PT1000_SPAN(1130, 1181),		/* 740 */
+	PT1000_SPAN(1181, 1232),		/* 750 */
+	PT1000_SPAN(1232, 1284),		/* 760 */
+	PT1000_SPAN(1284, 1336),		/* 770 */
+	PT1000_SPAN(1336, 1387),		/* 780 */
+	PT1000_SPAN(1387, 1439),		/* 790 */
+	PT1000_SPAN(1439, 1491),		/* 800 */
+	PT1000_SPAN(1491, 1543),		/* 810 */
+	PT1000_SPAN(1543, 1595),		/* 820 */
+	PT1000_SPAN(1595, 1647),		/* 830 */
+	PT1000_SPAN(1647, 1699),		/* 840 */
+	PT1000_SPAN(1699, 1751),		/* 850 */
+	PT1000_SPAN(1751, 1803),		/* 860 */
+	PT1000_SPAN(1803, 1856),		/* 870 */
+	PT1000_SPAN(1856, 1908),		/* 880 */
+	PT1000_SPAN(1908, 1961),		/* 890 */
+	PT1000_SPAN(1961, 2014),		/* 900 */
+	PT1000_SPAN(2014, 2066),		/* 910 */
+	PT1000_SPAN(2066, 2119),		/* 920 */
+	PT1000_SPAN(2119, 2172),		/* 930 */
+	PT1000_SPAN(2172, 2225),		/* 940 */
+	PT1000_SPAN(2225, 2278),		/* 950 */
+	PT1000_SPAN(2278, 2332),		/* 960 */
+	PT1000_SPAN(2332, 2385),		/* 970 */
+	PT1000_SPAN(2385, 2438),		/* 980 */
+	PT1000_SPAN(2438, 2492),		/* 990 */
+	PT1000_SPAN(2492, 2545),		/* 1000 */
+	PT1000_SPAN(2545, 2599),		/* 1010 */
+	PT1000_SPAN4(2599, 2653)		/* 1020..1023 */
+};
+
+/* temperature in 0.1 degree C of a PT1000 ADC reading; readings outside the
+ * probe range report the bottom of the table */
+int pt1000_temperature(uint32_t adc)
+{
+	if (adc < PT1000_ADC_MIN || adc > PT1000_ADC_MAX)
+		adc = PT1000_ADC_MIN;
+	return pt1000_table[adc - PT1000_ADC_MIN];
+}
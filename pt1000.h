@@ -0,0 +1,10 @@
+#ifndef _PT1000_H
+#define _PT1000_H
+#include <stdint.h>
+
+/* PT1000 probe ADC reading range of the high temperature tags */
+#define PT1000_ADC_MIN		400
+#define PT1000_ADC_MAX		1023
+
+int pt1000_temperature(uint32_t adc);
+#endif
@@ -16,12 +16,16 @@
 #include <limits.h>
 #include "stdtypes.h"
 #include "log.h"
+#include "checksum.h"
 #include "comport.h"
 #include "propman.h"
 #include "gpstools.h"
 #include "gps.h"
 #include "packet.h"
 #include "protocol.h"
+#include "gpio_out.h"
+#include "sample_window.h"
+#include "tagreader.h"
 #include "qdac.h"
 #include "reader_type.h"
 #define QDAC_MAIN_PERIOD 10 
@@ -54,11 +58,17 @@
 #define STATUS_QDAC_TEMPERATURE_HIGH	0xF730
 #define STATUS_QDAC_TEMPERATURE_LOW		0xF731
 
-#define NUM_TAGS_PER_POOL 128
+#define NUM_TAGS_PER_SLAB 128
+#define QDAC_MAX_TAGS (NUM_TAGS_PER_SLAB * 2)	/* as many tags as the fixed pools had */
+#define QDAC_ROLE_QUOTA (QDAC_MAX_TAGS / 2)	/* so one tag type cannot take the whole pool */
+#define QDAC_NUM_SPECS QDAC_MAX_TAGS		/* one per tag the pool holds */
+#define QDAC_INDEX_BITS 9
+#define QDAC_INDEX_SIZE (1 << QDAC_INDEX_BITS)	/* at least twice the specs indexed */
+#define QDAC_INDEX_MASK (QDAC_INDEX_SIZE - 1)
 
 #define RESPONSE_MAX_SIZE 					259	// QDAC response data packet length
 #define RESPONSE_MIN_SIZE 					5	// QDAC response data packet length
-#define PKTS_QUEUE_LENGTH					RESPONSE_MAX_SIZE*6
+#define PKTS_QUEUE_LENGTH					(RESPONSE_MAX_SIZE*6)
 //#define PKTS_QUEUE_LENGTH					130
 #define QDAC_VERSION_LENGTH 				64
 #define RESP_HEAD_END_TOTAL				5
@@ -119,7 +129,6 @@
 
 
 #define	MINUTES 60
-#define	GPS_TRAIL_LENGTH 32 
 #define	RSSI_BITS 5 
 #define	RSSI_TOTAL (1 << RSSI_BITS)
 #define	RSSI_INDEX_M (RSSI_TOTAL - 1)
@@ -153,7 +162,10 @@ struct QDAC_Tag {
 	unsigned long qdac_current_2_1;
 	long	qdac_pressure;
 	int raw_data_length;
+	int raw_data_size;			// allocated, kept with the tag slot
 	unsigned char *raw_data;
+	struct tag_index *tindex;		// index of the queue the tag is in
+	struct tag_timer timer;			// tag-out deadline, in the heap of the queue
 };
 
 static TAILQ_HEAD(tq_head, QDAC_Tag) tag_queue_1;
@@ -170,10 +182,7 @@ struct qdac_tag_control {
 	pthread_mutex_t mutex_qdac_switchsensor;
 	pthread_mutex_t mutex_qdac_pressuresensor;
 	pthread_mutex_t mutex_qdac_tmp;
-	pthread_mutex_t mutex_recycle;
-	pthread_mutex_t mutex_qdac_pkts;
 	struct tq_head qdac_lowtemp_queue;
-	struct tq_head recycle_queue;
 	struct tq_head qdac_hightemp_queue;	
 	struct tq_head qdac_gforcesensor_queue;
 	struct tq_head qdac_currentsensor_queue;
@@ -181,6 +190,23 @@ struct qdac_tag_control {
 	struct tq_head qdac_pressuresensor_queue;
 	struct tq_head qdac_unknown_queue;
 	struct tq_head qdac_tmp_queue;
+	struct tag_index lowtemp_index;		// serial -> tag, guarded by the queue mutex
+	struct tag_index hightemp_index;
+	struct tag_index gforcesensor_index;
+	struct tag_index currentsensor_index;
+	struct tag_index switchsensor_index;
+	struct tag_index pressuresensor_index;
+	struct tag_index unknown_index;
+	struct tag_index tmp_index;
+	struct tag_heap lowtemp_heap;		// tag-out deadlines, guarded by the queue mutex
+	struct tag_heap hightemp_heap;
+	struct tag_heap gforcesensor_heap;
+	struct tag_heap currentsensor_heap;
+	struct tag_heap switchsensor_heap;
+	struct tag_heap pressuresensor_heap;
+	struct tag_heap unknown_heap;
+	struct tag_heap tmp_heap;
+	struct tag_pool pool;			// the tags of all queues
 //	uint16_t customer_id;
 };
 
@@ -218,17 +244,22 @@ struct qdac_temp_spec {
 	uint16_t zone_id;
 	uint16_t qdac_tag_model;
 	uint16_t qdac_tag_type;
-	uint16_t temp_index;
-	uint16_t temp_count;
 	uint16_t alarm_type;
 	short set_high;
 	short set_low;
 	short cur_high;
 	short cur_low;
 	short cur_avg;
-	short *qdac_temp;
+	struct sample_window temps;
 //	struct qdac_temp_zone *qdac_zone_general;
-	struct qdac_temp_spec *qdac_temp_spec_next;
+	uint32_t used;				// spec_clock of the last lookup
+};
+
+/* the temperature specs, indexed by (serial, type); only the main thread uses them */
+struct qdac_spec_pool {
+	struct qdac_temp_spec spec[QDAC_NUM_SPECS];
+	uint32_t count;				// specs handed out from spec[]
+	struct qdac_temp_spec *slot[QDAC_INDEX_SIZE];
 };
 
 struct qdac_lowtemp_tag {
@@ -236,7 +267,6 @@ struct qdac_lowtemp_tag {
 	int tag_out_time;
 	uint32_t beacon_cycle;
 	uint32_t report_cycle;
-	struct qdac_temp_spec *qdac_lowtemp_tag_spec;
 };
 
 struct qdac_hightemp_tag {
@@ -244,7 +274,6 @@ struct qdac_hightemp_tag {
 	int tag_out_time;
 	uint32_t beacon_cycle;
 	uint32_t report_cycle;
-	struct qdac_temp_spec *qdac_hightemp_tag_spec;
 };
 
 
@@ -298,11 +327,17 @@ struct qdac_tmp_tag {
 	uint32_t tmp_tag_type1;
 	uint32_t tmp_tag_type2;
 };
+/* single reader/single parser queue: the reader thread owns read_index and
+ * the free space, the main thread owns parse_index and the unparsed data;
+ * the mutex only guards queue_unparse_length, which hands bytes over */
 struct qdac_recv_pkts {
-	unsigned char *qdac_pkts_queue;
+	unsigned char qdac_pkts_queue[PKTS_QUEUE_LENGTH + RESPONSE_MAX_SIZE];	// past the end: the wrapped part of a pkt
 	int read_index;				// point to the begin of the next read pkt	
 	int parse_index;				// point to the begin of the next parsed pkt
 	uint32_t queue_unparse_length;
+	pthread_mutex_t mutex;
+	pthread_cond_t more_data;		// signalled by the reader
+	pthread_cond_t more_space;		// signalled by the parser
 };
 
 struct qdac_hightemp_tag qdac_high_temp;
@@ -316,7 +351,13 @@ struct qdac_temp_zone qdac_zone;
 struct qdac_tmp_tag qdac_tmp;
 //struct qdac_tmp_tag qdac_tmp;
 
-struct qdac_recv_pkts qdac_pkts;
+static struct qdac_spec_pool qdac_specs;
+static uint32_t spec_clock;
+
+struct qdac_recv_pkts qdac_pkts = {
+			.mutex = PTHREAD_MUTEX_INITIALIZER,
+			.more_data = PTHREAD_COND_INITIALIZER,
+			.more_space = PTHREAD_COND_INITIALIZER};
 /* claim the qdac relate variables */
 static struct qdac_tag_control qdac_recv_tag = {
 //			.qdac_reader_type = 0, 
@@ -328,13 +369,10 @@ static struct qdac_tag_control qdac_recv_tag = {
 			.mutex_qdac_currentsensor = PTHREAD_MUTEX_INITIALIZER,
 			.mutex_qdac_switchsensor = PTHREAD_MUTEX_INITIALIZER,
 			.mutex_qdac_pressuresensor = PTHREAD_MUTEX_INITIALIZER,
-			.mutex_recycle = PTHREAD_MUTEX_INITIALIZER,
-			.mutex_qdac_pkts = PTHREAD_MUTEX_INITIALIZER,
+			.pool = {.mutex = PTHREAD_MUTEX_INITIALIZER},
 			.mutex_hub_ctrl = PTHREAD_MUTEX_INITIALIZER};
 			
 static struct qdac_thread_args qdac_args =  {0, &qdac_recv_tag};
-static struct QDAC_Tag * qdac_tag_pool1;
-static struct QDAC_Tag * qdac_tag_pool2;
 static int qdac_reader_running = 0;
 static int qdac_main_running = 0;
 static bool qdac_hub_reset = false;
@@ -348,14 +386,13 @@ short qdac_test = 0;
 static ComPort_t QDACCom = {.name = "ttyS4", .bps = 115200, .read_len = TAG_PACKET_SIZE_19,};
 
 static unsigned char command[260];
+static unsigned char hub_response[RESPONSE_MAX_SIZE];
 pthread_t thread_qdac_main;
 pthread_t thread_qdac_reader;
 
 //static struct temp_record temp_sorted[NUM_ZONES];
 /* qdac GPS variable */
-static GPS_t gpsFresh;
-static GPS_t gpsFleeting;
-static GPSPoint_t gps_trail[GPS_TRAIL_LENGTH];
+static struct reader_gps qdac_gps;
 
 static Packet_t qdac_event_packet;
 //static unsigned char qdac_raw_buf[RAW_READ_SIZE * 2];
@@ -369,18 +406,15 @@ static int qdac_verify_tag_packet(unsigned char **pkt, int length, int fun_code)
 static void qdac_parse_tag(struct qdac_tag_control *tag_c, unsigned char *pkt);
 static bool qdac_admit_tag(struct QDAC_Tag *tag, time_t now, int period);
 //static bool tag_not_bursting(struct Tag *tag, struct timespec ts1);
-static unsigned short qdac_crc16(unsigned char *data, unsigned int n);
 
 //static void battery_time_checking(struct tag_control *tag_c);
-static struct QDAC_Tag *qdac_search_tag(struct tq_head *tqueue, uint32_t serial);
 static int filter_missing_tag( unsigned char *pkt);
-static void update_gps_trail(void);
-static GPSPoint_t * backtrack_gps_trail(int backward_time);
 //static bool am_i_moving(uint32_t speed);
 //static void sample_rssi(struct freezer_control *freezer, uint32_t rssi);
 //static uint32_t find_median_rssi(struct freezer_control *freezer);
 static void qdac_init_tag_parameter(struct qdac_tag_control *tag_c); 
-static int qdac_init_tag_queue(struct qdac_tag_control *tag_c, struct QDAC_Tag *tag_pool1, struct QDAC_Tag *tag_pool2);
+static int qdac_init_tag_queue(struct qdac_tag_control *tag_c);
+static void qdac_tags_aging(struct qdac_tag_control *tag_c);
 static int qdac_temp_processing(struct qdac_tag_control *tag_c, struct qdac_temp_zone *qdac_zone);
 static int qdac_hightemp_queue_processing(struct qdac_tag_control *tag_c, struct qdac_hightemp_tag *high_temp_tag, struct qdac_temp_zone_tag *qdac_zone);
 static int qdac_lowtemp_queue_processing(struct qdac_tag_control *tag_c, struct qdac_lowtemp_tag *low_temp_tag, struct qdac_temp_zone_tag *qdac_zone);
@@ -399,18 +433,18 @@ static void init_qdac_gforcesensor_parameter(struct qdac_gforcesensor_tag *gforc
 static void init_qdac_currentsensor_parameter(struct qdac_currentsensor_tag *currentsensor_tag);
 static void init_qdac_switchsensor_parameter(struct qdac_switch_tag *switch_tag);
 static void init_qdac_pressuresensor_parameter(struct qdac_pressure_tag *pressure_tag);
-static void qdac_event_gen(struct qdac_tag_control *tag_c, struct tq_head *tqueue, char *temp_des, int tag_out, int arg);
-static struct QDAC_Tag *qdac_temp_tag_event(struct qdac_tag_control *tag_c, struct QDAC_Tag *tag, struct tq_head *tqueue, char *tag_des, int tag_out_time);
+static void qdac_event_gen(struct qdac_tag_control *tag_c, struct tq_head *tqueue, char *temp_des, int arg);
+static void qdac_temp_tag_event(struct QDAC_Tag *tag, char *tag_des);
 static int qdac_temp_event(struct qdac_tag_control *tag_c, struct QDAC_Tag *tag, struct tq_head *tqueue, struct qdac_temp_spec *temp_spec);
 //static void qdac_unknown_event_gen(struct qdac_tag_control *tag_c, struct tq_head *tqueue);
 //static void init_temperature_parameter(struct freezer_control *freezer);
 static void make_qdac_event( struct QDAC_Tag * tag, GPSPoint_t *coord, uint16_t ev_status, time_t timestamp);
 static void make_qdac_temperature_event(struct qdac_tag_control *tag_c, GPSPoint_t *coord, struct qdac_temp_spec *temp_spec, int alarm_type);
 static void make_qdac_status_event(int status, int firm_ver);
-static struct qdac_temp_spec *search_temp_spec(struct qdac_temp_spec **temp_spec, int tag_serial, int tag_type);
-static struct qdac_temp_spec *create_temp_spec(void);
-//static void quicksort(uint32_t *A, int b, int e);
-//static int quick_select(uint32_t *A, int b, int e, int rank);
+static struct qdac_temp_spec *search_temp_spec(uint32_t tag_serial, uint16_t tag_type);
+static struct qdac_temp_spec *create_temp_spec(uint32_t tag_serial, uint16_t tag_type);
+static void unindex_temp_spec(struct qdac_temp_spec *temp_spec);
+static void reset_temp_specs(void);
 static int power_on_qdac(void);
 static int power_off_qdac(void);
 static int set_hub_mode(int mode);
@@ -425,92 +459,25 @@ static void print_response(unsigned char *resp, int length);
 static void print_command(unsigned char *cmd, int cmd_length);
 static int tx_cmd_to_hub(unsigned char *cmd);
 //static unsigned char *rx_resp_from_hub(int *read_length);
-static unsigned char *read_hub_buff(int *actur_rd_len, unsigned int expect_rd_length);
-static unsigned char *rx_resp_from_hub(int *length, int expect_rd_length,  int fun_code);
+static int read_hub_buff(unsigned char *buf, int size);
+static int rx_resp_from_hub(unsigned char *resp, int expect_rd_length,  int fun_code);
 static void qdac_hub_init(void);
-static void qdac_init_gps(void);
 static void print_time(char *des, int serial);
-static void remove_tag(struct qdac_tag_control *tag_c, struct tq_head *tqueue, struct QDAC_Tag *tag); 
+static void clear_tag(struct tq_head *tqueue, struct QDAC_Tag *tag);
+static void remove_tag(struct tq_head *tqueue, struct QDAC_Tag *tag, void **spent);
+static struct QDAC_Tag *evict_tag(struct tq_head *tqueue, struct tag_heap *theap);
 static void qdac_sample_temperature(struct qdac_temp_spec *temp_spec, struct QDAC_Tag *tag);
 static void qdac_encode_temperature(short high, short low, short avg, unsigned char *temp);
 static void qdac_temp_cal(struct qdac_temp_spec *temp_spec);
 static int qdac_cmp_temp(struct qdac_temp_spec *temp_spec);
-static unsigned char *char_to_hex(unsigned char *response, int *actur_rd_len);
-static int copy_recv_data(struct qdac_recv_pkts *pkts_queue, unsigned char **recv_data, int read_length);
-static unsigned char *verify_recv_queue(struct qdac_recv_pkts *pkts_queue, int *verify_status);
+static int char_to_hex(unsigned char *buf, int length);
+static int read_hub_ring(struct qdac_recv_pkts *pkts_queue);
+static bool wait_recv_data(struct qdac_recv_pkts *pkts_queue, uint32_t seen, struct timespec *tick);
+static uint32_t recv_unparsed(struct qdac_recv_pkts *pkts_queue);
+static unsigned char *verify_recv_queue(struct qdac_recv_pkts *pkts_queue, int *verify_status, int *frame_length, uint32_t *seen);
 static unsigned char *find_out_start_byte(unsigned char *pkt, int *parse_error, int queue_length);
 static void move_parse_index(struct qdac_recv_pkts *pkts_queue, int pkt_length);
 static bool is_pkt_empty(struct qdac_recv_pkts *pkts_queue);
-static bool is_pkt_full(struct qdac_recv_pkts *pkts_queue, int read_length);
-/* CRC calculation looking up table */
-unsigned char CRC_hi[] = {
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40
-};
-unsigned char CRC_low[] = {
-0x00, 0xC0, 0xC1, 0x01, 0xC3, 0x03, 0x02, 0xC2,
-0xC6, 0x06, 0x07, 0xC7, 0x05, 0xC5, 0xC4, 0x04,
-0xCC, 0x0C, 0x0D, 0xCD, 0x0F, 0xCF, 0xCE, 0x0E,
-0x0A, 0xCA, 0xCB, 0x0B, 0xC9, 0x09, 0x08, 0xC8,
-0xD8, 0x18, 0x19, 0xD9, 0x1B, 0xDB, 0xDA, 0x1A,
-0x1E, 0xDE, 0xDF, 0x1F, 0xDD, 0x1D, 0x1C, 0xDC,
-0x14, 0xD4, 0xD5, 0x15, 0xD7, 0x17, 0x16, 0xD6,
-0xD2, 0x12, 0x13, 0xD3, 0x11, 0xD1, 0xD0, 0x10,
-0xF0, 0x30, 0x31, 0xF1, 0x33, 0xF3, 0xF2, 0x32,
-0x36, 0xF6, 0xF7, 0x37, 0xF5, 0x35, 0x34, 0xF4,
-0x3C, 0xFC, 0xFD, 0x3D, 0xFF, 0x3F, 0x3E, 0xFE,
-0xFA, 0x3A, 0x3B, 0xFB, 0x39, 0xF9, 0xF8, 0x38,
-0x28, 0xE8, 0xE9, 0x29, 0xEB, 0x2B, 0x2A, 0xEA,
-0xEE, 0x2E, 0x2F, 0xEF, 0x2D, 0xED, 0xEC, 0x2C,
-0xE4, 0x24, 0x25, 0xE5, 0x27, 0xE7, 0xE6, 0x26,
-0x22, 0xE2, 0xE3, 0x23, 0xE1, 0x21, 0x20, 0xE0,
-0xA0, 0x60, 0x61, 0xA1, 0x63, 0xA3, 0xA2, 0x62,
-0x66, 0xA6, 0xA7, 0x67, 0xA5, 0x65, 0x64, 0xA4,
-0x6C, 0xAC, 0xAD, 0x6D, 0xAF, 0x6F, 0x6E, 0xAE,
-0xAA, 0x6A, 0x6B, 0xAB, 0x69, 0xA9, 0xA8, 0x68,
-0x78, 0xB8, 0xB9, 0x79, 0xBB, 0x7B, 0x7A, 0xBA,
-0xBE, 0x7E, 0x7F, 0xBF, 0x7D, 0xBD, 0xBC, 0x7C,
-0xB4, 0x74, 0x75, 0xB5, 0x77, 0xB7, 0xB6, 0x76,
-0x72, 0xB2, 0xB3, 0x73, 0xB1, 0x71, 0x70, 0xB0,
-0x50, 0x90, 0x91, 0x51, 0x93, 0x53, 0x52, 0x92,
-0x96, 0x56, 0x57, 0x97, 0x55, 0x95, 0x94, 0x54,
-0x9C, 0x5C, 0x5D, 0x9D, 0x5F, 0x9F, 0x9E, 0x5E,
-0x5A, 0x9A, 0x9B, 0x5B, 0x99, 0x59, 0x58, 0x98,
-0x88, 0x48, 0x49, 0x89, 0x4B, 0x8B, 0x8A, 0x4A,
-0x4E, 0x8E, 0x8F, 0x4F, 0x8D, 0x4D, 0x4C, 0x8C,
-0x44, 0x84, 0x85, 0x45, 0x87, 0x47, 0x46, 0x86,
-0x82, 0x42, 0x43, 0x83, 0x41, 0x81, 0x80, 0x40
-};
 
 int qdac_initialize(void)
 {
@@ -526,7 +493,10 @@ void * qdac_thread_main(void *args)
 {
 	int n_alarms;
 	int verify_status=0, error=0;
+	int frame_length = 0;
 	unsigned char *tag_data = NULL;
+	uint32_t seen;
+	struct timespec tick;
 	unsigned int reset_min = propGetUInt32AtIndex(PROP_QDAC_RESET_MIN, 1, 3);
 	if (!reset_min)
 		reset_min = 3;
@@ -545,39 +515,28 @@ void * qdac_thread_main(void *args)
 		return NULL;
 	}
 	
-	qdac_tag_pool1 = malloc(NUM_TAGS_PER_POOL * sizeof(struct QDAC_Tag));
-	if (qdac_tag_pool1 == NULL) {
-		perror("Outof Memory");
-		return NULL;
-	}
-	qdac_tag_pool2 = malloc(NUM_TAGS_PER_POOL * sizeof(struct QDAC_Tag));
-	if (qdac_tag_pool2 == NULL) {
+	if (qdac_init_tag_queue(&qdac_recv_tag) < 0) {
 		perror("Outof Memory");
 		return NULL;
 	}
-	memset(qdac_tag_pool1, 0, NUM_TAGS_PER_POOL * sizeof(struct QDAC_Tag));
-	memset(qdac_tag_pool2, 0, NUM_TAGS_PER_POOL * sizeof(struct QDAC_Tag));
-	
-	qdac_init_tag_queue(&qdac_recv_tag, qdac_tag_pool1, qdac_tag_pool2);
 	qdac_init_tag_parameter(&qdac_recv_tag);
 
-	qdac_init_gps();
+	reader_gps_init(&qdac_gps);
 	
+	clock_gettime(CLOCK_REALTIME, &tick);
+	tick.tv_sec += 1;
 	while (qdac_main_running != 0) { 
-		update_gps_trail();
-//		battery_time_checking(&tag_control_1);
-		n_alarms = 0;
 //printf("!!qdac_main_running %d\n", qdac_main_running);
-		pthread_mutex_lock(&qdac_recv_tag.mutex_qdac_pkts);
+		seen = 0;		// unparsed bytes of a partial frame, 0 once the queue is drained
 		while(!is_pkt_empty(&qdac_pkts)) {
-			tag_data=verify_recv_queue(&qdac_pkts,&verify_status);	
+			tag_data=verify_recv_queue(&qdac_pkts,&verify_status,&frame_length,&seen);	
 			if (tag_data == NULL) {
 				if (verify_status < 0) { error -= verify_status; goto error_check;}
 				else if (verify_status > 0) break;	// need to read more data
 			}else if(tag_data != NULL) {
 				error = 0;
 				if(filter_missing_tag(tag_data) < 0) {
-					free(tag_data);
+					move_parse_index(&qdac_pkts, frame_length);
 					continue;
 				}
 
@@ -587,6 +546,7 @@ void * qdac_thread_main(void *args)
 			}
 			else
 */				qdac_parse_tag(&qdac_recv_tag, tag_data);
+				move_parse_index(&qdac_pkts, frame_length);	// done with the frame in the queue
 			}	
 error_check:
 			if(error >= 3) {
@@ -594,7 +554,6 @@ error_check:
 				break;
 			}
 		}
-		pthread_mutex_unlock(&qdac_recv_tag.mutex_qdac_pkts);
 
 		if(error >= 3) {
 			error = 0;
@@ -622,6 +581,13 @@ error_check:
 			}
 		}
 
+		/* parse frames as soon as they arrive, process the tag queues every second */
+		if (!wait_recv_data(&qdac_pkts, seen, &tick))
+			continue;
+
+		reader_gps_update(&qdac_gps);
+		qdac_tags_aging(&qdac_recv_tag);
+//		battery_time_checking(&tag_control_1);
 		n_alarms = qdac_temp_processing(&qdac_recv_tag, &qdac_zone);
 		qdac_gforcesensor_queue_processing(&qdac_recv_tag, &qdac_gforce_sensor);
 		qdac_currentsensor_queue_processing(&qdac_recv_tag, &qdac_current_sensor);
@@ -632,22 +598,15 @@ error_check:
 		
 		if (n_alarms > 0)
 			protocolStartSession();
-
-		sleep(1);
 	}
-	free(qdac_tag_pool1);
-	free(qdac_tag_pool2);
+	tag_pool_free(&qdac_recv_tag.pool);
 	
 	return NULL;
 }
 
 void * qdac_thread_reader(void * thread_args)
 {
-	struct qdac_thread_args * args = (struct qdac_thread_args *)thread_args;	
-	struct qdac_tag_control *tag_c = args->tag_c;
-	int read_length = 0;
 	int verify_res = -1;
-	unsigned char *recv_data = NULL;
 	int read_error = 0;
 	int hub_alive = 0;
 	unsigned int reset_min = propGetUInt32AtIndex(PROP_QDAC_RESET_MIN, 1, 3);
@@ -655,12 +614,6 @@ void * qdac_thread_reader(void * thread_args)
 	if (qdac_reader_running == 0)
 		goto exit_r;
 
-	qdac_pkts.qdac_pkts_queue = (unsigned char *)malloc(PKTS_QUEUE_LENGTH*sizeof(unsigned char));
-	if (qdac_pkts.qdac_pkts_queue == NULL) {
-		perror("qdac_pkts_queue malloc");
-		exit(-1);
-	}
-	memset(qdac_pkts.qdac_pkts_queue , 0, PKTS_QUEUE_LENGTH*sizeof(unsigned char));
 	qdac_pkts.read_index = 0;
 	qdac_pkts.parse_index = 0;
 	qdac_pkts.queue_unparse_length = 0;
@@ -668,9 +621,8 @@ void * qdac_thread_reader(void * thread_args)
 	while (1) {
 //printf("!!qdac_hub_reset: %d\n", qdac_hub_reset);
 //		pthread_mutex_lock(&tag_c->mutex_hub_ctrl);
-		read_length = 0;
 		if (!qdac_hub_reset)
-			recv_data=rx_resp_from_hub(&read_length, RESPONSE_MAX_SIZE*sizeof(unsigned char), READ_TAG_DATA);
+			read_hub_ring(&qdac_pkts);
 		else {
 			if(qdac_test == DEBUG_PORT) 
 				sleep(MINUTES);
@@ -679,7 +631,7 @@ void * qdac_thread_reader(void * thread_args)
 			continue;
 		}
 //		pthread_mutex_unlock(&tag_c->mutex_hub_ctrl);
-/*		if(recv_data == NULL)  {
+/*		if(read_length == 0)  {
 //			printf("detect hub if alive\n");
 //			pthread_mutex_lock(&tag_c->mutex_hub_ctrl);
 			hub_alive = read_hub_version();			// if no data being read in 10 secs, send cmd to read hub version to make sure the hub is alive.
@@ -692,25 +644,7 @@ void * qdac_thread_reader(void * thread_args)
 				continue;
 			} 
 		}
-*/		if (read_length) {
-//print_response(recv_data, read_length);
-			do {
-				pthread_mutex_lock(&tag_c->mutex_qdac_pkts);
-				qdac_reader_running = copy_recv_data(&qdac_pkts, &recv_data, read_length);
-				pthread_mutex_unlock(&tag_c->mutex_qdac_pkts);
-				if(qdac_debug) {
-//					printf("%s: ", __FUNCTION__);
-//					printf("Copy to buff Length: %d\n", read_length);
-//					printf("Cur read_index: %d\n", qdac_pkts.read_index);
-//					printf("Pkt unparse Length: %d\n",qdac_pkts.queue_unparse_length);
-//					print_response(recv_data, read_length);
-//					printf("add: %p\n", qdac_pkts.qdac_pkts_queue);
-				}
-				if(!qdac_reader_running)
-					sleep(1);
-			} while(!qdac_reader_running);
-		}
-	}
+*/	}
 	qdac_reader_running = 0;
 
 exit_r:
@@ -718,56 +652,72 @@ exit_r:
 	return NULL;
 }
 
-static bool is_pkt_full(struct qdac_recv_pkts *pkts_queue, int read_length) {
-	uint32_t unparse_length = pkts_queue->queue_unparse_length;
-	if(unparse_length + read_length > PKTS_QUEUE_LENGTH)
-		return true;
-	else
-		return false;
-}
 static bool is_pkt_empty(struct qdac_recv_pkts *pkts_queue) {
-	uint32_t unparse_length = pkts_queue->queue_unparse_length;
+	uint32_t unparse_length = recv_unparsed(pkts_queue);
 	if(unparse_length == 0)
 		return true;
 	else
 		return false;
 }
-static int copy_recv_data(struct qdac_recv_pkts *pkts_queue, unsigned char **recv_data, int read_length) {
-	int pkt_rest = 0;
+// read_hub_ring reads from the hub straight into the free space at the read_index
+// of the queue, waiting for the parser to make space if the queue is full. Only
+// this reader writes there, so the read itself is done without the lock.
+// Returns the bytes added, 0 if nothing was read.
+static int read_hub_ring(struct qdac_recv_pkts *pkts_queue) {
 	int read_index = pkts_queue->read_index;
-	int parse_index = pkts_queue->parse_index;
-//	int unparse_length = pkts_queue->queue_unparse_length;
-	unsigned char *queue = pkts_queue->qdac_pkts_queue;
-	bool full_res;
-//	if (read_index+1 >= parse_index) 		// queue is full
-//		goto queue_full;
-//	else {
-//printf("%s: before copy: read_index %d - parse_index:%d\n", __FUNCTION__, read_index, parse_index);
-	full_res = is_pkt_full(pkts_queue, read_length);
-	if (full_res) 
-		goto queue_full;
-	else{
-		pkt_rest = PKTS_QUEUE_LENGTH - read_index;
-		if (pkt_rest < read_length) {
-			memcpy(queue+read_index, *recv_data, pkt_rest*sizeof(unsigned char));
-			memcpy(queue, *recv_data+pkt_rest, (read_length-pkt_rest)*sizeof(unsigned char));
-			pkts_queue->read_index = read_length-pkt_rest;
-		} else {
-			memcpy(queue+read_index, *recv_data, read_length*sizeof(unsigned char));
-			pkts_queue->read_index += read_length;
-			if (pkts_queue->read_index == PKTS_QUEUE_LENGTH)
-				pkts_queue->read_index = 0;
-		}
-	} 
+	int space, read_length;
+
+	pthread_mutex_lock(&pkts_queue->mutex);
+	while (pkts_queue->queue_unparse_length == PKTS_QUEUE_LENGTH)
+		pthread_cond_wait(&pkts_queue->more_space, &pkts_queue->mutex);
+	space = PKTS_QUEUE_LENGTH - pkts_queue->queue_unparse_length;
+	pthread_mutex_unlock(&pkts_queue->mutex);
+	if (space > PKTS_QUEUE_LENGTH - read_index)		// up to the end of the queue at most
+		space = PKTS_QUEUE_LENGTH - read_index;
+	read_length = read_hub_buff(pkts_queue->qdac_pkts_queue+read_index, space);
+	if (read_length <= 0)
+		return 0;
+
+	read_index += read_length;
+	if (read_index == PKTS_QUEUE_LENGTH)
+		read_index = 0;
+	pkts_queue->read_index = read_index;
+	pthread_mutex_lock(&pkts_queue->mutex);
 	pkts_queue->queue_unparse_length += read_length;
-	free(*recv_data);
-	*recv_data = NULL;
+	pthread_cond_signal(&pkts_queue->more_data);
+	pthread_mutex_unlock(&pkts_queue->mutex);
 	return read_length;
+}
 
-queue_full:
-	printf("pkts queue is full already, waiting for space & no more reading\n");
-//	qdac_reader_running = 0;
-	return 0;
+// wait_recv_data waits until the queue holds more than the 'seen' unparsed bytes,
+// or until 'tick'. Returns true when the tick is due, and sets the next one.
+static bool wait_recv_data(struct qdac_recv_pkts *pkts_queue, uint32_t seen, struct timespec *tick) {
+	struct timespec now;
+	int err = 0;
+
+	pthread_mutex_lock(&pkts_queue->mutex);
+	while (pkts_queue->queue_unparse_length == seen && err != ETIMEDOUT)
+		err = pthread_cond_timedwait(&pkts_queue->more_data, &pkts_queue->mutex, tick);
+	pthread_mutex_unlock(&pkts_queue->mutex);
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	if (now.tv_sec < tick->tv_sec || (now.tv_sec == tick->tv_sec && now.tv_nsec < tick->tv_nsec)) {
+		if (tick->tv_sec - now.tv_sec <= 1)
+			return false;
+		*tick = now;				// the clock went back
+	} else if (now.tv_sec - tick->tv_sec > 1)
+		*tick = now;				// late, or the clock went forward
+	tick->tv_sec += 1;
+	return true;
+}
+
+static uint32_t recv_unparsed(struct qdac_recv_pkts *pkts_queue) {
+	uint32_t unparse_length;
+
+	pthread_mutex_lock(&pkts_queue->mutex);
+	unparse_length = pkts_queue->queue_unparse_length;
+	pthread_mutex_unlock(&pkts_queue->mutex);
+	return unparse_length;
 }
 
 // qdac_Verify_tag_packet returns the Error counts: 1 error: -1; 2 error -2;...
@@ -812,7 +762,7 @@ print_response(pkt_start, pkt_length);
 		printf("!!Function code error\n");
 		error -= 1;				
 	} else {
-			crc_cal= qdac_crc16(pkt_start+1, 2+payload_length); 				// 3. check CRC
+			crc_cal= cksumCalcCRC16(pkt_start+1, 2+payload_length); 				// 3. check CRC
 			crc_index = 3 + payload_length;
 			crc_recv = *(pkt_start+crc_index+1) << 8 | *(pkt_start+crc_index);
 			if (crc_cal != crc_recv) {                 							// if CRC error, assumes that the starting "0xAA" is not expected, find the next one.
@@ -832,9 +782,11 @@ print_response(pkt_start, pkt_length);
 static void qdac_parse_tag(struct qdac_tag_control *tag_c, unsigned char *pkt) 
 {
 	uint32_t serial; 
-	int max_period;
+	int max_period, out_time;
 	struct QDAC_Tag *tag = NULL; 
 	struct tq_head *tqueue;
+	struct tag_index *tindex;
+	struct tag_heap *theap;
 	pthread_mutex_t *pmutex;
 	struct timespec tsnow;
 	uint16_t data = 0xFFFF;
@@ -847,39 +799,63 @@ static void qdac_parse_tag(struct qdac_tag_control *tag_c, unsigned char *pkt)
 	tag_type = ((pkt[22] << 8) | pkt[21]);
 	if (tag_type == LOW_TEMP_TAG) {
 		max_period = qdac_low_temp.tag_in_time;
+		out_time = qdac_low_temp.tag_out_time;
 		tqueue = &tag_c->qdac_lowtemp_queue;
+		tindex = &tag_c->lowtemp_index;
+		theap = &tag_c->lowtemp_heap;
 		pmutex = &tag_c->mutex_qdac_lowtemp;
 	} else if (tag_type == HIGH_TEMP_TAG) {
 			max_period = qdac_high_temp.tag_in_time;
+			out_time = qdac_high_temp.tag_out_time;
 			tqueue = &tag_c->qdac_hightemp_queue;
+			tindex = &tag_c->hightemp_index;
+			theap = &tag_c->hightemp_heap;
 			pmutex = &tag_c->mutex_qdac_hightemp;
 	} else if (tag_type == GFORCE_SENSOR_TAG) {
 			max_period = qdac_gforce_sensor.tag_in_time;
+			out_time = qdac_gforce_sensor.tag_out_time;
 			tqueue = &tag_c->qdac_gforcesensor_queue;
+			tindex = &tag_c->gforcesensor_index;
+			theap = &tag_c->gforcesensor_heap;
 			pmutex = &tag_c->mutex_qdac_gforcesensor;
 	} else if (tag_type == CURRENT_SENSOR_TAG) {
 			max_period = qdac_current_sensor.tag_in_time;
+			out_time = qdac_current_sensor.tag_out_time;
 			tqueue = &tag_c->qdac_currentsensor_queue;
+			tindex = &tag_c->currentsensor_index;
+			theap = &tag_c->currentsensor_heap;
 			pmutex = &tag_c->mutex_qdac_currentsensor;
 	} else if (tag_type == SWITCH_TAG) {
 			max_period = qdac_switch_sensor.tag_in_time;
+			out_time = qdac_switch_sensor.tag_out_time;
 			tqueue = &tag_c->qdac_switchsensor_queue;
+			tindex = &tag_c->switchsensor_index;
+			theap = &tag_c->switchsensor_heap;
 			pmutex = &tag_c->mutex_qdac_switchsensor; 
 	} else if (tag_type == PRESSURE_TAG) {
 			max_period = qdac_pressure_sensor.tag_in_time;
+			out_time = qdac_pressure_sensor.tag_out_time;
 			tqueue = &tag_c->qdac_pressuresensor_queue;
+			tindex = &tag_c->pressuresensor_index;
+			theap = &tag_c->pressuresensor_heap;
 			pmutex = &tag_c->mutex_qdac_pressuresensor; 	
 	} else if (tag_type == tmp_type1 || tag_type ==tmp_type2) { //temperary type of tag
 			if (qdac_debug)
 				printf("a Tmporary Tag %d is found\n", serial);
 			max_period = qdac_tmp.tag_in_time;
+			out_time = qdac_tmp.tag_out_time;
 			tqueue = &tag_c->qdac_tmp_queue;
+			tindex = &tag_c->tmp_index;
+			theap = &tag_c->tmp_heap;
 			pmutex = &tag_c->mutex_qdac_tmp;
 	} else { // unknown type
 		if (qdac_debug)
 			printf("a Unknown Tag %d is found\n", serial);
 		max_period = qdac_unknown.tag_in_time;
+		out_time = qdac_unknown.tag_out_time;
 		tqueue = &tag_c->qdac_unknown_queue;
+		tindex = &tag_c->unknown_index;
+		theap = &tag_c->unknown_heap;
 		pmutex = &tag_c->mutex_qdac_unknown;
 	}
 
@@ -888,21 +864,24 @@ static void qdac_parse_tag(struct qdac_tag_control *tag_c, unsigned char *pkt)
 		return;
 	}
 	pthread_mutex_lock(pmutex);
-	tag = qdac_search_tag(tqueue, serial);	
+	tag = (struct QDAC_Tag *)tag_index_search(tindex, serial);
 	if (tag == NULL) {
-		if (TAILQ_EMPTY(&tag_c->recycle_queue)) {
+		if (tindex->count >= tag_c->pool.role_quota || (tag = tag_pool_alloc(&tag_c->pool)) == NULL)
+			tag = evict_tag(tqueue, theap);
+		if (tag == NULL) {
 			pthread_mutex_unlock(pmutex);
+			if (tag_pool_drop(&tag_c->pool, tsnow.tv_sec))
+				printf("QDAC tag pool exhausted (%u tags, type %d)\n", tag_c->pool.num_tags, tag_type);
 			return;
 		}
-		pthread_mutex_lock(&tag_c->mutex_recycle);
-		tag = tag_c->recycle_queue.tqh_first;
-		TAILQ_REMOVE(&tag_c->recycle_queue, tag, link);
-		pthread_mutex_unlock(&tag_c->mutex_recycle);		
 		TAILQ_INSERT_TAIL(tqueue, tag, link);
 /* init some key elements for the struct QDAC_tag */
-		tag->raw_data = NULL;
+		tag->qdac_tag_serial = serial;
+		tag_index_add(tindex, serial, tag);
+		tag->tindex = tindex;
 		tag->raw_data_length = 0;
 		tag->status = 0;
+		tag_heap_arm(theap, &tag->timer, tag, &tag->recent, tsnow.tv_sec + out_time);
 	} else if (!(tag->status & (TAG_FRESH | TAG_SENIOR))) {
 		if (qdac_admit_tag(tag, tsnow.tv_sec, max_period))
 			tag->status |= TAG_FRESH;
@@ -950,15 +929,19 @@ static void qdac_parse_tag(struct qdac_tag_control *tag_c, unsigned char *pkt)
 		tag->qdac_pressure= data;
 	} else {		// unknown tag and the temperary tag
 			tag->raw_data_length = pkt[2]  - 23; 
-			if (tag->raw_data != NULL)
+			if (tag->raw_data_length < 0)
+				tag->raw_data_length = 0;
+			if (tag->raw_data_length > tag->raw_data_size) {		// the buffer only grows, and stays with the tag slot
 				free(tag->raw_data);
-			if (tag->raw_data_length) {
 				tag->raw_data = (unsigned char *)malloc((tag->raw_data_length)*sizeof(unsigned char));
-				if (tag->raw_data == NULL)
+				tag->raw_data_size = tag->raw_data_length;
+				if (tag->raw_data == NULL) {
 					perror("tag->raw_data malloc");
-				memset(tag->raw_data, 0, (tag->raw_data_length)*sizeof(unsigned char));
-				memcpy(tag->raw_data, pkt+26, (tag->raw_data_length)*sizeof(unsigned char));
+					tag->raw_data_size = tag->raw_data_length = 0;
+				}
 			}
+			if (tag->raw_data_length)
+				memcpy(tag->raw_data, pkt+26, (tag->raw_data_length)*sizeof(unsigned char));
 	}
 	tag->recent = tsnow.tv_sec;
 }
@@ -986,17 +969,6 @@ static int filter_missing_tag( unsigned char *pkt)
 	return res;
 }
 
-static struct QDAC_Tag *qdac_search_tag(struct tq_head *tqueue, uint32_t serial)
-{
-	struct QDAC_Tag *tag = NULL;
-	if (TAILQ_EMPTY(tqueue))
-		return tag;
-	TAILQ_FOREACH(tag, tqueue, link) {
-		if (tag->qdac_tag_serial == serial)
-			break;
-	}
-	return tag;
-}
 static bool qdac_admit_tag(struct QDAC_Tag *tag, time_t now, int period)
 {
 	return (now - tag->recent <= period);
@@ -1061,8 +1033,8 @@ static int qdac_temp_processing(struct qdac_tag_control *tag_c, struct qdac_temp
 					if (alarm_flag_cur & (1 << i)) {
 						qdac_zone_tag = &(qdac_zone->qdac_zone_tag[i]);
 						if(qdac_zone_tag->zone_own_spec == NULL) {printf("!!zone_spec NULL\n"); break;}
-						temp_spec = search_temp_spec(&(qdac_zone_tag->zone_own_spec), qdac_zone_tag->qdac_serial, qdac_zone_tag->qdac_tag_type);
- 						make_qdac_temperature_event(tag_c, &gpsFresh.point, temp_spec, temp_spec->alarm_type);
+						temp_spec = qdac_zone_tag->zone_own_spec;
+ 						make_qdac_temperature_event(tag_c, &qdac_gps.fresh.point, temp_spec, temp_spec->alarm_type);
 					}
 					i++;
 				}
@@ -1123,7 +1095,7 @@ static int qdac_lowtemp_queue_processing (struct qdac_tag_control *tag_c, struct
 	for (tag = tqueue->tqh_first; tag != NULL; tag = tag->link.tqe_next) {	
 		if(tag_c->primary_id) {
 			if(qdac_zone_tag->qdac_serial == tag->qdac_tag_serial) {
-				lowtemp_spec=search_temp_spec(&(low_temp_tag->qdac_lowtemp_tag_spec), tag->qdac_tag_serial, tag->qdac_tag_type);
+				lowtemp_spec=search_temp_spec(tag->qdac_tag_serial, tag->qdac_tag_type);
 				lowtemp_spec->zone_id = qdac_zone_tag->zone_id;
 				lowtemp_spec->set_high = qdac_zone_tag->qdac_zone_temp_max;
 				lowtemp_spec->set_low = qdac_zone_tag->qdac_zone_temp_min;
@@ -1133,17 +1105,15 @@ static int qdac_lowtemp_queue_processing (struct qdac_tag_control *tag_c, struct
 				continue;
 		}
 		else {
-			lowtemp_spec=search_temp_spec(&(low_temp_tag->qdac_lowtemp_tag_spec), tag->qdac_tag_serial, tag->qdac_tag_type);
+			lowtemp_spec=search_temp_spec(tag->qdac_tag_serial, tag->qdac_tag_type);
 		}
 		lowtemp_spec->qdac_tag_model = tag->qdac_tag_model;
-		tag = qdac_temp_tag_event(tag_c, tag, tqueue, "Low Temperature", low_temp_tag->tag_out_time);
-		if (tag == NULL)
-				break;
+		qdac_temp_tag_event(tag, "Low Temperature");
 		if (tag->status & (TAG_FRESH | TAG_SENIOR)) {
 			qdac_sample_temperature(lowtemp_spec, tag);
 			alarm = qdac_temp_event(tag_c, tag, tqueue, lowtemp_spec);
 			if(report_norm_temp_event && (alarm == QDAC_ALARM_NORM)) {
-				make_qdac_temperature_event(tag_c, &gpsFresh.point, lowtemp_spec, alarm);	
+				make_qdac_temperature_event(tag_c, &qdac_gps.fresh.point, lowtemp_spec, alarm);	
 			}	
 			if(tag_c->primary_id && (qdac_zone_tag->qdac_serial == tag->qdac_tag_serial))		
 				break;
@@ -1191,7 +1161,7 @@ static int qdac_hightemp_queue_processing(struct qdac_tag_control *tag_c, struct
 	for (tag = tqueue->tqh_first; tag != NULL; tag = tag->link.tqe_next) {			
 		if(tag_c->primary_id) {
 			if(qdac_zone_tag->qdac_serial == tag->qdac_tag_serial) {
-				hightemp_spec = search_temp_spec(&(high_temp_tag->qdac_hightemp_tag_spec),tag->qdac_tag_serial, tag->qdac_tag_type);			
+				hightemp_spec = search_temp_spec(tag->qdac_tag_serial, tag->qdac_tag_type);			
 				hightemp_spec->zone_id = qdac_zone_tag->zone_id;
 				hightemp_spec->set_high = qdac_zone_tag->qdac_zone_temp_max;
 				hightemp_spec->set_low = qdac_zone_tag->qdac_zone_temp_min;
@@ -1200,17 +1170,15 @@ static int qdac_hightemp_queue_processing(struct qdac_tag_control *tag_c, struct
 			} else	
 				continue;		
 		} else {
-			hightemp_spec = search_temp_spec(&(high_temp_tag->qdac_hightemp_tag_spec),tag->qdac_tag_serial, tag->qdac_tag_type);
+			hightemp_spec = search_temp_spec(tag->qdac_tag_serial, tag->qdac_tag_type);
 		}
 		hightemp_spec->qdac_tag_model = tag->qdac_tag_model;
-		tag = qdac_temp_tag_event(tag_c, tag, tqueue, "High Temperature", high_temp_tag->tag_out_time);
-		if (tag == NULL)
-			break;
+		qdac_temp_tag_event(tag, "High Temperature");
 		if (tag->status & (TAG_FRESH | TAG_SENIOR)) {
 			qdac_sample_temperature(hightemp_spec, tag);
 			alarm = qdac_temp_event(tag_c, tag, tqueue, hightemp_spec);
 			if(report_norm_temp_event && (alarm == QDAC_ALARM_NORM)) {
-				make_qdac_temperature_event(tag_c, &gpsFresh.point, hightemp_spec, alarm);	
+				make_qdac_temperature_event(tag_c, &qdac_gps.fresh.point, hightemp_spec, alarm);	
 			}	
 			if(tag_c->primary_id && (qdac_zone_tag->qdac_serial == tag->qdac_tag_serial))	
 				break;
@@ -1239,7 +1207,7 @@ static void qdac_gforcesensor_queue_processing(struct qdac_tag_control *tag_c, s
 			return;
 //printf("%s\n", __FUNCTION__);
 		pthread_mutex_lock(&tag_c->mutex_qdac_gforcesensor);
-		qdac_event_gen(tag_c, tqueue, "G-force Sensor", gforce_sensor_tag->tag_out_time, gforce_sensor_tag->report_threshold);
+		qdac_event_gen(tag_c, tqueue, "G-force Sensor", gforce_sensor_tag->report_threshold);
 		pthread_mutex_unlock(&tag_c->mutex_qdac_gforcesensor);
 //	} else
 //		return;
@@ -1266,7 +1234,7 @@ static void qdac_currentsensor_queue_processing(struct qdac_tag_control *tag_c,
 		if (TAILQ_EMPTY(tqueue)) return;
 	
 		pthread_mutex_lock(&tag_c->mutex_qdac_currentsensor);
-		qdac_event_gen(tag_c, tqueue, "Current Sensor", current_sensor_tag->tag_out_time, 0);
+		qdac_event_gen(tag_c, tqueue, "Current Sensor", 0);
 		pthread_mutex_unlock(&tag_c->mutex_qdac_currentsensor);
 	} else
 		return;
@@ -1293,7 +1261,7 @@ static void qdac_switchsensor_queue_processing(struct qdac_tag_control *tag_c, s
 		if (TAILQ_EMPTY(tqueue)) return;
 	
 		pthread_mutex_lock(&tag_c->mutex_qdac_switchsensor);
-		qdac_event_gen(tag_c, tqueue, "Switch Sensor", switch_tag->tag_out_time, 0);
+		qdac_event_gen(tag_c, tqueue, "Switch Sensor", 0);
 		pthread_mutex_unlock(&tag_c->mutex_qdac_switchsensor);
 	} else
 		return;
@@ -1320,7 +1288,7 @@ static void qdac_pressuresensor_queue_processing(struct qdac_tag_control *tag_c,
 		if (TAILQ_EMPTY(tqueue)) return;
 	
 		pthread_mutex_lock(&tag_c->mutex_qdac_pressuresensor);
-		qdac_event_gen(tag_c, tqueue, "Pressure Sensor", pressure_tag->tag_out_time, 0);
+		qdac_event_gen(tag_c, tqueue, "Pressure Sensor", 0);
 		pthread_mutex_unlock(&tag_c->mutex_qdac_pressuresensor);
 	} else
 		return;
@@ -1346,7 +1314,7 @@ static void qdac_unknown_queue_processing(struct qdac_tag_control *tag_c, struct
 		if (TAILQ_EMPTY(tqueue))
 			return;
 		pthread_mutex_lock(&tag_c->mutex_qdac_unknown);
-		qdac_event_gen(tag_c, tqueue, "Unknown", unknown_tag->tag_out_time, 0);
+		qdac_event_gen(tag_c, tqueue, "Unknown", 0);
 		pthread_mutex_unlock(&tag_c->mutex_qdac_unknown);
 	} else
 		return;
@@ -1371,42 +1339,21 @@ static void qdac_tmp_queue_processing(struct qdac_tag_control *tag_c, struct qda
 		if (TAILQ_EMPTY(tqueue))
 			return;
 		pthread_mutex_lock(&tag_c->mutex_qdac_tmp);
-		qdac_event_gen(tag_c, tqueue, "Temporary", tmp_tag->tag_out_time, 0);
+		qdac_event_gen(tag_c, tqueue, "Temporary", 0);
 		pthread_mutex_unlock(&tag_c->mutex_qdac_tmp);
 	} else
 		return;
 }
 
-static struct QDAC_Tag *qdac_temp_tag_event(struct qdac_tag_control *tag_c, struct QDAC_Tag *tag, struct tq_head *tqueue, char *tag_des, //int tag_type,
-	int tag_out_time) {	
-	struct QDAC_Tag *tag1;
-	time_t now, past;
-
-	now = time(NULL);
-	past = now - tag_out_time;
-
-	if (tag->recent < past) {
-		if (tag->status & TAG_SENIOR) {
-			make_qdac_event(tag, backtrack_gps_trail(now - tag->recent), STATUS_QDAC_PRIMARY_OUT, now);
-			print_time(tag_des, tag->qdac_tag_serial);
-			printf("Primary Tag Out\n");	
-		}
-		tag1 = tag->link.tqe_next;
-		remove_tag(tag_c, tqueue, tag);
-		if (tag1 == NULL)
-			return NULL;
-		else
-			return tag1;
-	} else { /*IN processing */
-		if (tag->status & TAG_FRESH) {
-			tag->status &= ~TAG_FRESH;
-			tag->status |= TAG_SENIOR;
-			make_qdac_event(tag, &gpsFresh.point, STATUS_QDAC_PRIMARY_IN, now);
-			print_time(tag_des, tag->qdac_tag_serial); 
-			print_debug("Primary Tag In\n");
-		} 
-		return tag;
-	}
+/* IN processing, the tags gone out were already taken off by qdac_tags_aging() */
+static void qdac_temp_tag_event(struct QDAC_Tag *tag, char *tag_des) {	
+	if (tag->status & TAG_FRESH) {
+		tag->status &= ~TAG_FRESH;
+		tag->status |= TAG_SENIOR;
+		make_qdac_event(tag, &qdac_gps.fresh.point, STATUS_QDAC_PRIMARY_IN, time(NULL));
+		print_time(tag_des, tag->qdac_tag_serial); 
+		print_debug("Primary Tag In\n");
+	} 
 }
 
 static int qdac_temp_event(struct qdac_tag_control *tag_c, struct QDAC_Tag *tag, struct tq_head *tqueue, struct qdac_temp_spec *temp_spec)
@@ -1428,41 +1375,27 @@ static int qdac_temp_event(struct qdac_tag_control *tag_c, struct QDAC_Tag *tag,
 	return alarm_type;
 }
 
-static void qdac_event_gen(struct qdac_tag_control *tag_c, struct tq_head *tqueue, char *temp_des, int  tag_out_time, int arg) 
+/* IN and report processing, the tags gone out were already taken off by qdac_tags_aging() */
+static void qdac_event_gen(struct qdac_tag_control *tag_c, struct tq_head *tqueue, char *temp_des, int arg) 
 {
-	struct QDAC_Tag *tag, *tag1;
-	time_t now, past;
+	struct QDAC_Tag *tag;
+	time_t now;
 //	struct tm tm1; 
 //	struct tm *ptm;
 	now = time(NULL);
-	
-	past = now -tag_out_time;
 
 	for (tag = tqueue->tqh_first; tag != NULL; tag = tag->link.tqe_next) {	
-		if (tag->recent < past) {
-			if (tag->status & TAG_SENIOR) {
-					make_qdac_event(tag, backtrack_gps_trail(now - tag->recent), STATUS_QDAC_TAG_OUT, now);	
-					print_time(temp_des, tag->qdac_tag_serial);
-					printf("Tag OUT \n");
-			}
-			tag1 = tag->link.tqe_next;
-			remove_tag(tag_c, tqueue, tag);
-			if (tag1 == NULL)
-				break;
-			tag = tag1;			
-		}
-
 		if ((tag->status & TAG_FRESH)) {
 			if (tag->qdac_tag_type == GFORCE_SENSOR_TAG) { // for the g-force sensor tag, make event if g-force > 11
 				 if(tag->qdac_gforce > arg) {
-					make_qdac_event(tag, &gpsFresh.point, STATUS_QDAC_TAG_IN, now);
+					make_qdac_event(tag, &qdac_gps.fresh.point, STATUS_QDAC_TAG_IN, now);
 					print_time(temp_des, tag->qdac_tag_serial); 
 					printf("Tag IN\n");
 					tag->qdac_gforce = 0;
 				 }
 			}
 			else {
-				make_qdac_event(tag, &gpsFresh.point, STATUS_QDAC_TAG_IN, now);
+				make_qdac_event(tag, &qdac_gps.fresh.point, STATUS_QDAC_TAG_IN, now);
 				print_time(temp_des, tag->qdac_tag_serial); 
 				printf("Tag IN\n");
 			}	
@@ -1474,14 +1407,14 @@ static void qdac_event_gen(struct qdac_tag_control *tag_c, struct tq_head *tqueu
 					if(qdac_debug) {
 						printf("%u: G-force %d\n", tag->qdac_tag_serial, tag->qdac_gforce);
 					}
-					make_qdac_event(tag, &gpsFresh.point, STATUS_QDAC_TAG_IN, now);
+					make_qdac_event(tag, &qdac_gps.fresh.point, STATUS_QDAC_TAG_IN, now);
 					print_time(temp_des, tag->qdac_tag_serial); 
 					printf("Tag IN\n");
 					tag->qdac_gforce = 0;
 				}
 			}
 			else {
-				make_qdac_event(tag, &gpsFresh.point, STATUS_QDAC_TAG_IN, now);
+				make_qdac_event(tag, &qdac_gps.fresh.point, STATUS_QDAC_TAG_IN, now);
 				print_time(temp_des, tag->qdac_tag_serial); 
 				printf("Tag IN\n");
 				}
@@ -1489,6 +1422,52 @@ static void qdac_event_gen(struct qdac_tag_control *tag_c, struct tq_head *tqueu
 	}
 }
 
+/* Tag-out processing.  The tags of a queue are aged off its tag_heap as
+ * their deadlines pass, instead of sweeping the whole queue: an admitted tag
+ * gets an OUT event at the position it was last heard, and goes back to the
+ * pool. */
+static void qdac_queue_aging(struct qdac_tag_control *tag_c, struct tq_head *tqueue, struct tag_heap *theap,
+	pthread_mutex_t *pmutex, int out_time, uint16_t ev_status, char *tag_des, time_t now)
+{
+	struct QDAC_Tag *tag;
+	void *spent = NULL;
+
+	pthread_mutex_lock(pmutex);
+	while ((tag = (struct QDAC_Tag *)tag_heap_expire(theap, now, out_time)) != NULL) {
+		if (tag->status & TAG_SENIOR) {
+			make_qdac_event(tag, reader_gps_point_at(&qdac_gps, tag->recent), ev_status, now);
+			print_time(tag_des, tag->qdac_tag_serial);
+			printf("%s\n", (ev_status == STATUS_QDAC_PRIMARY_OUT)? "Primary Tag Out" : "Tag OUT ");
+		}
+		remove_tag(tqueue, tag, &spent);
+	}
+	pthread_mutex_unlock(pmutex);
+	tag_pool_release(&tag_c->pool, &spent);
+}
+
+/* age all the queues, every processing period */
+static void qdac_tags_aging(struct qdac_tag_control *tag_c)
+{
+	time_t now = time(NULL);
+
+	qdac_queue_aging(tag_c, &tag_c->qdac_lowtemp_queue, &tag_c->lowtemp_heap, &tag_c->mutex_qdac_lowtemp,
+		qdac_low_temp.tag_out_time, STATUS_QDAC_PRIMARY_OUT, "Low Temperature", now);
+	qdac_queue_aging(tag_c, &tag_c->qdac_hightemp_queue, &tag_c->hightemp_heap, &tag_c->mutex_qdac_hightemp,
+		qdac_high_temp.tag_out_time, STATUS_QDAC_PRIMARY_OUT, "High Temperature", now);
+	qdac_queue_aging(tag_c, &tag_c->qdac_gforcesensor_queue, &tag_c->gforcesensor_heap, &tag_c->mutex_qdac_gforcesensor,
+		qdac_gforce_sensor.tag_out_time, STATUS_QDAC_TAG_OUT, "G-force Sensor", now);
+	qdac_queue_aging(tag_c, &tag_c->qdac_currentsensor_queue, &tag_c->currentsensor_heap, &tag_c->mutex_qdac_currentsensor,
+		qdac_current_sensor.tag_out_time, STATUS_QDAC_TAG_OUT, "Current Sensor", now);
+	qdac_queue_aging(tag_c, &tag_c->qdac_switchsensor_queue, &tag_c->switchsensor_heap, &tag_c->mutex_qdac_switchsensor,
+		qdac_switch_sensor.tag_out_time, STATUS_QDAC_TAG_OUT, "Switch Sensor", now);
+	qdac_queue_aging(tag_c, &tag_c->qdac_pressuresensor_queue, &tag_c->pressuresensor_heap, &tag_c->mutex_qdac_pressuresensor,
+		qdac_pressure_sensor.tag_out_time, STATUS_QDAC_TAG_OUT, "Pressure Sensor", now);
+	qdac_queue_aging(tag_c, &tag_c->qdac_unknown_queue, &tag_c->unknown_heap, &tag_c->mutex_qdac_unknown,
+		qdac_unknown.tag_out_time, STATUS_QDAC_TAG_OUT, "Unknown", now);
+	qdac_queue_aging(tag_c, &tag_c->qdac_tmp_queue, &tag_c->tmp_heap, &tag_c->mutex_qdac_tmp,
+		qdac_tmp.tag_out_time, STATUS_QDAC_TAG_OUT, "Temporary", now);
+}
+
 static void make_qdac_status_event(int status, int firm_ver) {
 	time_t now;
 	Packet_t up_pkt;
@@ -1643,7 +1622,7 @@ static void make_qdac_temperature_event(struct qdac_tag_control *tag_c, GPSPoint
 		printf("Normal\n");
 		// toggle the pin 
 		if(trig_alarm_pin) {
-			system("/usr/local/bin/disalarm");
+			gpio_out_set(GPIO_OUT_ALARM, false);
 			trig_alarm_pin = false;
 		}
 	} else if (alarm_type == QDAC_ALARM_HIGH) {
@@ -1653,7 +1632,7 @@ static void make_qdac_temperature_event(struct qdac_tag_control *tag_c, GPSPoint
 		printf("High\n");
 		// toggle the pin 
 		if (!trig_alarm_pin) {
-			system("/usr/local/bin/trig_alarm");
+			gpio_out_set(GPIO_OUT_ALARM, true);
 			trig_alarm_pin = true;
 		}
 	} else if (alarm_type == QDAC_ALARM_LOW) {
@@ -1664,7 +1643,7 @@ static void make_qdac_temperature_event(struct qdac_tag_control *tag_c, GPSPoint
 		printf("Low\n");
 		// toggle the pin 
 		if (!trig_alarm_pin) {
-			system("/usr/local/bin/trig_alarm");
+			gpio_out_set(GPIO_OUT_ALARM, true);
 			trig_alarm_pin = true;
 		}
 	}
@@ -1735,58 +1714,7 @@ static int qdac_read_temperature_alarm(struct freezer_control *freezer, unsigned
 }
 */
 
-static int gps_trail_next = 0;
-static bool gps_trail_length = 0;
-static bool gps_trail_valid = false;
-static void update_gps_trail(void)
-{
-	GPS_t * gps_latest;
-	gps_latest = gpsGetLastGPS(&gpsFleeting, USHRT_MAX);
-	if (gps_latest == (GPS_t *)0) {
-		if (gps_trail_valid) {
-			gps_trail_next = 0;
-			gps_trail_length = 0;
-			gps_trail_valid = false;
-		}
-	} else {
-		gpsCopy(&gpsFresh, &gpsFleeting);
-		gps_trail_valid = true;
-		if (gps_trail_length < GPS_TRAIL_LENGTH)
-			gps_trail_length++;
-		gps_trail[gps_trail_next++] = gpsFleeting.point;
-		if (gps_trail_next == GPS_TRAIL_LENGTH)
-			gps_trail_next = 0;
-	}
-}
-static GPSPoint_t * backtrack_gps_trail(int backward_time)
-{
-	int back_index, index;
-
-	if (!gps_trail_valid)
-		return (&gpsFresh.point);
-	back_index = backward_time / QDAC_MAIN_PERIOD;
-	if (back_index <= 0)
-		return (&gpsFresh.point);
-	if (back_index > gps_trail_length) {
-		if (gps_trail_length < GPS_TRAIL_LENGTH)
-			return (&gps_trail[0]);
-		else
-			return (&gps_trail[gps_trail_next]);
-	}
-	else { 
-		if (gps_trail_next >= back_index)
-			index = gps_trail_next - back_index;
-		else
-			index = gps_trail_next + GPS_TRAIL_LENGTH - back_index;
-		return &gps_trail[index];
-	}
-}
-
 /*
-bool am_i_moving(uint32_t speed)
-{
-	return (gps_trail_valid && (gpsFleeting.speedKPH > speed));
-}
 static uint32_t rssi_sort[NUM_RSSI];
 uint32_t find_median_rssi(struct freezer_control *freezer)
 {
@@ -1823,10 +1751,8 @@ void qdac_port_close(void)
 	close(QDACCom.read_fd);
 }
 
-static int qdac_init_tag_queue(struct qdac_tag_control *tag_c, struct QDAC_Tag *tag_pool1, struct QDAC_Tag *tag_pool2)
+static int qdac_init_tag_queue(struct qdac_tag_control *tag_c)
 {
-	int i;
-
 	TAILQ_INIT(&tag_c->qdac_lowtemp_queue);
 	TAILQ_INIT(&tag_c->qdac_hightemp_queue);
 	TAILQ_INIT(&tag_c->qdac_unknown_queue);
@@ -1835,16 +1761,26 @@ static int qdac_init_tag_queue(struct qdac_tag_control *tag_c, struct QDAC_Tag *
 	TAILQ_INIT(&tag_c->qdac_switchsensor_queue);
 	TAILQ_INIT(&tag_c->qdac_pressuresensor_queue);
 	TAILQ_INIT(&tag_c->qdac_tmp_queue);
+	memset(&tag_c->lowtemp_index, 0, sizeof(struct tag_index));
+	memset(&tag_c->hightemp_index, 0, sizeof(struct tag_index));
+	memset(&tag_c->unknown_index, 0, sizeof(struct tag_index));
+	memset(&tag_c->gforcesensor_index, 0, sizeof(struct tag_index));
+	memset(&tag_c->currentsensor_index, 0, sizeof(struct tag_index));
+	memset(&tag_c->switchsensor_index, 0, sizeof(struct tag_index));
+	memset(&tag_c->pressuresensor_index, 0, sizeof(struct tag_index));
+	memset(&tag_c->tmp_index, 0, sizeof(struct tag_index));
+	memset(&tag_c->lowtemp_heap, 0, sizeof(struct tag_heap));
+	memset(&tag_c->hightemp_heap, 0, sizeof(struct tag_heap));
+	memset(&tag_c->unknown_heap, 0, sizeof(struct tag_heap));
+	memset(&tag_c->gforcesensor_heap, 0, sizeof(struct tag_heap));
+	memset(&tag_c->currentsensor_heap, 0, sizeof(struct tag_heap));
+	memset(&tag_c->switchsensor_heap, 0, sizeof(struct tag_heap));
+	memset(&tag_c->pressuresensor_heap, 0, sizeof(struct tag_heap));
+	memset(&tag_c->tmp_heap, 0, sizeof(struct tag_heap));
 	
-	for (i = 0; i < NUM_TAGS_PER_POOL; i++) {
-		tag_pool1[i].qdac_tag_serial = i;
-		TAILQ_INSERT_HEAD(&tag_c->recycle_queue, &tag_pool1[i], link);
-	}
-	for (i = 0; i < NUM_TAGS_PER_POOL; i++) {
-		tag_pool2[i].qdac_tag_serial = i;
-		TAILQ_INSERT_HEAD(&tag_c->recycle_queue, &tag_pool2[i], link);
-	}
-	return 0;
+	/* one slab up front, the second one when the tags need it */
+	return tag_pool_init(&tag_c->pool, sizeof(struct QDAC_Tag), NUM_TAGS_PER_SLAB,
+		QDAC_MAX_TAGS, QDAC_ROLE_QUOTA, 1);
 }
 
 static void qdac_init_tag_parameter(struct qdac_tag_control *tag_c)
@@ -1853,6 +1789,7 @@ static void qdac_init_tag_parameter(struct qdac_tag_control *tag_c)
 	
 //	tag_c->qdac_reader_type = propGetUInt32AtIndex(PROP_RFID_READER_TYPE, 0, 0);
 	tag_c->primary_id = propGetUInt32(PROP_QDAC_PRIMARY_ID, 0);
+	reset_temp_specs();
 	/* init all the tag type for the future usage */
 /***********************************************************/
 	if(tag_c->primary_id)
@@ -1962,7 +1899,6 @@ void init_qdac_lowtemp_parameter(struct qdac_lowtemp_tag *low_tag)
 		low_tag->report_cycle = t1;
 	else
 		low_tag->report_cycle = LONG_MAX;
-	low_tag->qdac_lowtemp_tag_spec = NULL;
 //	low_tag->min_rssi = propGetUInt32(PROP_RFID_CARGO_MIN_RSSI, 0);
 }
 
@@ -1988,7 +1924,6 @@ static void init_qdac_hightemp_parameter(struct qdac_hightemp_tag *high_temp)
 //		high_temp->report_cycle = (t1 + QDAC_MAIN_PERIOD - 1) / QDAC_MAIN_PERIOD;
 	else
 		high_temp->report_cycle = LONG_MAX;
-	high_temp->qdac_hightemp_tag_spec = NULL;
 }
 
 
@@ -2123,60 +2058,9 @@ static void init_qdac_pressuresensor_parameter(struct qdac_pressure_tag *pressur
 	else
 		pressure_tag->report_cycle = LONG_MAX;
 }
-/*
-int quickpartition(uint32_t *A, int b, int e)
-{
-	uint32_t X;
-	int i, j, m;
-	if (b >= e)
-		return b;
-	m = A[e];
-	i = b;
-	for (j = b; j < e; j++) {
-		if (A[j] <= m) {
-			if (j > i) {
-				X = A[i];
-				A[i] = A[j];
-				A[j] = X;
-			}
-			++i;
-		}
-	}
-	if (i < e) {
-		X = A[e];
-		A[e] = A[i];
-		A[i] = X;
-	}
-	return i;
-}
-void quicksort(uint32_t *A, int b, int e)
-{
-	int pivot;
-	if (b < e) {
-		pivot = quickpartition(A, b, e);
-		if (pivot > b)
-			quicksort(A, b,  (pivot - 1));
-		if (pivot < e)
-			quicksort(A, (pivot + 1), e);
-	}
-}
-int quick_select(uint32_t *A, int b, int e, int rank)
-{
-	int pivot;
-	if (b == e)
-		return b; 
-	pivot = quickpartition(A, b, e);
-	if (pivot == rank)
-		return pivot;
-	else if (pivot > rank)
-		return quick_select(A, b, (pivot - 1), rank);
-	else
-		return quick_select(A, (pivot + 1), e, rank);
-}
-*/
 static int power_off_qdac(void) {
 	if(qdac_power == POWER_ON) {
-		if(system("echo high > /sys/aatsi_devs_ctrl/qdac") < 0) {
+		if (gpio_out_set_wait(GPIO_OUT_QDAC_POWER, false) < 0) {
 			printf("Power off QDAC hub failed\n");
 			return -1;
 		} else
@@ -2187,7 +2071,7 @@ static int power_off_qdac(void) {
 }
 static int power_on_qdac(void) {	
 	if(qdac_power == POWER_OFF) {
-		if(system("echo low > /sys/aatsi_devs_ctrl/qdac") < 0) {
+		if (gpio_out_set_wait(GPIO_OUT_QDAC_POWER, true) < 0) {
 			printf("Power up QDAC hub failed\n");
 			return -1;
 		} else
@@ -2222,19 +2106,6 @@ static void print_command(unsigned char *cmd, int cmd_length) {
 		printf("%02x ", cmd[i++]);
 	printf("\n");
 }
-static unsigned short qdac_crc16 (unsigned char *data, unsigned int n)
-{
-	unsigned char hi = 0xFF; /* High byte of CRC */
-	unsigned char lo = 0xFF; /* Low byte of CRC */
-	unsigned int idx; /* Index into CRC table */
-	unsigned int i; /* Index into data */
-	for (i = 0; i < n; ++i) {
-		idx = lo ^ data[i];
-		lo = hi ^ CRC_hi[idx];
-		hi = CRC_low[idx];	
-	}
-	return (hi << 8 | lo);
-}
 
 static void qdac_littleE_encode2Bytes(unsigned char *pdest, unsigned short val) {
 		*pdest = val;			/* encode low 8 bits */
@@ -2279,7 +2150,7 @@ static int tx_cmd_to_hub(unsigned char *cmd) {
 	
 	crc_length = cmd[2] + 2;
 	index = crc_length + 1;
-	crc_val = qdac_crc16(&(cmd[1]), crc_length);
+	crc_val = cksumCalcCRC16(&(cmd[1]), crc_length);
 	command_length = crc_length + 3;
 	qdac_littleE_encode2Bytes(&(cmd[index]), crc_val);
 
@@ -2304,11 +2175,13 @@ static int tx_cmd_to_hub(unsigned char *cmd) {
 	}
 }
 
-static unsigned char *read_hub_buff(int *actur_rd_len, unsigned int expect_rd_length) {
+// read_hub_buff waits up to 10 secs for the hub, and reads at most 'size' bytes
+// into 'buf'. Returns the bytes read, 0 if nothing was read.
+static int read_hub_buff(unsigned char *buf, int size) {
 	fd_set qdac_read_fd_set;
 	struct timeval timeout;  /* Timeout for select */
 	int read_fd;
-	unsigned char *response = NULL; 
+	int read_length = 0;
 
 	/* FD_ZERO() clears out the fd_set called "qdac_read_fd_set", so that
 	it doesn't contain any file descriptors. */
@@ -2338,49 +2211,25 @@ static unsigned char *read_hub_buff(int *actur_rd_len, unsigned int expect_rd_le
 		exit(EXIT_FAILURE);
 	} else if (read_fd > 0) {
 		if(FD_ISSET(QDACCom.read_fd, &qdac_read_fd_set)) {
-			response = (unsigned char *)malloc(expect_rd_length*sizeof(unsigned char));
-			if (response == NULL) {
-				perror("rx_resp_from_hub() malloc");
-				exit(-1);
-			}
-			else {
-				memset(response, 0, expect_rd_length*sizeof(unsigned char));
-				if((*actur_rd_len = read(QDACCom.read_fd, response, expect_rd_length))< 0) {
-					free(response);
-					response = NULL;
-					*actur_rd_len = 0;
-				}
+			if((read_length = read(QDACCom.read_fd, buf, size)) < 0)
+				read_length = 0;
 /* for test: inputting qdac packet from the debug port */ 
-				if(qdac_test == DEBUG_PORT) {
-					unsigned char *resp = NULL;
-					if (*(response+*actur_rd_len) == 13)
-						*(response+*actur_rd_len)  = 0;
-					resp = char_to_hex(response, actur_rd_len);
-					free(response);
-					response = NULL;
-					return resp;
-				}	
+			if(qdac_test == DEBUG_PORT)
+				read_length = char_to_hex(buf, read_length);
 /*------*/				
-			}
 		}
 	} 
-	else {
-		*actur_rd_len = 0;
+//	else
 //		printf("Nothing Read From QDAC Port\n");
-	}
-	return response;
+	return read_length;
 }
 
-static unsigned char *rx_resp_from_hub(int *read_length, int expect_rd_length,  int fun_code) {
-	unsigned char *response = NULL;
-
-	response = read_hub_buff(read_length, RESPONSE_MAX_SIZE);
-
-	return response;
+static int rx_resp_from_hub(unsigned char *resp, int expect_rd_length,  int fun_code) {
+	return read_hub_buff(resp, RESPONSE_MAX_SIZE);
 }
 
 static int set_hub_mode(int mode) {
-	unsigned char *response = NULL;
+	unsigned char *response = hub_response;
 	int read_length = 0;
 	int res = -1;
 	memset(command, 0, sizeof(command));	
@@ -2402,8 +2251,8 @@ static int set_hub_mode(int mode) {
 
 	if(tx_cmd_to_hub(command) < 0)
 		return -1;
-	response = rx_resp_from_hub(&read_length, HUB_MODE_SET_RESP_LENGTH*sizeof(unsigned char), WRITE_HUB_CONFIGUATION);
-	if (response == NULL) {
+	read_length = rx_resp_from_hub(response, HUB_MODE_SET_RESP_LENGTH*sizeof(unsigned char), WRITE_HUB_CONFIGUATION);
+	if (read_length == 0) {
 		return -1;
 	}
 //	print_response(response, read_length);
@@ -2416,12 +2265,11 @@ static int set_hub_mode(int mode) {
 		} 
 	}
 	
-	free(response);
 	return res;
 }
 
 static int read_hub_version(void) {
-	unsigned char *rsp = NULL;
+	unsigned char *rsp = hub_response;
 	int read_length;
 	int qdac_version = 0;
 	memset(command, 0, sizeof(command));
@@ -2430,21 +2278,20 @@ static int read_hub_version(void) {
 	command[2] = 0;
 
 	tx_cmd_to_hub(command);
-	rsp = rx_resp_from_hub(&read_length, READ_HUB_VERSION_RESP_LENGTH*sizeof(unsigned char),GET_HUB_VERSION);
-	if (rsp == NULL) {
+	read_length = rx_resp_from_hub(rsp, READ_HUB_VERSION_RESP_LENGTH*sizeof(unsigned char),GET_HUB_VERSION);
+	if (read_length == 0) {
 		return -1;
 	}
 //	print_response(rsp, read_length);
 	if(qdac_verify_tag_packet(&rsp, read_length, GET_HUB_VERSION) == 0)  {	
 		qdac_version = rsp[11] << 8 | rsp[10];
-		free(rsp);
 	}
 		
 	return qdac_version;
 }
 
 static int stream_mode(unsigned int mode_switch) {
-	unsigned char *response = NULL;
+	unsigned char *response = hub_response;
 	int read_length;
 	int res;
 	memset(command, 0, sizeof(command));
@@ -2455,8 +2302,8 @@ static int stream_mode(unsigned int mode_switch) {
 
 	if(tx_cmd_to_hub(command) < 0)
 		return -1;
-	response = rx_resp_from_hub(&read_length, STREAM_MODE_RESP_LENGTH*sizeof(unsigned char), ENABLE_HUB_STREAM);
-	if (response == NULL)
+	read_length = rx_resp_from_hub(response, STREAM_MODE_RESP_LENGTH*sizeof(unsigned char), ENABLE_HUB_STREAM);
+	if (read_length == 0)
 		return -1;
 //	print_response(response, read_length);
 	if(qdac_verify_tag_packet(&response, read_length, ENABLE_HUB_STREAM) == 0) {	
@@ -2467,7 +2314,6 @@ static int stream_mode(unsigned int mode_switch) {
 	} else 
 		res = -1;
 	
-	free(response);
 	return res;
 }
 
@@ -2536,22 +2382,38 @@ init_fail:
 		qdac_reader_running = 1;
 }
 
-static void qdac_init_gps(void) {
-	int n;
-	
-	gpsClear(&gpsFresh);
-	gpsClear(&gpsFleeting);
-	for (n = 0; n < GPS_TRAIL_LENGTH; n++)
-		gpsPointClear(&gps_trail[n]);
-}
+/* take a disarmed tag off its queue and index, keeping its raw data buffer */
+static void clear_tag(struct tq_head *tqueue, struct QDAC_Tag *tag) {
+	unsigned char *raw_data = tag->raw_data;
+	int raw_data_size = tag->raw_data_size;
 
-static void remove_tag(struct qdac_tag_control *tag_c, struct tq_head *tqueue, struct QDAC_Tag *tag) {
+	if (tag->tindex != NULL)
+		tag_index_remove(tag->tindex, tag->qdac_tag_serial, tag);
 	TAILQ_REMOVE(tqueue, tag, link);
 	memset(tag, 0, sizeof(*tag));
-	pthread_mutex_lock(&tag_c->mutex_recycle);
-	TAILQ_INSERT_TAIL(&tag_c->recycle_queue, tag, link);
-	pthread_mutex_unlock(&tag_c->mutex_recycle);
-}		
+	tag->raw_data = raw_data;
+	tag->raw_data_size = raw_data_size;
+}
+
+/* a tag gone out, onto the 'spent' list for tag_pool_release() */
+static void remove_tag(struct tq_head *tqueue, struct QDAC_Tag *tag, void **spent) {
+	clear_tag(tqueue, tag);
+	tag_pool_spend(spent, tag);
+}
+
+static bool tag_unadmitted(void *tag) {
+	return !(((struct QDAC_Tag *)tag)->status & (TAG_FRESH | TAG_SENIOR));
+}
+
+/* Reuse the least recently heard tag of a queue that was never admitted, so
+ * no OUT event is owed for it.  Caller holds the queue mutex. */
+static struct QDAC_Tag *evict_tag(struct tq_head *tqueue, struct tag_heap *theap) {
+	struct QDAC_Tag *lru = (struct QDAC_Tag *)tag_heap_evict(theap, tag_unadmitted);
+
+	if (lru != NULL)
+		clear_tag(tqueue, lru);
+	return lru;
+}
 
 static void print_time(char *des, int serial) {
 	time_t now;
@@ -2567,100 +2429,90 @@ static void print_time(char *des, int serial) {
 
 static void qdac_sample_temperature(struct qdac_temp_spec *temp_spec, struct QDAC_Tag *tag)
 {
-	int index;
-
 	if (tag->qdac_tag_type != HIGH_TEMP_TAG && tag->qdac_tag_type != LOW_TEMP_TAG)
 		return;
-	index = temp_spec->temp_index;
+	sample_window_add(&temp_spec->temps, tag->cur_temp);
+}
 
-	*(temp_spec->qdac_temp+index) = tag->cur_temp;
-	if (index == QDAC_NUM_TEMPERATURES - 1)
-		temp_spec->temp_index = 0; 
-	else
-		temp_spec->temp_index += 1;
-	if(temp_spec->temp_count < QDAC_NUM_TEMPERATURES)
-		temp_spec->temp_count += 1;
+static inline uint32_t spec_hash(uint32_t tag_serial, uint16_t tag_type)
+{
+	return ((tag_serial ^ ((uint32_t)tag_type << 16)) * 2654435761U) >> (32 - QDAC_INDEX_BITS);
 }
+/* the spec of a (serial, type), created on the first lookup */
+static struct qdac_temp_spec *search_temp_spec(uint32_t tag_serial, uint16_t tag_type) {
+	uint32_t i;
+	struct qdac_temp_spec *tmp;
 
-static struct qdac_temp_spec *search_temp_spec(struct qdac_temp_spec **temp_spec, int tag_serial, int tag_type) {
-	struct qdac_temp_spec *tmp = *temp_spec; 
-	struct qdac_temp_spec *last = NULL;
+	for (i = spec_hash(tag_serial, tag_type); (tmp = qdac_specs.slot[i]) != NULL; i = (i + 1) & QDAC_INDEX_MASK) {
+		if (tmp->qdac_tag_serial == tag_serial && tmp->qdac_tag_type == tag_type)
+			break;
+	}
+	if (tmp == NULL)
+		tmp = create_temp_spec(tag_serial, tag_type);
+	tmp->used = ++spec_clock;
+	return tmp;
+}
 
-	if(tmp == NULL) {
-		tmp = create_temp_spec();
-		tmp->qdac_tag_serial = tag_serial;
-		tmp->qdac_tag_type = tag_type;
-		*temp_spec = tmp;
-	} 
+/* Takes a spec from the pool, or once the pool is used up, reuses the spec
+ * looked up the longest time ago.  Specs owned by a zone are kept: there are
+ * far fewer zones than specs. */
+static struct qdac_temp_spec *create_temp_spec(uint32_t tag_serial, uint16_t tag_type) {
+	struct qdac_temp_spec *tmp = NULL;
+	uint32_t i;
+
+	if (qdac_specs.count < QDAC_NUM_SPECS)
+		tmp = &qdac_specs.spec[qdac_specs.count++];
 	else {
-		for(;tmp->qdac_temp_spec_next != NULL; tmp=tmp->qdac_temp_spec_next) {
-			if(tmp->qdac_tag_serial == tag_serial && tmp->qdac_tag_type == tag_type)  
-				return tmp;
+		for (i = 0; i < QDAC_NUM_SPECS; i++) {
+			if (qdac_specs.spec[i].zone_id != 0xFF)
+				continue;
+			if (tmp == NULL || spec_clock - qdac_specs.spec[i].used > spec_clock - tmp->used)
+				tmp = &qdac_specs.spec[i];
 		}
-		last = tmp;
-		tmp = create_temp_spec();
-		tmp->qdac_tag_serial = tag_serial;
-		tmp->qdac_tag_type = tag_type;
-		last->qdac_temp_spec_next = tmp;
-		tmp = last;
+		unindex_temp_spec(tmp);
 	}
-	
+	memset(tmp, 0, sizeof(struct qdac_temp_spec));
+	tmp->qdac_tag_serial = tag_serial;
+	tmp->qdac_tag_type = tag_type;
+	tmp->zone_id = 0xFF;
+	tmp->alarm_type = QDAC_ALARM_NORM;
+	sample_window_init(&tmp->temps, QDAC_NUM_TEMPERATURES);
+
+	for (i = spec_hash(tag_serial, tag_type); qdac_specs.slot[i] != NULL; i = (i + 1) & QDAC_INDEX_MASK)
+		;
+	qdac_specs.slot[i] = tmp;
 	return tmp;
 }
 
-static struct qdac_temp_spec *create_temp_spec(void) {
-	struct qdac_temp_spec *tmp = (struct qdac_temp_spec *)malloc(sizeof(struct qdac_temp_spec));
-	tmp->qdac_tag_serial = 0;
-	tmp->qdac_tag_model = 0;
-	tmp->qdac_tag_type = 0;
-	tmp->temp_index = 0;
-	tmp->temp_count = 0;
-	tmp->zone_id = 0xFF;
-	tmp->cur_avg = 0;
-	tmp->cur_high = 0;
-	tmp->cur_low = 0;
-	tmp->set_high = 0;
-	tmp->set_low = 0;
-	tmp->alarm_type = QDAC_ALARM_NORM;
-	tmp->qdac_temp = (short *)malloc(QDAC_NUM_TEMPERATURES*sizeof(short));
-	tmp->qdac_temp_spec_next = NULL;
-//	tmp->qdac_zone_general = NULL;
-	if (tmp == NULL) {
-		perror("malloc tmp");
-		exit(-1);
+/* Backward-shift deletion, as in tag_index_remove() */
+static void unindex_temp_spec(struct qdac_temp_spec *temp_spec) {
+	uint32_t i, j, k;
+	struct qdac_temp_spec *tmp;
+
+	for (i = spec_hash(temp_spec->qdac_tag_serial, temp_spec->qdac_tag_type); qdac_specs.slot[i] != temp_spec; i = (i + 1) & QDAC_INDEX_MASK) {
+		if (qdac_specs.slot[i] == NULL)
+			return;
 	}
-	if (tmp->qdac_temp == NULL) {
-		perror("malloc tmp->qdac_temp");
-		exit(-1);
+	for (j = (i + 1) & QDAC_INDEX_MASK; (tmp = qdac_specs.slot[j]) != NULL; j = (j + 1) & QDAC_INDEX_MASK) {
+		k = spec_hash(tmp->qdac_tag_serial, tmp->qdac_tag_type);
+		if ((i <= j)? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+		qdac_specs.slot[i] = tmp;
+		i = j;
 	}
-	
-	return tmp;
+	qdac_specs.slot[i] = NULL;
+}
+
+static void reset_temp_specs(void) {
+	memset(&qdac_specs, 0, sizeof(qdac_specs));
+	spec_clock = 0;
 }
 
 static void qdac_temp_cal(struct qdac_temp_spec *temp_spec)
 {
-	int i;
-	
-	temp_spec->cur_high = *(temp_spec->qdac_temp);
-	temp_spec->cur_low = *(temp_spec->qdac_temp);
-	temp_spec->cur_avg = *(temp_spec->qdac_temp);
-
-	if (temp_spec->temp_count <= 1)
-		return;
-	else {
-//	printf("Tag %d Stored: ", temp_spec->qdac_serial);
-//	for (i=0; i<temp_spec->temp_count; i++) 
-//		printf("%d ", *(temp_spec->qdac_temp+i));
-//	printf("\n");
-		for (i=1; i<temp_spec->temp_count; i++) {
-			if(*(temp_spec->qdac_temp+i) > temp_spec->cur_high) 
-				temp_spec->cur_high= *(temp_spec->qdac_temp+i);
-			else if(*(temp_spec->qdac_temp+i) < temp_spec->cur_low) 
-				temp_spec->cur_low = *(temp_spec->qdac_temp+i);
-			temp_spec->cur_avg += *(temp_spec->qdac_temp+i);
-		}	
-		temp_spec->cur_avg /= temp_spec->temp_count;
-	}	
+	temp_spec->cur_high = sample_window_max(&temp_spec->temps);
+	temp_spec->cur_low = sample_window_min(&temp_spec->temps);
+	temp_spec->cur_avg = sample_window_mean(&temp_spec->temps);
 //printf("!!Serial %d: high: %d; low: %d; avg: %d\n", temp_spec->qdac_tag_serial, temp_spec->cur_high,
 //		temp_spec->cur_avg, temp_spec->cur_low);
 }
@@ -2676,37 +2528,38 @@ static int qdac_cmp_temp(struct qdac_temp_spec *temp_spec) {
 		return QDAC_ALARM_NORM;
 }
 
-static unsigned char *char_to_hex(unsigned char *response, int *actur_rd_len) {
+// char_to_hex converts the hex digits typed on the debug port to binary in
+// place, and returns the binary length.
+static int char_to_hex(unsigned char *buf, int length) {
 	int i = 0;
-	unsigned char *resp = (unsigned char *)malloc(*actur_rd_len*sizeof(unsigned char));
 	
-	while(i < *actur_rd_len) {
-		if (*(response+i) >= '0' && *(response+i) <= '9' )
-			*(response+i) -= '0';
-		if (*(response+i) >= 'a' && *(response+i) <= 'f' )
-			*(response+i) -= 87;
-		if (*(response+i) >= 'A' && *(response+i) <= 'F' )
-			*(response+i) -= 55;
-//			printf("%x ", *(response+i));
+	while (length > 0 && (buf[length-1] == '\r' || buf[length-1] == '\n'))
+		length--;
+	while(i < length) {
+		if (*(buf+i) >= '0' && *(buf+i) <= '9' )
+			*(buf+i) -= '0';
+		if (*(buf+i) >= 'a' && *(buf+i) <= 'f' )
+			*(buf+i) -= 87;
+		if (*(buf+i) >= 'A' && *(buf+i) <= 'F' )
+			*(buf+i) -= 55;
 		i++;
 	}
-//	printf("\n");
-	*actur_rd_len /= 2;
-	for(i=0; i < *actur_rd_len; i++) {
-		*(response+i*2) <<= 4;		
-		*(resp+i) = (*(response+i*2) | *(response+i*2+1));
-//		printf("%x ", *(resp+i));	
-	}
-//	printf("\n");
+	length /= 2;
+	for(i=0; i < length; i++)
+		*(buf+i) = (*(buf+i*2) << 4) | *(buf+i*2+1);
 	
-	return resp;
+	return length;
 }
 
 // returns NULL: 	if error, verify_status < 0;
-//				if need more data, verify_status > 0; 
-// returns the pointer if verify a full pkt success, and verify_status = 0
-
-static unsigned char *verify_recv_queue(struct qdac_recv_pkts *pkts_queue, int *verify_status)
+//				if need more data, verify_status > 0, and seen is set to the
+//				unparsed bytes it looked at; 
+// returns the pointer if verify a full pkt success, and verify_status = 0:
+// the pkt is left in the queue until move_parse_index() passes its
+// frame_length bytes. A pkt wrapping around the end of the queue is continued
+// past the end, so the pointer always covers the whole pkt.
+
+static unsigned char *verify_recv_queue(struct qdac_recv_pkts *pkts_queue, int *verify_status, int *frame_length, uint32_t *seen)
 {
 	int error = 0;
 	int payload_length=0,	 pkt_length=0;
@@ -2715,7 +2568,7 @@ static unsigned char *verify_recv_queue(struct qdac_recv_pkts *pkts_queue, int *
 	unsigned char *pkt_cur = NULL; 
 	unsigned char *tag_data = NULL;
 	int parse_index = pkts_queue->parse_index;
-	int unparse_length =pkts_queue->queue_unparse_length;
+	int unparse_length = recv_unparsed(pkts_queue);
 	int pos_dif = 0;
 	int pkts_que_rest = 0;
 	int pkt_exced = 0;
@@ -2734,7 +2587,7 @@ static unsigned char *verify_recv_queue(struct qdac_recv_pkts *pkts_queue, int *
 			parse_index = pkts_queue->parse_index;
 //			printf("parse_index: %d\n", parse_index);
 			pkt_cur = pkts_queue->qdac_pkts_queue+parse_index;
-			unparse_length =pkts_queue->queue_unparse_length;
+			unparse_length -= pkts_que_rest;
 			pkt_start = find_out_start_byte (pkt_cur, &error, unparse_length);
 		}
 	}	
@@ -2752,24 +2605,20 @@ static unsigned char *verify_recv_queue(struct qdac_recv_pkts *pkts_queue, int *
 		return NULL;
 	}
 	
-	payload_length = *(pkt_start+2); 							// found out a expected complete pkt length
+	if (unparse_length < 3) {						// the length byte is not read yet
+		*verify_status = 3 - unparse_length;
+		*seen = unparse_length;
+		return NULL;
+	}
+	parse_index = pkts_queue->parse_index;
+	payload_length = pkts_queue->qdac_pkts_queue[(parse_index + 2) % PKTS_QUEUE_LENGTH]; 	// found out a expected complete pkt length
 	pkt_length = payload_length + 5;
 
 	if (unparse_length >= pkt_length) {
-		tag_data = (unsigned char *)malloc(sizeof(unsigned char)*pkt_length);
-		if(tag_data == NULL)
-			perror("malloc tag_data");
-		memset(tag_data, 0, pkt_length);
-// cpy the expected complete pkt to be ready to handle it		
-		parse_index = pkts_queue->parse_index;
 		pkt_exced = parse_index + pkt_length - PKTS_QUEUE_LENGTH;
-		if(pkt_exced <= 0)
-			memcpy(tag_data, pkt_start, pkt_length);
-		else {
-			memcpy(tag_data, pkt_start, pkt_length - pkt_exced);
-			memcpy(tag_data+pkt_length-pkt_exced, pkts_queue->qdac_pkts_queue, pkt_exced);	
-		}
-		
+		if(pkt_exced > 0)						// continue the pkt past the end of the queue
+			memcpy(pkts_queue->qdac_pkts_queue+PKTS_QUEUE_LENGTH, pkts_queue->qdac_pkts_queue, pkt_exced);	
+		tag_data = pkt_start;
 		verify_res = qdac_verify_tag_packet(&tag_data, pkt_length, READ_TAG_DATA); 
 	} else 
 		verify_res = pkt_length - unparse_length;
@@ -2778,18 +2627,17 @@ static unsigned char *verify_recv_queue(struct qdac_recv_pkts *pkts_queue, int *
 
 	if (verify_res == VERIFY_SUCCESS)  {
 		error = 0;	
-		move_parse_index(pkts_queue, pkt_length);
+		*frame_length = pkt_length;
 		*verify_status = verify_res;
 	} else if (verify_res < 0){					// cause verify_res is a minus value, so to count the errors, we have to minus it.
 		error += verify_res;		 
-		if(tag_data != NULL) free(tag_data);
 		move_parse_index(pkts_queue, 1);
 		*verify_status = error;
 		tag_data = NULL;
 	} else if (verify_res > 0) {					// if returns >0, it means more bytes need to be read to assemble as a full pkt.
 //		printf("waiting for more data\n");
 		*verify_status = verify_res;
-		if(tag_data != NULL) free(tag_data);
+		*seen = unparse_length;					// wait for more than this
 		tag_data = NULL;
 	}
 
@@ -2816,22 +2664,15 @@ static unsigned char *find_out_start_byte(unsigned char *pkt, int *parse_error,
 }
 
 static void move_parse_index(struct qdac_recv_pkts *pkts_queue, int pkt_length) {
-	int parse_index = pkts_queue->parse_index;
-	int pkt_rest;
-	unsigned char *queue = pkts_queue->qdac_pkts_queue;
-
-//	pkt_rest = PKTS_QUEUE_LENGTH - pkt_length;
-	pkt_rest = PKTS_QUEUE_LENGTH - parse_index;
-	if (pkt_rest < pkt_length) {
-		memset(queue+parse_index, 0, pkt_rest*sizeof(unsigned char));
-		memset(queue, 0, (pkt_length-pkt_rest)*sizeof(unsigned char));
+	int pkt_rest = PKTS_QUEUE_LENGTH - pkts_queue->parse_index;
+
+	if (pkt_rest <= pkt_length)
 		pkts_queue->parse_index = pkt_length-pkt_rest;
-	} else {
-		memset(queue+parse_index, 0, pkt_length*sizeof(unsigned char));
+	else
 		pkts_queue->parse_index += pkt_length;
-		if (pkts_queue->parse_index == PKTS_QUEUE_LENGTH)
-		pkts_queue->parse_index = 0;
-	}
+	pthread_mutex_lock(&pkts_queue->mutex);
 	pkts_queue->queue_unparse_length -= pkt_length;
+	pthread_cond_signal(&pkts_queue->more_space);
+	pthread_mutex_unlock(&pkts_queue->mutex);
 }
 
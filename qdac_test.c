@@ -16,12 +16,15 @@
 #include <limits.h>
 #include "stdtypes.h"
 #include "log.h"
+#include "checksum.h"
 #include "comport.h"
 #include "propman.h"
 #include "gpstools.h"
 #include "gps.h"
 #include "packet.h"
 #include "protocol.h"
+#include "gpio_out.h"
+#include "sample_window.h"
 #include "qdac.h"
 #include "reader_type.h"
 #define QDAC_MAIN_PERIOD 10 
@@ -109,7 +112,6 @@
 #define TMP_TAG_NUMBER 2
 
 #define MINUTES 60
-#define	GPS_TRAIL_LENGTH 32 
 #define	RSSI_BITS 5 
 #define	RSSI_TOTAL (1 << RSSI_BITS)
 #define	RSSI_INDEX_M (RSSI_TOTAL - 1)
@@ -202,15 +204,13 @@ struct qdac_temp_spec {
 	uint16_t zone_id;
 	uint16_t qdac_tag_model;
 	uint16_t qdac_tag_type;
-	uint16_t temp_index;
-	uint16_t temp_count;
 	uint16_t alarm_type;
 	short set_high;
 	short set_low;
 	short cur_high;
 	short cur_low;
 	short cur_avg;
-	short *qdac_temp;
+	struct sample_window temps;
 //	struct qdac_temp_zone *qdac_zone_general;
 	struct qdac_temp_spec *qdac_temp_spec_next;
 };
@@ -311,7 +311,6 @@ short protocol = PROTRAC_PROTOCOL;
 /* qdac GPS variable */
 static GPS_t gpsFresh;
 static GPS_t gpsFleeting;
-static GPSPoint_t gps_trail[GPS_TRAIL_LENGTH];
 
 static Packet_t qdac_event_packet;
 //static unsigned char qdac_raw_buf[RAW_READ_SIZE * 2];
@@ -325,15 +324,14 @@ static int qdac_verify_tag_packet(unsigned char **pkt, int length, int fun_code)
 static void qdac_parse_tag(struct qdac_tag_control *tag_c, unsigned char *pkt);
 static bool qdac_admit_tag(struct QDAC_Tag *tag, time_t now, int period);
 //static bool tag_not_bursting(struct Tag *tag, struct timespec ts1);
-static unsigned short qdac_crc16(unsigned char *data, unsigned int n);
 //static int init_tag_queue(struct tag_control *tag_c, struct Tag *tag_pool1, struct Tag *tag_pool2);
 //static void cargo_queue_processing(struct tag_control *tag_c, struct cargo_control *truck);
 //static void hightemp_queue_processing(struct tag_control *tag_c, struct high_temp_control *high_temp);
 //static void battery_time_checking(struct tag_control *tag_c);
 static struct QDAC_Tag *qdac_search_tag(struct tq_head *tqueue, uint32_t serial);
 static int filter_missing_tag( unsigned char *pkt);
-static void update_gps_trail(void);
-static GPSPoint_t * backtrack_gps_trail(int backward_time);
+static void update_gps_fresh(void);
+static GPSPoint_t * gps_point_at(time_t when);
 //static bool am_i_moving(uint32_t speed);
 //static void sample_rssi(struct freezer_control *freezer, uint32_t rssi);
 //static uint32_t find_median_rssi(struct freezer_control *freezer);
@@ -362,8 +360,6 @@ static void make_qdac_temperature_event(struct qdac_tag_control *tag_c, GPSPoint
 static void make_qdac_status_event(int status, int firm_ver);
 static struct qdac_temp_spec *search_temp_spec(struct qdac_temp_spec **temp_spec, int tag_serial, int tag_type);
 static struct qdac_temp_spec *create_temp_spec(void);
-//static void quicksort(uint32_t *A, int b, int e);
-//static int quick_select(uint32_t *A, int b, int e, int rank);
 static int power_on_qdac(void);
 static int power_off_qdac(void);
 static int set_hub_mode(int mode);
@@ -388,75 +384,6 @@ static void qdac_sample_temperature(struct qdac_temp_spec *temp_spec, struct QDA
 static void qdac_encode_temperature(short high, short low, short avg, unsigned char *temp);
 static void qdac_temp_cal(struct qdac_temp_spec *temp_spec);
 static int qdac_cmp_temp(struct qdac_temp_spec *temp_spec);
-/* CRC calculation looking up table */
-unsigned char CRC_hi[] = {
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40
-};
-unsigned char CRC_low[] = {
-0x00, 0xC0, 0xC1, 0x01, 0xC3, 0x03, 0x02, 0xC2,
-0xC6, 0x06, 0x07, 0xC7, 0x05, 0xC5, 0xC4, 0x04,
-0xCC, 0x0C, 0x0D, 0xCD, 0x0F, 0xCF, 0xCE, 0x0E,
-0x0A, 0xCA, 0xCB, 0x0B, 0xC9, 0x09, 0x08, 0xC8,
-0xD8, 0x18, 0x19, 0xD9, 0x1B, 0xDB, 0xDA, 0x1A,
-0x1E, 0xDE, 0xDF, 0x1F, 0xDD, 0x1D, 0x1C, 0xDC,
-0x14, 0xD4, 0xD5, 0x15, 0xD7, 0x17, 0x16, 0xD6,
-0xD2, 0x12, 0x13, 0xD3, 0x11, 0xD1, 0xD0, 0x10,
-0xF0, 0x30, 0x31, 0xF1, 0x33, 0xF3, 0xF2, 0x32,
-0x36, 0xF6, 0xF7, 0x37, 0xF5, 0x35, 0x34, 0xF4,
-0x3C, 0xFC, 0xFD, 0x3D, 0xFF, 0x3F, 0x3E, 0xFE,
-0xFA, 0x3A, 0x3B, 0xFB, 0x39, 0xF9, 0xF8, 0x38,
-0x28, 0xE8, 0xE9, 0x29, 0xEB, 0x2B, 0x2A, 0xEA,
-0xEE, 0x2E, 0x2F, 0xEF, 0x2D, 0xED, 0xEC, 0x2C,
-0xE4, 0x24, 0x25, 0xE5, 0x27, 0xE7, 0xE6, 0x26,
-0x22, 0xE2, 0xE3, 0x23, 0xE1, 0x21, 0x20, 0xE0,
-0xA0, 0x60, 0x61, 0xA1, 0x63, 0xA3, 0xA2, 0x62,
-0x66, 0xA6, 0xA7, 0x67, 0xA5, 0x65, 0x64, 0xA4,
-0x6C, 0xAC, 0xAD, 0x6D, 0xAF, 0x6F, 0x6E, 0xAE,
-0xAA, 0x6A, 0x6B, 0xAB, 0x69, 0xA9, 0xA8, 0x68,
-0x78, 0xB8, 0xB9, 0x79, 0xBB, 0x7B, 0x7A, 0xBA,
-0xBE, 0x7E, 0x7F, 0xBF, 0x7D, 0xBD, 0xBC, 0x7C,
-0xB4, 0x74, 0x75, 0xB5, 0x77, 0xB7, 0xB6, 0x76,
-0x72, 0xB2, 0xB3, 0x73, 0xB1, 0x71, 0x70, 0xB0,
-0x50, 0x90, 0x91, 0x51, 0x93, 0x53, 0x52, 0x92,
-0x96, 0x56, 0x57, 0x97, 0x55, 0x95, 0x94, 0x54,
-0x9C, 0x5C, 0x5D, 0x9D, 0x5F, 0x9F, 0x9E, 0x5E,
-0x5A, 0x9A, 0x9B, 0x5B, 0x99, 0x59, 0x58, 0x98,
-0x88, 0x48, 0x49, 0x89, 0x4B, 0x8B, 0x8A, 0x4A,
-0x4E, 0x8E, 0x8F, 0x4F, 0x8D, 0x4D, 0x4C, 0x8C,
-0x44, 0x84, 0x85, 0x45, 0x87, 0x47, 0x46, 0x86,
-0x82, 0x42, 0x43, 0x83, 0x41, 0x81, 0x80, 0x40
-};
 
 int qdac_initialize(void)
 {
@@ -497,7 +424,7 @@ void * qdac_thread_main(void *args)
 	qdac_init_gps();
 	
 	while (qdac_main_running != 0) { 
-		update_gps_trail();
+		update_gps_fresh();
 //		battery_time_checking(&tag_control_1);
 		n_alarms = 0;
 //printf("!!qdac_main_running %d\n", qdac_main_running);
@@ -676,7 +603,7 @@ static int qdac_verify_tag_packet(unsigned char **pkt, int read_length, int fun_
 				if ( payload_length+5 > read_length)	{	// packet is not a complete packet because (at the mid of a full packet), read the rest of it only.
 					return payload_length+5-read_length;
 				}
-				crc_cal= qdac_crc16(*pkt+1, 2+*(*pkt+2));
+				crc_cal= cksumCalcCRC16(*pkt+1, 2+*(*pkt+2));
 				crc_index = 3 + *(*pkt+2);
 				crc_recv = *(*pkt+crc_index+1) << 8 | *(*pkt+crc_index);
 				if (crc_cal != crc_recv) {                 // 3. crc error
@@ -1117,7 +1044,7 @@ static struct QDAC_Tag *qdac_temp_tag_event(struct qdac_tag_control *tag_c, stru
 
 	if (tag->recent < past) {
 		if (tag->status & TAG_SENIOR) {
-			make_qdac_event(tag, backtrack_gps_trail(now - tag->recent), STATUS_QDAC_PRIMARY_OUT, now);
+			make_qdac_event(tag, gps_point_at(tag->recent), STATUS_QDAC_PRIMARY_OUT, now);
 			print_time(tag_des, tag->qdac_tag_serial);
 			printf("Tag Out\n");
 		}
@@ -1176,7 +1103,7 @@ static void qdac_event_gen(struct qdac_tag_control *tag_c, struct tq_head *tqueu
 	
 		if (tag->recent < past) {
 			if (tag->status & TAG_SENIOR) {
-					make_qdac_event(tag, backtrack_gps_trail(now - tag->recent), STATUS_QDAC_TAG_OUT, now);	
+					make_qdac_event(tag, gps_point_at(tag->recent), STATUS_QDAC_TAG_OUT, now);	
 					print_time(temp_des, tag->qdac_tag_serial);
 					printf("Tag OUT \n");
 			}
@@ -1351,7 +1278,7 @@ static void make_qdac_temperature_event(struct qdac_tag_control *tag_c, GPSPoint
 		printf("Normal\n");
 		// toggle the pin 
 		if(trig_alarm_pin) {
-			system("/usr/local/bin/disalarm");
+			gpio_out_set(GPIO_OUT_ALARM, false);
 			trig_alarm_pin = false;
 		}
 	} else if (alarm_type == QDAC_ALARM_HIGH) {
@@ -1361,7 +1288,7 @@ static void make_qdac_temperature_event(struct qdac_tag_control *tag_c, GPSPoint
 		printf("High\n");
 		// toggle the pin 
 		if (!trig_alarm_pin) {
-			system("/usr/local/bin/trig_alarm");
+			gpio_out_set(GPIO_OUT_ALARM, true);
 			trig_alarm_pin = true;
 		}
 	} else if (alarm_type == QDAC_ALARM_LOW) {
@@ -1372,7 +1299,7 @@ static void make_qdac_temperature_event(struct qdac_tag_control *tag_c, GPSPoint
 		printf("Low\n");
 		// toggle the pin 
 		if (!trig_alarm_pin) {
-			system("/usr/local/bin/trig_alarm");
+			gpio_out_set(GPIO_OUT_ALARM, true);
 			trig_alarm_pin = true;
 		}
 	}
@@ -1442,57 +1369,26 @@ static int qdac_read_temperature_alarm(struct freezer_control *freezer, unsigned
 }
 */
 
-static int gps_trail_next = 0;
-static bool gps_trail_length = 0;
-static bool gps_trail_valid = false;
-static void update_gps_trail(void)
+static bool gps_fresh_valid = false;
+static GPSPoint_t gps_backtrack;
+static void update_gps_fresh(void)
 {
-	GPS_t * gps_latest;
-	gps_latest = gpsGetLastGPS(&gpsFleeting, USHRT_MAX);
-	if (gps_latest == (GPS_t *)0) {
-		if (gps_trail_valid) {
-			gps_trail_next = 0;
-			gps_trail_length = 0;
-			gps_trail_valid = false;
-		}
-	} else {
+	gps_fresh_valid = (gpsGetLastGPS(&gpsFleeting, USHRT_MAX) != (GPS_t *)0);
+	if (gps_fresh_valid)
 		gpsCopy(&gpsFresh, &gpsFleeting);
-		gps_trail_valid = true;
-		if (gps_trail_length < GPS_TRAIL_LENGTH)
-			gps_trail_length++;
-		gps_trail[gps_trail_next++] = gpsFleeting.point;
-		if (gps_trail_next == GPS_TRAIL_LENGTH)
-			gps_trail_next = 0;
-	}
 }
-static GPSPoint_t * backtrack_gps_trail(int backward_time)
+/* position at system time 'when', from the GPS fix history */
+static GPSPoint_t * gps_point_at(time_t when)
 {
-	int back_index, index;
-
-	if (!gps_trail_valid)
-		return (&gpsFresh.point);
-	back_index = backward_time / QDAC_MAIN_PERIOD;
-	if (back_index <= 0)
-		return (&gpsFresh.point);
-	if (back_index > gps_trail_length) {
-		if (gps_trail_length < GPS_TRAIL_LENGTH)
-			return (&gps_trail[0]);
-		else
-			return (&gps_trail[gps_trail_next]);
-	}
-	else { 
-		if (gps_trail_next >= back_index)
-			index = gps_trail_next - back_index;
-		else
-			index = gps_trail_next + GPS_TRAIL_LENGTH - back_index;
-		return &gps_trail[index];
-	}
+	if (gps_fresh_valid && gpsHistoryPointAt(when, &gps_backtrack))
+		return (&gps_backtrack);
+	return (&gpsFresh.point);
 }
 
 /*
 bool am_i_moving(uint32_t speed)
 {
-	return (gps_trail_valid && (gpsFleeting.speedKPH > speed));
+	return (gps_fresh_valid && (gpsFleeting.speedKPH > speed));
 }
 static uint32_t rssi_sort[NUM_RSSI];
 uint32_t find_median_rssi(struct freezer_control *freezer)
@@ -1759,60 +1655,9 @@ static void init_qdac_currentsensor_parameter(struct qdac_currentsensor_tag *cur
 		currentsensor_tag->report_cycle = LONG_MAX;
 }
 
-/*
-int quickpartition(uint32_t *A, int b, int e)
-{
-	uint32_t X;
-	int i, j, m;
-	if (b >= e)
-		return b;
-	m = A[e];
-	i = b;
-	for (j = b; j < e; j++) {
-		if (A[j] <= m) {
-			if (j > i) {
-				X = A[i];
-				A[i] = A[j];
-				A[j] = X;
-			}
-			++i;
-		}
-	}
-	if (i < e) {
-		X = A[e];
-		A[e] = A[i];
-		A[i] = X;
-	}
-	return i;
-}
-void quicksort(uint32_t *A, int b, int e)
-{
-	int pivot;
-	if (b < e) {
-		pivot = quickpartition(A, b, e);
-		if (pivot > b)
-			quicksort(A, b,  (pivot - 1));
-		if (pivot < e)
-			quicksort(A, (pivot + 1), e);
-	}
-}
-int quick_select(uint32_t *A, int b, int e, int rank)
-{
-	int pivot;
-	if (b == e)
-		return b; 
-	pivot = quickpartition(A, b, e);
-	if (pivot == rank)
-		return pivot;
-	else if (pivot > rank)
-		return quick_select(A, b, (pivot - 1), rank);
-	else
-		return quick_select(A, (pivot + 1), e, rank);
-}
-*/
 static int power_off_qdac(void) {
 	if(qdac_power == POWER_ON) {
-		if(system("echo high > /sys/aatsi_devs_ctrl/qdac") < 0) {
+		if (gpio_out_set_wait(GPIO_OUT_QDAC_POWER, false) < 0) {
 			printf("Power off QDAC hub failed\n");
 			return -1;
 		} else
@@ -1823,7 +1668,7 @@ static int power_off_qdac(void) {
 }
 static int power_on_qdac(void) {	
 	if(qdac_power == POWER_OFF) {
-		if(system("echo low > /sys/aatsi_devs_ctrl/qdac") < 0) {
+		if (gpio_out_set_wait(GPIO_OUT_QDAC_POWER, true) < 0) {
 			printf("Power up QDAC hub failed\n");
 			return -1;
 		} else
@@ -1858,20 +1703,6 @@ static void print_command(unsigned char *cmd, int cmd_length) {
 		printf("%02x ", cmd[i++]);
 	printf("\n");
 }
-static unsigned short qdac_crc16 (unsigned char *data, unsigned int n)
-{
-	unsigned char hi = 0xFF; /* High byte of CRC */
-	unsigned char lo = 0xFF; /* Low byte of CRC */
-	unsigned int idx; /* Index into CRC table */
-	unsigned int i; /* Index into data */
-
-	for (i = 0; i < n; ++i) {
-		idx = lo ^ data[i];
-		lo = hi ^ CRC_hi[idx];
-		hi = CRC_low[idx];	
-	}
-	return (hi << 8 | lo);
-}
 
 static void qdac_littleE_encode2Bytes(unsigned char *pdest, unsigned short val) {
 		*pdest = val;			/* encode low 8 bits */
@@ -1916,7 +1747,7 @@ static int tx_cmd_to_hub(unsigned char *cmd) {
 	
 	crc_length = cmd[2] + 2;
 	index = crc_length + 1;
-	crc_val = qdac_crc16(&(cmd[1]), crc_length);
+	crc_val = cksumCalcCRC16(&(cmd[1]), crc_length);
 	command_length = crc_length + 3;
 	qdac_littleE_encode2Bytes(&(cmd[index]), crc_val);
 
@@ -2182,12 +2013,8 @@ init_fail:
 }
 
 static void qdac_init_gps(void) {
-	int n;
-	
 	gpsClear(&gpsFresh);
 	gpsClear(&gpsFleeting);
-	for (n = 0; n < GPS_TRAIL_LENGTH; n++)
-		gpsPointClear(&gps_trail[n]);
 }
 
 static void remove_tag(struct qdac_tag_control *tag_c, struct tq_head *tqueue, struct QDAC_Tag *tag) {
@@ -2212,19 +2039,9 @@ static void print_time(char *des, int serial) {
 
 static void qdac_sample_temperature(struct qdac_temp_spec *temp_spec, struct QDAC_Tag *tag)
 {
-	int index;
-
 	if (tag->qdac_tag_type != HIGH_TEMP_TAG && tag->qdac_tag_type != LOW_TEMP_TAG)
 		return;
-	index = temp_spec->temp_index;
-
-	*(temp_spec->qdac_temp+index) = tag->cur_temp;
-	if (index == QDAC_NUM_TEMPERATURES - 1)
-		temp_spec->temp_index = 0; 
-	else
-		temp_spec->temp_index += 1;
-	if(temp_spec->temp_count < QDAC_NUM_TEMPERATURES)
-		temp_spec->temp_count += 1;
+	sample_window_add(&temp_spec->temps, tag->cur_temp);
 }
 
 static struct qdac_temp_spec *search_temp_spec(struct qdac_temp_spec **temp_spec, int tag_serial, int tag_type) {
@@ -2258,8 +2075,6 @@ static struct qdac_temp_spec *create_temp_spec(void) {
 	tmp->qdac_tag_serial = 0;
 	tmp->qdac_tag_model = 0;
 	tmp->qdac_tag_type = 0;
-	tmp->temp_index = 0;
-	tmp->temp_count = 0;
 	tmp->zone_id = 0xFF;
 	tmp->cur_avg = 0;
 	tmp->cur_high = 0;
@@ -2267,7 +2082,7 @@ static struct qdac_temp_spec *create_temp_spec(void) {
 	tmp->set_high = 0;
 	tmp->set_low = 0;
 	tmp->alarm_type = QDAC_ALARM_NORM;
-	tmp->qdac_temp = (short *)malloc(QDAC_NUM_TEMPERATURES*sizeof(short));
+	sample_window_init(&tmp->temps, QDAC_NUM_TEMPERATURES);
 	tmp->qdac_temp_spec_next = NULL;
 //	tmp->qdac_zone_general = NULL;
 	return tmp;
@@ -2275,28 +2090,9 @@ static struct qdac_temp_spec *create_temp_spec(void) {
 
 static void qdac_temp_cal(struct qdac_temp_spec *temp_spec)
 {
-	int i;
-	
-	temp_spec->cur_high = *(temp_spec->qdac_temp);
-	temp_spec->cur_low = *(temp_spec->qdac_temp);
-	temp_spec->cur_avg = *(temp_spec->qdac_temp);
-
-	if (temp_spec->temp_count <= 1)
-		return;
-	else {
-//	printf("Tag %d Stored: ", temp_spec->qdac_serial);
-//	for (i=0; i<temp_spec->temp_count; i++) 
-//		printf("%d ", *(temp_spec->qdac_temp+i));
-//	printf("\n");
-		for (i=1; i<temp_spec->temp_count; i++) {
-			if(*(temp_spec->qdac_temp+i) > temp_spec->cur_high) 
-				temp_spec->cur_high= *(temp_spec->qdac_temp+i);
-			else if(*(temp_spec->qdac_temp+i) < temp_spec->cur_low) 
-				temp_spec->cur_low = *(temp_spec->qdac_temp+i);
-			temp_spec->cur_avg += *(temp_spec->qdac_temp+i);
-		}	
-		temp_spec->cur_avg /= temp_spec->temp_count;
-	}	
+	temp_spec->cur_high = sample_window_max(&temp_spec->temps);
+	temp_spec->cur_low = sample_window_min(&temp_spec->temps);
+	temp_spec->cur_avg = sample_window_mean(&temp_spec->temps);
 //printf("!!Serial %d: high: %d; low: %d; avg: %d\n", temp_spec->qdac_tag_serial, temp_spec->cur_high,
 //		temp_spec->cur_avg, temp_spec->cur_low);
 }
@@ -14,14 +14,20 @@
 #include <signal.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <poll.h>
 #include "stdtypes.h"
 #include "log.h"
+#include "checksum.h"
 #include "comport.h"
 #include "propman.h"
 #include "gpstools.h"
 #include "gps.h"
 #include "packet.h"
 #include "protocol.h"
+#include "gpio_out.h"
+#include "sample_window.h"
+#include "pt1000.h"
+#include "tagreader.h"
 #include "rfid.h"
 #include "reader_type.h"
 #define RFID_MAIN_PERIOD 10 
@@ -31,8 +37,7 @@
 #define NUM_ZONES 8
 #define NUM_TEMPERATURES 10
 #define NUM_RSSI 8
-#define RAW_READ_SIZE 32
-#define MAX_READ_LEN 24
+#define RFID_RBUF_SIZE 512
 #define TAG_PACKET_SIZE_MAX 24
 #define TAG_PACKET_SIZE_19 19
 #define TAG_PACKET_SIZE_20 20
@@ -48,7 +53,7 @@
 #define LOCK_CONTACT_B 0x20
 #define LOCK_FLAG_ALARM LOCK_CONTACT_A
 #define LOCK_FLAG_ARM (LOCK_CONTACT_A | LOCK_CONTACT_B)
-#define NUM_TAGS_PER_POOL 128
+#define NUM_TAGS_PER_SLAB 128
 #define MAX_TEMPERATURE_RECORDS 8
 #define STATUS_RFID_TAG_IN 0xF500
 #define STATUS_RFID_TAG_OUT 0xF501
@@ -79,7 +84,6 @@
 #define ROLE_MOTION 32
 #define ROLE_SENSOR 64
 #define ROLE_HUMIDITY 128
-#define	GPS_TRAIL_LENGTH 32 
 #define	RSSI_BITS 5 
 #define	RSSI_TOTAL (1 << RSSI_BITS)
 #define	RSSI_INDEX_M (RSSI_TOTAL - 1)
@@ -101,10 +105,25 @@ struct Tag {
 	uint8_t battery;
 	uint8_t flag;
 	uint8_t humidity;
+	struct tag_timer timer;	/* tag-out deadline, in its role's tag_heap */
 };
 
 TAILQ_HEAD(tq_head, Tag) tag_queue_1;
 
+/* tag number range of a role, see init_role_table() */
+#define MAX_ROLE_RANGES 32
+struct role_range {
+	uint32_t id_lower;
+	uint32_t id_upper;
+	uint32_t role;
+	int tag_in_time;
+	int tag_out_time;
+	struct tq_head *tqueue;
+	struct tag_index *tindex;
+	struct tag_heap *theap;
+	pthread_mutex_t *pmutex;
+};
+
 struct tag_control {
 	uint32_t tnum_min;
 	uint32_t tnum_max;
@@ -113,7 +132,6 @@ struct tag_control {
 	pthread_mutex_t mutex_locker;
 	pthread_mutex_t mutex_cargo;
 	pthread_mutex_t mutex_switch;
-	pthread_mutex_t mutex_recycle;
 	pthread_mutex_t mutex_hightemp;
 	pthread_mutex_t mutex_motion;
 	pthread_mutex_t mutex_sensor;
@@ -122,14 +140,34 @@ struct tag_control {
 	struct tq_head locker_queue;
 	struct tq_head cargo_queue;
 	struct tq_head switch_queue;
-	struct tq_head recycle_queue;
 	struct tq_head hightemp_queue;
 	struct tq_head motion_queue;
 	struct tq_head sensor_queue;
 	struct tq_head humidity_queue;
+	struct tag_index freezer_index;
+	struct tag_index locker_index;
+	struct tag_index cargo_index;
+	struct tag_index switch_index;
+	struct tag_index hightemp_index;
+	struct tag_index motion_index;
+	struct tag_index sensor_index;
+	struct tag_index humidity_index;
+	struct tag_heap freezer_heap;
+	struct tag_heap locker_heap;
+	struct tag_heap cargo_heap;
+	struct tag_heap switch_heap;
+	struct tag_heap hightemp_heap;
+	struct tag_heap motion_heap;
+	struct tag_heap sensor_heap;
+	struct tag_heap humidity_heap;
+	struct role_range ranges[MAX_ROLE_RANGES];	/* sorted, not overlapping */
+	volatile int num_ranges;
+	struct tag_pool pool;		/* the tags of all roles */
 	uint32_t reader_type;
 	uint32_t battery_maximum;
 	uint32_t battery_alarm_cycle;
+	bool battery_pulse;		/* this period checks tag batteries */
+	bool time_adjust;		/* the clock was set since the last period */
 	uint16_t reader_id;
 	uint16_t customer_id;
 };
@@ -139,12 +177,9 @@ struct rfid_thread_args {
 };
 struct temp_record {
 	uint32_t tnum;
-	uint32_t count;
-	uint32_t next;
 	int high;
 	int low;
-	bool sorted;
-	uint32_t t[NUM_TEMPERATURES];
+	struct sample_window t;
 };
 struct freezer_control {
 	uint32_t id_lower;
@@ -165,11 +200,9 @@ struct freezer_control {
 	uint32_t alarm_delay;
 	uint32_t alarm_times;
 	bool	latched;
-	uint32_t rssi_point;
 	uint32_t rssi_delta;
-	uint32_t rssi_samples;
 	uint32_t fading_count;
-	uint32_t rssi_sample[NUM_RSSI];
+	struct sample_window rssi;
 	struct temp_record t_zone[NUM_ZONES];
 };
 struct lock_control {
@@ -256,7 +289,7 @@ static struct tag_control tag_control_1 = {.tnum_max = 0, .role = 0,
 			.mutex_hightemp = PTHREAD_MUTEX_INITIALIZER, 
 			.mutex_motion = PTHREAD_MUTEX_INITIALIZER,
 			.mutex_sensor = PTHREAD_MUTEX_INITIALIZER,
-			.mutex_recycle = PTHREAD_MUTEX_INITIALIZER,
+			.pool = {.mutex = PTHREAD_MUTEX_INITIALIZER},
 			.mutex_humidity = PTHREAD_MUTEX_INITIALIZER,};
 
 static struct rfid_thread_args rfid_args =  {0, &tag_control_1};
@@ -269,27 +302,29 @@ static struct motion_control motion;
 static struct sensor_control sensor;
 static struct humidity_control humidity;
 
-static struct temp_record temp_sorted[NUM_ZONES];
 static ComPort_t rfidCom = {.name = "ttyS2", .bps = 115200, .read_len = TAG_PACKET_SIZE_19,};
-static GPS_t gpsFresh;
-static GPS_t gpsFleeting;
-static GPSPoint_t gps_trail[GPS_TRAIL_LENGTH];
+static struct reader_gps rfid_gps;
 static Packet_t rfid_event_packet;
-static struct Tag * tag_pool1;
-static struct Tag * tag_pool2;
 static int rfid_reader_running = 1;
 static int rfid_main_running = 1;
-static unsigned char raw_buf[RAW_READ_SIZE * 2];
+/* reads only fill RFID_RBUF_SIZE bytes; the zeroed slack past the end lets
+ * print_tag_raw/parse_tag read a full size packet even when a short packet
+ * ends the buffer */
+static unsigned char rfid_rbuf[RFID_RBUF_SIZE + TAG_PACKET_SIZE_MAX];
+static int rfid_rbuf_head;		/* start of unframed data in 'rfid_rbuf' */
+static int rfid_rbuf_tail;		/* end of data in 'rfid_rbuf' */
 
-static int HighTemp_tag_processing(struct Tag *high_temp_tag);
 void * rfid_thread_main(void * thread_args);
 void * rfid_thread_reader(void * thread_args);
-static int verify_tag_packet(unsigned char * pkt, int len, int * pkt_len);
+static int rfid_rbuf_fill(int fd);
+static unsigned char *rfid_rbuf_next(void);
 static void parse_tag(struct tag_control *tag_c, unsigned char *pkt);
 static bool admit_tag(struct Tag *tag, time_t now, int period);
 static bool tag_not_bursting(struct Tag *tag, struct timespec ts1);
-static int calculate_crc8(unsigned char * pkt, int len);
-static int init_tag_queue(struct tag_control *tag_c, struct Tag *tag_pool1, struct Tag *tag_pool2);
+static int init_tag_queue(struct tag_control *tag_c);
+static struct Tag *evict_tag(struct tq_head *tqueue, struct tag_index *tindex, struct tag_heap *theap);
+static time_t next_tag_deadline(struct tag_control *tag_c);
+static int rfid_queue_aging(struct tag_control *tag_c);
 static void freezer_queue_processing(struct tag_control *tag_c, struct freezer_control *freezer);
 static int locker_queue_processing(struct tag_control *tag_c, struct lock_control *locker);
 static void cargo_queue_processing(struct tag_control *tag_c, struct cargo_control *truck);
@@ -299,15 +334,13 @@ static int motion_queue_processing(struct tag_control *tag_c, struct motion_cont
 static int sensor_queue_processing(struct tag_control *tag_c, struct sensor_control *psensor);
 static int freezer_processing(struct tag_control *tag_c, struct freezer_control *freezer);
 static void humidity_queue_processing(struct tag_control *tag_c, struct humidity_control *phumidity);
-static void battery_time_checking(struct tag_control *tag_c);
-static struct Tag *search_tag(struct tq_head *tqueue, uint32_t tnum);
+static bool battery_check_due(struct tag_control *tag_c);
+static void check_tag_battery(struct tag_control *tag_c, struct Tag *tag, time_t now, struct tm *ptm);
+static void recycle_tag(struct tq_head *tqueue, struct tag_index *tindex, struct Tag *tag, void **spent);
 static void sample_temperature(struct freezer_control *freezer, struct Tag *tag);
-static void update_gps_trail(void);
-static bool am_i_moving(uint32_t speed);
 static void sample_rssi(struct freezer_control *freezer, uint32_t rssi);
 static uint32_t find_median_rssi(struct freezer_control *freezer);
 static void reset_freezer_rssi_record(struct freezer_control *freezer);
-static GPSPoint_t * backtrack_gps_trail(int backward_time);
 static void init_tag_parameter(struct tag_control *tag_c);
 static void init_freezer_parameter(struct freezer_control *freezer);
 static void init_lock_parameter(struct lock_control *locker); 
@@ -317,13 +350,13 @@ static void init_switch_parameter(struct switch_control *p_switch);
 static void init_motion_parameter(struct motion_control *p_motion);
 static void init_sensor_parameter(struct sensor_control *p_sensor);
 static void init_humidity_parameter(struct humidity_control *p_humidity);
+static void init_role_table(struct tag_control *tag_c);
+static struct role_range *search_role(struct tag_control *tag_c, uint32_t tnum);
 static void init_temperature_parameter(struct freezer_control *freezer);
 static int make_temperature_event(struct tag_control *tag_c, struct freezer_control *freezer, int alarm_type);
 static void make_rfid_event(struct tag_control *tag_c, struct Tag * tag, GPSPoint_t *coord, uint32_t ev_status, time_t timestamp);
 static void reset_freezer_zone(struct freezer_control *freezer, int zn);
 static void reset_freezer_zones(struct freezer_control *freezer);
-static void quicksort(uint32_t *A, int b, int e);
-static int quick_select(uint32_t *A, int b, int e, int rank);
 
 /*static int print_uint32(uint32_t *T, int l)
 {
@@ -361,26 +394,15 @@ int rfid_initialize(void)
 }
 void * rfid_thread_main(void *args)
 {
-	int n, n_alarms;
+	int n_alarms;
+	time_t now, cycle_start, wake;
 	
-	tag_pool1 = malloc(NUM_TAGS_PER_POOL * sizeof(struct Tag));
-	if (tag_pool1 == NULL) {
-		perror("Outof Memory");
-		return NULL;
-	}
-	tag_pool2 = malloc(NUM_TAGS_PER_POOL * sizeof(struct Tag));
-	if (tag_pool2 == NULL) {
+	if (init_tag_queue(&tag_control_1) < 0) {
 		perror("Outof Memory");
 		return NULL;
 	}
-	memset(tag_pool1, 0, NUM_TAGS_PER_POOL * sizeof(struct Tag));
-	memset(tag_pool2, 0, NUM_TAGS_PER_POOL * sizeof(struct Tag));
-	init_tag_queue(&tag_control_1, tag_pool1, tag_pool2);
 	init_tag_parameter(&tag_control_1);
-	gpsClear(&gpsFresh);
-	gpsClear(&gpsFleeting);
-	for (n = 0; n < GPS_TRAIL_LENGTH; n++)
-		gpsPointClear(&gps_trail[n]);
+	reader_gps_init(&rfid_gps);
 	if (tag_control_1.role & ROLE_FREEZER) {
 		memset(&freezer1, 0, sizeof(freezer1));
 		init_freezer_parameter(&freezer1);
@@ -414,11 +436,16 @@ void * rfid_thread_main(void *args)
 		memset(&humidity, 0, sizeof(humidity));
 		init_humidity_parameter(&humidity); 
 	}
+	init_role_table(&tag_control_1);
 	printf("The ROLE is %x\n", tag_control_1.role);
 
 	while (rfid_main_running != 0) { 
-		update_gps_trail();
-		battery_time_checking(&tag_control_1);
+		cycle_start = time(NULL);
+		reader_gps_update(&rfid_gps);
+		/* one pass per role: aging, battery alerts, sampling and events */
+		tag_control_1.time_adjust = rfid_queue_time_adjust;
+		rfid_queue_time_adjust = false;
+		tag_control_1.battery_pulse = battery_check_due(&tag_control_1);
 		n_alarms = 0;
 		if (tag_control_1.role & ROLE_FREEZER) 
 			n_alarms = freezer_processing(&tag_control_1, &freezer1);
@@ -443,12 +470,28 @@ void * rfid_thread_main(void *args)
 			protocolStartSession();
 /*recession*/
 recession:
-		sleep(RFID_MAIN_PERIOD);
+		/* until the next period, age tags off as their deadlines pass */
+		while (rfid_main_running != 0) {
+			now = time(NULL);
+			if (now >= cycle_start + RFID_MAIN_PERIOD || now < cycle_start)
+				break;
+			wake = next_tag_deadline(&tag_control_1);
+			if (wake == 0 || wake >= cycle_start + RFID_MAIN_PERIOD)
+				wake = cycle_start + RFID_MAIN_PERIOD;
+			else
+				wake++;		/* a tag is out once its deadline has passed */
+			if (wake > now) {
+				sleep(wake - now);
+				continue;
+			}
+			reader_gps_update(&rfid_gps);
+			if (rfid_queue_aging(&tag_control_1) > 0)
+				protocolStartSession();
+		}
 		if (property_refresh_flag & PROP_REFRESH_TEMPERATURE)
 			init_temperature_parameter(&freezer1);	
 	}
-	free(tag_pool1);
-	free(tag_pool2);
+	tag_pool_free(&tag_control_1.pool);
 		
 	return NULL;
 }
@@ -456,53 +499,36 @@ void * rfid_thread_reader(void * thread_args)
 {
 	struct rfid_thread_args * args = (struct rfid_thread_args *)thread_args;	
 	struct tag_control *tag_c = args->tag_c;
-	struct sigevent sev1;
-	struct itimerspec it1;
-	timer_t timer1;
+	struct pollfd fds1;
 	int rfid_fd = args->tty_fd;
-	int i, len, ilen, rlen, offset;
-	unsigned char *pread, *pkt;
+	int n;
+	unsigned char *pkt;
 
 	while (tag_c->role == 0 && rfid_reader_running != 0)
 		sleep(RFID_MAIN_PERIOD);
 	if (rfid_reader_running == 0)
 		goto exit_r;
-	/*setup timer */
-	sev1.sigev_notify = SIGEV_SIGNAL;
-	sev1.sigev_signo = SIG_TIMEOUT;
-	sev1.sigev_value.sival_int = TIMER_RFID_1;
-	i = timer_create(CLOCK_REALTIME, &sev1, &timer1);
-	it1.it_interval.tv_sec = RFID_IF_TIMEOUT;
-	it1.it_interval.tv_nsec = 0;
-	it1.it_value.tv_sec = RFID_IF_TIMEOUT;
-	it1.it_value.tv_nsec = 0;
-	pkt = raw_buf;
-	pread = pkt; 
-	len = 0;
-	ilen = 0;
-	i = 0;
-//	rlen = TAG_PACKET_SIZE_19;
-	rlen = TAG_PACKET_SIZE_20;
+	fds1.fd = rfid_fd;
+	fds1.events = POLLIN;
+	rfid_rbuf_head = rfid_rbuf_tail = 0;
 	
 	while (rfid_reader_running != 0) { 
-		timer_settime(timer1, 0, &it1, NULL);
-		if ((len = read(rfid_fd, pread, rlen)) < 0) {
-		//	if (errno == EINTR)
-			perror("Read RFID reader");
-				continue;
+		if ((n = poll(&fds1, 1, RFID_IF_TIMEOUT * 1000)) < 0) {
+			if (errno != EINTR)
+				perror("Poll RFID reader");
+			continue;
+		} else if (n == 0) {
+			printf("RFID reader silent for %d seconds\n", RFID_IF_TIMEOUT);
+			continue;
 		}
-		print_tag_raw(pread);
-		ilen += len;
-		if ((offset = verify_tag_packet(pkt, ilen, &rlen)) >= 0) 
-			parse_tag(tag_c, pkt + offset);
-		if (offset >= 0 || ilen + rlen >= RAW_READ_SIZE) {
-			i ^= 1;
-			pkt = i ? raw_buf : (raw_buf + RAW_READ_SIZE);
-			pread = pkt;
-			ilen = 0;
+		if (rfid_rbuf_fill(rfid_fd) < 0) {
+			perror("Read RFID reader");
+			continue;
 		}
-		else {
-			pread += len;
+		/* every complete packet received since the last wakeup */
+		while ((pkt = rfid_rbuf_next()) != NULL) {
+			print_tag_raw(pkt);
+			parse_tag(tag_c, pkt);
 		}
 	}
 	rfid_reader_running = 0;
@@ -510,68 +536,53 @@ exit_r:
 	comPortClose(&rfidCom);
 	return NULL;
 }
-int calculate_crc8(unsigned char * pkt, int len)
+/* append whatever is available on the reader port to 'rfid_rbuf' */
+// The port is opened with VMIN set to a packet size, so one read returns
+// at least a packet's worth of bytes, or everything a burst delivered.
+int rfid_rbuf_fill(int fd)
 {
-	int i, j; 
-	int crc = 0xFF;
-	for (i = 0; i < len; i++) {
-		crc ^= pkt[i];
-		for (j = 0; j < 8; j++) {
-			if (crc & 1)
-				crc = (crc >> 1) ^ 0x8C;
-			else
-				crc >>= 1;
-		}
-	}
-	return crc;
+	int n;
+
+	/* move any partial packet to the front of the buffer */
+	if (rfid_rbuf_head > 0) {
+		rfid_rbuf_tail -= rfid_rbuf_head;
+		if (rfid_rbuf_tail > 0)
+			memmove(rfid_rbuf, rfid_rbuf + rfid_rbuf_head, rfid_rbuf_tail);
+		rfid_rbuf_head = 0;
+	}
+	if (rfid_rbuf_tail >= RFID_RBUF_SIZE)
+		rfid_rbuf_tail = 0;
+	if ((n = read(fd, rfid_rbuf + rfid_rbuf_tail, RFID_RBUF_SIZE - rfid_rbuf_tail)) > 0)
+		rfid_rbuf_tail += n;
+	return n;
 }
-int verify_tag_packet(unsigned char * pkt, int len, int * rlen)
+/* return the next complete, CRC-valid tag packet in 'rfid_rbuf' */
+// Packet: 0xAA, length (10..24), length - 1 bytes ending with the CRC8, 0x44.
+// Returns NULL if no complete packet is buffered, leaving 'rfid_rbuf_head' at
+// the start of a possible partial packet.  The packet remains valid until
+// the next call to 'rfid_rbuf_fill'.
+unsigned char *rfid_rbuf_next(void)
 {
-	unsigned char *sop, *cstart;
-	int offset, l0, l1, l2, crc;
-
-	cstart = pkt;
-	l0 = len;
-	l1 = 0;
-	while ((sop = memchr(cstart, 0xAA, l0)) != NULL) {
-		if (sop[1] >= TAG_PACKET_SIZE_HALF && sop[1] <= TAG_PACKET_SIZE_MAX) {
-			l1 = sop[1];
+	unsigned char *sop, *end = rfid_rbuf + rfid_rbuf_tail;
+	int l1;
+
+	for (sop = rfid_rbuf + rfid_rbuf_head; sop < end; sop++) {
+		if (sop[0] != 0xAA)
+			continue;
+		if (sop + 1 >= end)
 			break;
-		}
-		else {
-			cstart = sop + 1;	
-			l0 -= (sop - pkt) + 1; 
-			if (l0 <= 0) {
-				sop = NULL;
-				break;
-			}
-		}
-	}
-	if (sop == NULL) {
-		*rlen = TAG_PACKET_SIZE_HALF;
-		return -1;
-	}
-	offset = sop - pkt;
-	l2 = len - (offset + l1 + 2); 
-	if (l2 == 0)
-		*rlen = l1 + 2;
-	else if (l2 < 0) {
-		*rlen = -l2; 
-		return -1;
-	}
-	else
-		*rlen = l1 + 2 - l2;
-	if (sop[l1 + 1] != 0x44) {
-		sop[0] = 0;
-		*rlen = TAG_PACKET_SIZE_HALF;
-		return -1;
-	}
-	if ((crc = calculate_crc8(sop, l1 + 1)) == 0)
-		return offset;
-	else {
-		sop[0] = 0;
-		return -1;
+		l1 = sop[1];
+		if (l1 < TAG_PACKET_SIZE_HALF || l1 > TAG_PACKET_SIZE_MAX)
+			continue;
+		if (sop + l1 + 2 > end)
+			break;
+		if (sop[l1 + 1] != 0x44 || cksumCalcCRC8(sop, l1 + 1) != 0)
+			continue;
+		rfid_rbuf_head = (sop + l1 + 2) - rfid_rbuf;
+		return sop;
 	}
+	rfid_rbuf_head = sop - rfid_rbuf;
+	return NULL;
 }
 
 uint32_t monitor_tag = 0;
@@ -580,18 +591,13 @@ void parse_tag(struct tag_control *tag_c, unsigned char *pkt)
 	uint32_t tnum, tag_type; 
 	int max_period;
 	struct Tag *tag = NULL; 
+	struct role_range *range;
 	struct tq_head *tqueue;
+	struct tag_index *tindex;
+	struct tag_heap *theap;
 	pthread_mutex_t *pmutex;
 	struct timespec tsnow;
 	uint16_t temp = 0xFFFF;
-#define TAG_TYPE_FREEZER 1
-#define TAG_TYPE_LOCK 2
-#define TAG_TYPE_CARGO 4
-#define TAG_TYPE_SWITCH 8
-#define TAG_TYPE_HIGHTEMP 16
-#define TAG_TYPE_MOTION 32
-#define TAG_TYPE_SENSOR 64
-#define TAG_TYPE_HUMIDITY 128
 
 	tnum = (pkt[7] << 16) + (pkt[8] << 8) + pkt[9];
 
@@ -599,50 +605,14 @@ void parse_tag(struct tag_control *tag_c, unsigned char *pkt)
 		printf("Tag %d is read\n", monitor_tag);
 	if (tnum > tag_c->tnum_max || tnum < tag_c->tnum_min)
 		return;
-	if ((tag_c->role & ROLE_FREEZER) && tnum >= freezer1.id_lower && tnum <= freezer1.id_upper) {
-		tag_type = TAG_TYPE_FREEZER;
-		max_period = freezer1.tag_in_time;
-		tqueue = &tag_c->freezer_queue;
-		pmutex = &tag_c->mutex_freezer;
-	} else if ((tag_c->role & ROLE_LOCKER) && tnum >= locker1.id_lower && tnum <= locker1.id_upper) {
-		tag_type = TAG_TYPE_LOCK;
-		max_period = locker1.tag_in_time;
-		tqueue = &tag_c->locker_queue;
-		pmutex = &tag_c->mutex_locker;
-	} else if ((tag_c->role & ROLE_CARGO) && tnum >= truck1.id_lower && tnum <= truck1.id_upper) {
-		tag_type = TAG_TYPE_CARGO;
-		max_period = truck1.tag_in_time;
-		tqueue = &tag_c->cargo_queue;
-		pmutex = &tag_c->mutex_cargo;
-	} else if ((tag_c->role & ROLE_SWITCH) && tnum >= switch1.id_lower && tnum <= switch1.id_upper) {
-		tag_type = TAG_TYPE_SWITCH;
-		max_period = switch1.tag_in_time;
-		tqueue = &tag_c->switch_queue;
-		pmutex = &tag_c->mutex_switch;
-	} else if ((tag_c->role & ROLE_HIGHTEMP) && 
-	((tnum >= high_temp.id_lower && tnum <= high_temp.id_upper) || (tnum >= high_temp.id_lower_2 && tnum <= high_temp.id_upper_2))) {
-			tag_type = TAG_TYPE_HIGHTEMP;
-			max_period = high_temp.tag_in_time;
-			tqueue = &tag_c->hightemp_queue;
-			pmutex = &tag_c->mutex_hightemp;
-	} else if ((tag_c->role & ROLE_MOTION) && tnum >= motion.id_lower && tnum <= motion.id_upper) {
-		tag_type = TAG_TYPE_MOTION;
-		max_period = motion.tag_in_time;
-		tqueue = &tag_c->motion_queue;
-		pmutex = &tag_c->mutex_motion;
-	} else if ((tag_c->role & ROLE_SENSOR) && tnum >= sensor.id_lower && tnum <= sensor.id_upper) {
-		tag_type = TAG_TYPE_SENSOR;
-		max_period = sensor.tag_in_time;
-		tqueue = &tag_c->sensor_queue;
-		pmutex = &tag_c->mutex_sensor;
-	} else if ((tag_c->role & ROLE_HUMIDITY) && tnum >= humidity.id_lower && tnum <= humidity.id_upper) {
-		tag_type = TAG_TYPE_HUMIDITY;
-		max_period = humidity.tag_in_time;
-		tqueue = &tag_c->humidity_queue;
-		pmutex = &tag_c->mutex_humidity;
-	} 
-	else
+	if ((range = search_role(tag_c, tnum)) == NULL)
 		return;
+	tag_type = range->role;
+	max_period = range->tag_in_time;
+	tqueue = range->tqueue;
+	tindex = range->tindex;
+	theap = range->theap;
+	pmutex = range->pmutex;
 
 	if (tag_c->customer_id == 0) {
 		tag_c->customer_id = (pkt[5] << 8) + pkt[6];
@@ -653,20 +623,22 @@ void parse_tag(struct tag_control *tag_c, unsigned char *pkt)
 		return;
 	}
 	pthread_mutex_lock(pmutex);
-	tag = search_tag(tqueue, tnum);
+	tag = (struct Tag *)tag_index_search(tindex, tnum);
 	if (tag == NULL) {
-		if (TAILQ_EMPTY(&tag_c->recycle_queue)) {
+		if (tindex->count >= tag_c->pool.role_quota || (tag = tag_pool_alloc(&tag_c->pool)) == NULL)
+			tag = evict_tag(tqueue, tindex, theap);
+		if (tag == NULL) {
 			pthread_mutex_unlock(pmutex);
+			if (tag_pool_drop(&tag_c->pool, tsnow.tv_sec))
+				printf("RFID tag pool exhausted (%u tags, role %x)\n", tag_c->pool.num_tags, tag_type);
 			return;
 		}
-		pthread_mutex_lock(&tag_c->mutex_recycle);
-		tag = tag_c->recycle_queue.tqh_first;
-		TAILQ_REMOVE(&tag_c->recycle_queue, tag, link);
-		pthread_mutex_unlock(&tag_c->mutex_recycle);
 		TAILQ_INSERT_TAIL(tqueue, tag, link);
 		tag->tnum = tnum;
 		tag->rssi = pkt[4];
 		tag->status = 0;
+		tag_index_add(tindex, tnum, tag);
+		tag_heap_arm(theap, &tag->timer, tag, &tag->recent, tsnow.tv_sec + range->tag_out_time);
 	} else if (!(tag->status & (TAG_FRESH | TAG_SENIOR))) {
 		if (admit_tag(tag, tsnow.tv_sec, max_period))
 			tag->status |= TAG_FRESH;
@@ -682,7 +654,7 @@ void parse_tag(struct tag_control *tag_c, unsigned char *pkt)
 	
 //if(tag->tnum == 45000) printf("tag %d flag %x\n", tag->tnum, tag->flag);
 
-	if (tag_type == TAG_TYPE_LOCK) {
+	if (tag_type == ROLE_LOCKER) {
 		if (tag_not_bursting(tag, tsnow))
 			tag->status &= ~TAG_BURSTING;
 		else
@@ -699,39 +671,81 @@ void parse_tag(struct tag_control *tag_c, unsigned char *pkt)
 	else
 */		tag->recent = tsnow.tv_sec;
 }
-int init_tag_queue(struct tag_control *tag_c, struct Tag *tag_pool1, struct Tag *tag_pool2)
+int init_tag_queue(struct tag_control *tag_c)
 {
-	int i;
 	TAILQ_INIT(&tag_c->locker_queue);
 	TAILQ_INIT(&tag_c->cargo_queue);
 	TAILQ_INIT(&tag_c->switch_queue);
-	TAILQ_INIT(&tag_c->recycle_queue);
 	TAILQ_INIT(&tag_c->freezer_queue);
 	TAILQ_INIT(&tag_c->hightemp_queue);
 	TAILQ_INIT(&tag_c->motion_queue);
 	TAILQ_INIT(&tag_c->sensor_queue);
 	TAILQ_INIT(&tag_c->humidity_queue);
+	memset(&tag_c->freezer_index, 0, sizeof(tag_c->freezer_index));
+	memset(&tag_c->locker_index, 0, sizeof(tag_c->locker_index));
+	memset(&tag_c->cargo_index, 0, sizeof(tag_c->cargo_index));
+	memset(&tag_c->switch_index, 0, sizeof(tag_c->switch_index));
+	memset(&tag_c->hightemp_index, 0, sizeof(tag_c->hightemp_index));
+	memset(&tag_c->motion_index, 0, sizeof(tag_c->motion_index));
+	memset(&tag_c->sensor_index, 0, sizeof(tag_c->sensor_index));
+	memset(&tag_c->humidity_index, 0, sizeof(tag_c->humidity_index));
+	memset(&tag_c->freezer_heap, 0, sizeof(tag_c->freezer_heap));
+	memset(&tag_c->locker_heap, 0, sizeof(tag_c->locker_heap));
+	memset(&tag_c->cargo_heap, 0, sizeof(tag_c->cargo_heap));
+	memset(&tag_c->switch_heap, 0, sizeof(tag_c->switch_heap));
+	memset(&tag_c->hightemp_heap, 0, sizeof(tag_c->hightemp_heap));
+	memset(&tag_c->motion_heap, 0, sizeof(tag_c->motion_heap));
+	memset(&tag_c->sensor_heap, 0, sizeof(tag_c->sensor_heap));
+	memset(&tag_c->humidity_heap, 0, sizeof(tag_c->humidity_heap));
+
+	/* the first two slabs up front, as many tags as the fixed pools had */
+	return tag_pool_init(&tag_c->pool, sizeof(struct Tag), NUM_TAGS_PER_SLAB,
+			propGetUInt32AtIndex(PROP_RFID_TAG_POOL, 0, 1024),
+			propGetUInt32AtIndex(PROP_RFID_TAG_POOL, 1, 512), 2);
+}
+/* Earliest tag-out deadline of all roles, 0 if no tag is armed */
+time_t next_tag_deadline(struct tag_control *tag_c)
+{
+	struct role_range *range;
+	time_t deadline = 0, next;
+	int i;
 
-	for (i = 0; i < NUM_TAGS_PER_POOL; i++) {
-		tag_pool1[i].tnum = i;
-		TAILQ_INSERT_HEAD(&tag_c->recycle_queue, &tag_pool1[i], link);
-	}
-	for (i = 0; i < NUM_TAGS_PER_POOL; i++) {
-		tag_pool2[i].tnum = i;
-		TAILQ_INSERT_HEAD(&tag_c->recycle_queue, &tag_pool2[i], link);
+	for (i = 0; i < tag_c->num_ranges; i++) {
+		range = &tag_c->ranges[i];
+		pthread_mutex_lock(range->pmutex);
+		next = tag_heap_next(range->theap);
+		if (next != 0 && (deadline == 0 || next < deadline))
+			deadline = next;
+		pthread_mutex_unlock(range->pmutex);
 	}
-	return 0;
+	return deadline;
 }
-struct Tag *search_tag(struct tq_head *tqueue, uint32_t tnum)
+static bool tag_unadmitted(void *tag)
 {
-	struct Tag *tag = NULL;
-	if (TAILQ_EMPTY(tqueue))
-		return tag;
-	TAILQ_FOREACH(tag, tqueue, link) {
-		if (tag->tnum == tnum)
-			break;
+	return !(((struct Tag *)tag)->status & (TAG_FRESH | TAG_SENIOR));
+}
+/* Reuse the least recently heard tag of a role that was never admitted (no
+ * IN event was made for it, so no OUT event is owed).  Admitted tags are
+ * only ever dropped by the queue processing.  Caller holds the role mutex. */
+struct Tag *evict_tag(struct tq_head *tqueue, struct tag_index *tindex, struct tag_heap *theap)
+{
+	struct Tag *lru = (struct Tag *)tag_heap_evict(theap, tag_unadmitted);
+
+	if (lru != NULL) {
+		tag_index_remove(tindex, lru->tnum, lru);
+		TAILQ_REMOVE(tqueue, lru, link);
+		memset(lru, 0, sizeof(*lru));
 	}
-	return tag;
+	return lru;
+}
+/* Remove a tag from its role queue and index onto the 'spent' list, which
+ * tag_pool_release() returns to the pool.  Caller holds the role mutex. */
+void recycle_tag(struct tq_head *tqueue, struct tag_index *tindex, struct Tag *tag, void **spent)
+{
+	tag_index_remove(tindex, tag->tnum, tag);
+	TAILQ_REMOVE(tqueue, tag, link);
+	memset(tag, 0, sizeof(*tag));
+	tag_pool_spend(spent, tag);
 }
 bool admit_tag(struct Tag *tag, time_t now, int period)
 {
@@ -744,113 +758,168 @@ bool tag_not_bursting(struct Tag *tag, struct timespec ts1)
 }
 static uint32_t freezer_beat = 0;
 
-/* freezer high temperature processing algorithm 
-The temperature table:
-*/
-int PT1000_Table [70][2] =
+/* Tag-out processing.  A role's tags are aged off its tag_heap as their
+ * deadlines pass, instead of sweeping the whole queue every period: by the
+ * role's queue processing each period, and by rfid_queue_aging() when
+ * rfid_thread_main() wakes at the earliest deadline in between.  The aging
+ * functions are called with the role mutex held, and put the tags gone out
+ * on a 'spent' list for tag_pool_release(). */
+static void freezer_detach(struct tag_control *tag_c, struct freezer_control *freezer, struct Tag *tag_y, time_t now)
 {
-	{ 400, -570 },
-	{ 410, -521 },
-	{ 420, -472 },
-	{ 430, -423 },
-	{ 440, -374 },
-	{ 450, -325 },
-	{ 460, -276 },
-	{ 470, -227 },
-	{ 480, -178 },
-	{ 490, -128 },
-	{ 500, -79 },
-	{ 510, -29 },
-	{ 520,  20 },
-	{ 530,  70 },
-	{ 540, 120 },
-	{ 550, 169 },
-	{ 560, 219 },
-	{ 570, 269 },
-	{ 580, 319 },
-	{ 590, 369 },
-	{ 600, 419 },
-	{ 610, 470 },
-	{ 620, 520 },
-	{ 630, 570 },
-	{ 640, 621 },
-	{ 650, 671 },
-	{ 660, 722 },
-	{ 670, 773 },
-	{ 680, 823 },
-	{ 690, 874 },
-	{ 700, 925 },
-	{ 710, 976 },
-	{ 720, 1027 },
-	{ 730, 1079 },
-	{ 740, 1130 },
-	{ 750, 1181 },
-	{ 760, 1232 },
-	{ 770, 1284 },
-	{ 780, 1336 },
-	{ 790, 1387 },
-	{ 800, 1439 },
-	{ 810, 1491 },
-	{ 820, 1543 },
-	{ 830, 1595 },
-	{ 840, 1647 },
-	{ 850, 1699 },
-	{ 860, 1751 },
-	{ 870, 1803 },
-	{ 880, 1856 },
-	{ 890, 1908 },
-	{ 900, 1961 },
-	{ 910, 2014 },
-	{ 920, 2066 },
-	{ 930, 2119 },
-	{ 940, 2172 },
-	{ 950, 2225 },
-	{ 960, 2278 },
-	{ 970, 2332 },
-	{ 980, 2385 },
-	{ 990, 2438 },
-	{ 1000, 2492 },
-	{ 1010, 2545 },
-	{ 1020, 2599 },
-	{ 1030, 2653 },
-	{ 0, 0}
-};
+	struct tm tm1; 
+	struct tm *ptm;
 
+	ptm = localtime_r(&now, &tm1);
+	make_rfid_event(tag_c, tag_y, reader_gps_point_at(&rfid_gps, tag_y->recent), STATUS_RFID_PRIMARY_OUT, now);
+	print_debug("%02d/%02d/%4d %02d:%02d:%02d Target Unlatched! Former Primary Tag %u\n", 
+				ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
+				ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
+				tag_y->tnum); 
+	reset_freezer_zones(freezer);
+	if (!freezer->permanently) {
+		reset_freezer_rssi_record(freezer);
+		freezer->primary_id = 0;
+	}
+}
+static bool freezer_queue_aging(struct tag_control *tag_c, struct freezer_control *freezer, time_t now,
+		void **spent, struct Tag *tag_y)
+{
+	struct Tag *tag;
+	uint32_t primary_id = 0;
+	int zone;
+	bool detached = false;
+
+	if (freezer->latched)
+		primary_id = freezer->primary_id;
+	while ((tag = (struct Tag *)tag_heap_expire(&tag_c->freezer_heap, now, freezer->tag_out_time)) != NULL) {
+		if (tag->tnum == primary_id) {
+			freezer->latched = false;
+			detached = true;
+			*tag_y = *tag;
+		} else if (freezer->latched && (tag->tnum > primary_id && tag->tnum < primary_id + freezer->divisor)) {
+			zone = (freezer->is_zone0)? (tag->tnum - primary_id) : (tag->tnum - primary_id - 1);
+			reset_freezer_zone(freezer, zone);
+		}
+		recycle_tag(&tag_c->freezer_queue, &tag_c->freezer_index, tag, spent);
+	}
+	return detached;
+}
+static int locker_queue_aging(struct tag_control *tag_c, struct lock_control *locker, time_t now, void **spent)
+{
+	struct Tag *tag;
+	int n_alarms = 0;
+	struct tm tm1; 
+	struct tm *ptm;
 
-int HighTemp_tag_processing(struct Tag *high_temp_tag)
+	ptm = localtime_r(&now, &tm1);
+	while ((tag = (struct Tag *)tag_heap_expire(&tag_c->locker_heap, now, locker->tag_out_time)) != NULL) {
+		if ((tag->status & TAG_BURSTED) && !(tag->flag & LOCK_CONTACT_A)) {
+			make_rfid_event(tag_c, tag, reader_gps_point_at(&rfid_gps, tag->recent), STATUS_RFID_LOCK_DISABLED, now);
+			print_debug("%02d/%02d/%4d %02d:%02d:%02d Lock Tag Disabled: %u\n", 
+					ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
+					ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
+					tag->tnum); 
+		} else { 
+			make_rfid_event(tag_c, tag, reader_gps_point_at(&rfid_gps, tag->recent), STATUS_RFID_LOCK_OUT, now);
+			print_debug("%02d/%02d/%4d %02d:%02d:%02d Lock Tag OUT: %u\n", 
+					ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
+					ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
+					tag->tnum); 
+			n_alarms++;
+		}
+		recycle_tag(&tag_c->locker_queue, &tag_c->locker_index, tag, spent);
+	}
+	return n_alarms;
+}
+/* The other roles report OUT for the tags they reported IN */
+static void tag_queue_aging(struct tag_control *tag_c, struct tq_head *tqueue, struct tag_index *tindex,
+		struct tag_heap *theap, int out_time, uint32_t ev_status, const char *what, time_t now, void **spent)
 {
+	struct Tag *tag;
+	struct tm tm1; 
+	struct tm *ptm;
 
-		int Temperature = high_temp_tag->temp;
-		int hex, remain;
-		int Temp_low, Temp_high, TempDiff, TempOffset, HighTemp;
-
-        // get the RAW Data from the RX Packet
-        if (( Temperature >= 400 ) && ( Temperature <= 1023 ))
-        	Temperature -= 400;                  // first entry into the table is ADC of 400
-        else
-            Temperature = 0;
-
-            hex = Temperature / 10;                             // index into the table
-            remain = Temperature % 10;
-       	    Temp_low = PT1000_Table[hex][1];		      // load the lower temperature
-       	    hex++;
-   	        Temp_high = PT1000_Table[hex][1];            // load the upper temperature
-            TempDiff = Temp_high - Temp_low;
-            TempOffset = TempDiff / 10;
-            TempOffset = TempOffset * remain;
-            HighTemp = Temp_low + TempOffset;			// Use HighTemp as the Displayed Temperature
-
-			return HighTemp;
+	ptm = localtime_r(&now, &tm1);
+	while ((tag = (struct Tag *)tag_heap_expire(theap, now, out_time)) != NULL) {
+		if (tag->status & TAG_SENIOR) {
+			make_rfid_event(tag_c, tag, reader_gps_point_at(&rfid_gps, tag->recent), ev_status, now);
+			print_debug("%02d/%02d/%4d %02d:%02d:%02d %s Tag OUT: %u\n", 
+					ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
+					ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
+					what, tag->tnum); 
+		} 
+		recycle_tag(tqueue, tindex, tag, spent);
+	}
 }
+/* Age the queues of all roles between periods, returns the number of alarms */
+int rfid_queue_aging(struct tag_control *tag_c)
+{
+	void *spent = NULL;
+	struct Tag tag_y;
+	time_t now;
+	int n_alarms = 0;
 
+	now = time(NULL);
+	if (tag_c->role & ROLE_FREEZER) {
+		pthread_mutex_lock(&tag_c->mutex_freezer);
+		if (freezer_queue_aging(tag_c, &freezer1, now, &spent, &tag_y)) {
+			pthread_mutex_unlock(&tag_c->mutex_freezer);
+			freezer_detach(tag_c, &freezer1, &tag_y, now);
+		} else
+			pthread_mutex_unlock(&tag_c->mutex_freezer);
+	}
+	if (tag_c->role & ROLE_LOCKER) {
+		pthread_mutex_lock(&tag_c->mutex_locker);
+		n_alarms += locker_queue_aging(tag_c, &locker1, now, &spent);
+		pthread_mutex_unlock(&tag_c->mutex_locker);
+	}
+	if (tag_c->role & ROLE_CARGO) {
+		pthread_mutex_lock(&tag_c->mutex_cargo);
+		tag_queue_aging(tag_c, &tag_c->cargo_queue, &tag_c->cargo_index, &tag_c->cargo_heap,
+				truck1.tag_out_time, STATUS_RFID_TAG_OUT, "Cargo", now, &spent);
+		pthread_mutex_unlock(&tag_c->mutex_cargo);
+	}
+	if (tag_c->role & ROLE_HIGHTEMP) {
+		pthread_mutex_lock(&tag_c->mutex_hightemp);
+		tag_queue_aging(tag_c, &tag_c->hightemp_queue, &tag_c->hightemp_index, &tag_c->hightemp_heap,
+				high_temp.tag_out_time, STATUS_RFID_TAG_OUT, "High Temperature", now, &spent);
+		pthread_mutex_unlock(&tag_c->mutex_hightemp);
+	}
+	if (tag_c->role & ROLE_SWITCH) {
+		pthread_mutex_lock(&tag_c->mutex_switch);
+		tag_queue_aging(tag_c, &tag_c->switch_queue, &tag_c->switch_index, &tag_c->switch_heap,
+				switch1.tag_out_time, STATUS_RFID_SWITCH_OUT, "Switch", now, &spent);
+		pthread_mutex_unlock(&tag_c->mutex_switch);
+	}
+	if (tag_c->role & ROLE_MOTION) {
+		pthread_mutex_lock(&tag_c->mutex_motion);
+		tag_queue_aging(tag_c, &tag_c->motion_queue, &tag_c->motion_index, &tag_c->motion_heap,
+				motion.tag_out_time, STATUS_RFID_TAG_OUT, "Motion", now, &spent);
+		pthread_mutex_unlock(&tag_c->mutex_motion);
+	}
+	if (tag_c->role & ROLE_SENSOR) {
+		pthread_mutex_lock(&tag_c->mutex_sensor);
+		tag_queue_aging(tag_c, &tag_c->sensor_queue, &tag_c->sensor_index, &tag_c->sensor_heap,
+				sensor.tag_out_time, STATUS_RFID_TAG_OUT, "Sensor", now, &spent);
+		pthread_mutex_unlock(&tag_c->mutex_sensor);
+	}
+	if (tag_c->role & ROLE_HUMIDITY) {
+		pthread_mutex_lock(&tag_c->mutex_humidity);
+		tag_queue_aging(tag_c, &tag_c->humidity_queue, &tag_c->humidity_index, &tag_c->humidity_heap,
+				humidity.tag_out_time, STATUS_RFID_TAG_OUT, "Humidity", now, &spent);
+		pthread_mutex_unlock(&tag_c->mutex_humidity);
+	}
+	tag_pool_release(&tag_c->pool, &spent);
+	return n_alarms;
+}
 /** 	put the handling of the high temperature queue processing freezer_queue_high into the freezer_queue_processing()
 	to deal with the detected high temperature **/
 void freezer_queue_processing(struct tag_control *tag_c, struct freezer_control *freezer)
 {
-	struct Tag *tag, *tag1;
+	struct Tag *tag;
 	struct tq_head *tqueue;
-	time_t now, past;
-	int zone;
+	void *spent = NULL;
+	time_t now;
 	struct tm tm1; 
 	struct tm *ptm;
 	struct Tag tag_y;
@@ -864,7 +933,6 @@ void freezer_queue_processing(struct tag_control *tag_c, struct freezer_control
 	if (TAILQ_EMPTY(tqueue))
 		return;
 	now = time(NULL);
-	past = now - freezer->tag_out_time;
 	ptm = localtime_r(&now, &tm1);
 	if (++freezer_beat == freezer->beacon_cycle) {
 		sample_pulse = true; 
@@ -873,78 +941,53 @@ void freezer_queue_processing(struct tag_control *tag_c, struct freezer_control
 	if (freezer->latched)
 		primary_id = freezer->primary_id;
 	pthread_mutex_lock(&tag_c->mutex_freezer);
+	if (tag_c->time_adjust)
+		tag_heap_retime(&tag_c->freezer_heap, freezer->tag_out_time, now);
+	detached = freezer_queue_aging(tag_c, freezer, now, &spent, &tag_y);
 	for (tag = tqueue->tqh_first; tag != NULL; tag = tag->link.tqe_next) {
-		if (tag->recent < past) {
-			if (tag->tnum == primary_id) {
-				freezer->latched = false;
-				detached = true;
-				tag_y = *tag;
-			} else if (freezer->latched && (tag->tnum > primary_id && tag->tnum < primary_id + freezer->divisor)) {
-				zone = (freezer->is_zone0)? (tag->tnum - primary_id) : (tag->tnum - primary_id - 1);
-				reset_freezer_zone(freezer, zone);
+		check_tag_battery(tag_c, tag, now, ptm);
+		if (tag->status & TAG_FRESH) {
+			tag->status &= ~TAG_FRESH;
+			tag->status |= TAG_SENIOR;
+			if (!freezer->latched && freezer->permanently &&
+				(tag->tnum == freezer->primary_id) && (tag->rssi >= freezer->min_rssi)) {
+				freezer->latched = true;
+				latched = true;
+				primary_id = tag->tnum;
 			}
-			tag1 = tag->link.tqe_next;
-			TAILQ_REMOVE(tqueue, tag, link);
-			memset(tag, 0, sizeof(*tag));
-			pthread_mutex_lock(&tag_c->mutex_recycle);
-			TAILQ_INSERT_TAIL(&tag_c->recycle_queue, tag, link);
-			pthread_mutex_unlock(&tag_c->mutex_recycle);
-			if (tag1 == NULL)
-				break;
-			tag = tag1;
-		} else { /*IN processing */
-			if (tag->status & TAG_FRESH) {
-				tag->status &= ~TAG_FRESH;
-				tag->status |= TAG_SENIOR;
-				if (!freezer->latched && freezer->permanently &&
-					(tag->tnum == freezer->primary_id) && (tag->rssi >= freezer->min_rssi)) {
-					freezer->latched = true;
-					latched = true;
-					primary_id = tag->tnum;
-				}
-			} else if (sample_pulse && (tag->status & TAG_SENIOR)) { /*sample pulse*/
-				if (!freezer->permanently) {
-					if (freezer->latched && tag->tnum == primary_id) {
-						mid_rssi = find_median_rssi(freezer);
-						if (mid_rssi > freezer->rssi_delta && tag->rssi < mid_rssi - freezer->rssi_delta) {
-							if (++freezer->fading_count >= freezer->fading_duration) { 
-								freezer->latched = false;
-								detached = true;
-								tag_y = *tag;
-							}
-						} else {
-							freezer->fading_count = 0;
-							sample_rssi(freezer, tag->rssi);
+		} else if (sample_pulse && (tag->status & TAG_SENIOR)) { /*sample pulse*/
+			if (!freezer->permanently) {
+				if (freezer->latched && tag->tnum == primary_id) {
+					mid_rssi = find_median_rssi(freezer);
+					if (mid_rssi > freezer->rssi_delta && tag->rssi < mid_rssi - freezer->rssi_delta) {
+						if (++freezer->fading_count >= freezer->fading_duration) { 
+							freezer->latched = false;
+							detached = true;
+							tag_y = *tag;
 						}
-					} else if (!freezer->latched && (tag->tnum % freezer->divisor == 0) &&
-															(tag->rssi >= freezer->min_rssi)) {
-						if (tag->rssi >= first_rssi) {
-							second_rssi = first_rssi; 
-							primary_candidate = tag->tnum;
-							first_rssi = tag->rssi;
-						} else if (tag->rssi >= second_rssi)
-							second_rssi = tag->rssi;
+					} else {
+						freezer->fading_count = 0;
+						sample_rssi(freezer, tag->rssi);
 					}
+				} else if (!freezer->latched && (tag->tnum % freezer->divisor == 0) &&
+														(tag->rssi >= freezer->min_rssi)) {
+					if (tag->rssi >= first_rssi) {
+						second_rssi = first_rssi; 
+						primary_candidate = tag->tnum;
+						first_rssi = tag->rssi;
+					} else if (tag->rssi >= second_rssi)
+						second_rssi = tag->rssi;
 				}
-				if (freezer->latched && tag->tnum >= primary_id && tag->tnum < primary_id + freezer->divisor)
-					sample_temperature(freezer, tag);
-			} /*sample pulse*/
-		} /*IN processing*/
+			}
+			if (freezer->latched && tag->tnum >= primary_id && tag->tnum < primary_id + freezer->divisor)
+				sample_temperature(freezer, tag);
+		} /*sample pulse*/
 	} /*for: traverse queue*/
 	pthread_mutex_unlock(&tag_c->mutex_freezer);
+	tag_pool_release(&tag_c->pool, &spent);
 
-	if (detached) {
-		make_rfid_event(tag_c, &tag_y, backtrack_gps_trail(now - tag_y.recent), STATUS_RFID_PRIMARY_OUT, now);
-		print_debug("%02d/%02d/%4d %02d:%02d:%02d Target Unlatched! Former Primary Tag %u\n", 
-					ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-					ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-					primary_id); 
-		reset_freezer_zones(freezer);
-		if (!freezer->permanently) {
-			reset_freezer_rssi_record(freezer);
-			freezer->primary_id = 0;
-		}
-	} 
+	if (detached)
+		freezer_detach(tag_c, freezer, &tag_y, now);
 	else if (!freezer->permanently && !freezer->latched && (primary_candidate != 0)) {
 		if (second_rssi == 0 || (first_rssi - second_rssi > freezer->rssi_delta)) {
 			freezer->latched = true;
@@ -954,8 +997,8 @@ void freezer_queue_processing(struct tag_control *tag_c, struct freezer_control
 		}
 	}
 	if (latched) {
-		if ((tag = search_tag(&tag_c->freezer_queue, primary_id)) != NULL) {
-			make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_PRIMARY_IN, now);
+		if ((tag = (struct Tag *)tag_index_search(&tag_c->freezer_index, primary_id)) != NULL) {
+			make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_PRIMARY_IN, now);
 			print_debug("%02d/%02d/%4d %02d:%02d:%02d Target latched! Primary Tag %u\n", 
 					ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
 					ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
@@ -967,9 +1010,10 @@ static uint32_t locker_armed_beat = 0;
 static uint32_t locker_alarm_beat = 0;
 int locker_queue_processing(struct tag_control *tag_c, struct lock_control *locker)
 {
-	struct Tag *tag, *tag1;
+	struct Tag *tag;
 	struct tq_head *tqueue;
-	time_t now, past;
+	void *spent = NULL;
+	time_t now;
 	int n_alarms = 0;
 	struct tm tm1; 
 	struct tm *ptm;
@@ -981,7 +1025,6 @@ int locker_queue_processing(struct tag_control *tag_c, struct lock_control *lock
 	if (TAILQ_EMPTY(tqueue))
 		return 0;
 	now = time(NULL);
-	past = now - locker->tag_out_time;
 
 	ptm = localtime_r(&now, &tm1);
 	if (++locker_armed_beat == locker->armed_cycle) {
@@ -994,98 +1037,78 @@ int locker_queue_processing(struct tag_control *tag_c, struct lock_control *lock
 	}
 
 	pthread_mutex_lock(&tag_c->mutex_locker);
+	if (tag_c->time_adjust)
+		tag_heap_retime(&tag_c->locker_heap, locker->tag_out_time, now - 2);
+	n_alarms = locker_queue_aging(tag_c, locker, now, &spent);
 	for (tag = tqueue->tqh_first; tag != NULL; tag = tag->link.tqe_next) {
+		check_tag_battery(tag_c, tag, now, ptm);
 		freshly = false;
-		if (tag->recent < past) {
-			if ((tag->status & TAG_BURSTED) && !(tag->flag & LOCK_CONTACT_A)) {
-				make_rfid_event(tag_c, tag, backtrack_gps_trail(now - tag->recent), STATUS_RFID_LOCK_DISABLED, now);
-				print_debug("%02d/%02d/%4d %02d:%02d:%02d Lock Tag Disabled: %u\n", 
-						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-						tag->tnum); 
-			} else { 
-				make_rfid_event(tag_c, tag, backtrack_gps_trail(now - tag->recent), STATUS_RFID_LOCK_OUT, now);
-				print_debug("%02d/%02d/%4d %02d:%02d:%02d Lock Tag OUT: %u\n", 
+		if (tag->status & TAG_FRESH) {
+			if (((tag->status & TAG_BURSTING) && (tag->flag == LOCK_FLAG_ALARM)) ||
+			(((tag->status & TAG_STATE_BURST) == TAG_BURSTED) && (tag->flag == LOCK_FLAG_ARM))) {
+				make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_LOCK_PREARMED, now);
+				print_debug("%02d/%02d/%4d %02d:%02d:%02d Lock Tag PREARMED: %u\n", 
 						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
 						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
 						tag->tnum); 
-				n_alarms++;
+				tag->status &= ~TAG_FRESH;
+				tag->status |= TAG_SENIOR;
+			} else if (locker->non_exclusive) {
+				tag->status &= ~TAG_FRESH;
+				tag->status |= TAG_SENIOR;
+				freshly = true;
 			}
-			tag1 = tag->link.tqe_next;
-			TAILQ_REMOVE(tqueue, tag, link);
-			memset(tag, 0, sizeof(*tag));
-			pthread_mutex_lock(&tag_c->mutex_recycle);
-			TAILQ_INSERT_TAIL(&tag_c->recycle_queue, tag, link);
-			pthread_mutex_unlock(&tag_c->mutex_recycle);
-			if (tag1 == NULL)
-				break;
-			tag = tag1;
-		} else { /*IN processing */
-			if (tag->status & TAG_FRESH) {
-				if (((tag->status & TAG_BURSTING) && (tag->flag == LOCK_FLAG_ALARM)) ||
-				(((tag->status & TAG_STATE_BURST) == TAG_BURSTED) && (tag->flag == LOCK_FLAG_ARM))) {
-					make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_LOCK_PREARMED, now);
+		}
+		if (tag->status & TAG_SENIOR) { /*senior*/
+			if (tag->status & TAG_BURSTED) {
+				if (((tag->status & TAG_BURSTING) && (tag->flag == LOCK_FLAG_ARM)) ||
+							(!(tag->status & TAG_BURSTING) && (tag->flag == LOCK_FLAG_ALARM))) {
+					make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_LOCK_ALARM, now);
+					print_debug("%02d/%02d/%4d %02d:%02d:%02d Lock Tag ALARM: %u\n", 
+							ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
+							ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
+							tag->tnum); 
+					n_alarms++;
+				} else if (((tag->status & TAG_BURSTING) && (tag->flag == LOCK_FLAG_ALARM)) ||
+							(!(tag->status & TAG_BURSTING) && (tag->flag == LOCK_FLAG_ARM))) {
+					make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_LOCK_PREARMED, now);
 					print_debug("%02d/%02d/%4d %02d:%02d:%02d Lock Tag PREARMED: %u\n", 
 							ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
 							ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
 							tag->tnum); 
-					tag->status &= ~TAG_FRESH;
-					tag->status |= TAG_SENIOR;
-				} else if (locker->non_exclusive) {
-					tag->status &= ~TAG_FRESH;
-					tag->status |= TAG_SENIOR;
-					freshly = true;
 				}
-			}
-			if (tag->status & TAG_SENIOR) { /*senior*/
-				if (tag->status & TAG_BURSTED) {
-					if (((tag->status & TAG_BURSTING) && (tag->flag == LOCK_FLAG_ARM)) ||
-								(!(tag->status & TAG_BURSTING) && (tag->flag == LOCK_FLAG_ALARM))) {
-						make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_LOCK_ALARM, now);
-						print_debug("%02d/%02d/%4d %02d:%02d:%02d Lock Tag ALARM: %u\n", 
-								ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-								ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-								tag->tnum); 
-						n_alarms++;
-					} else if (((tag->status & TAG_BURSTING) && (tag->flag == LOCK_FLAG_ALARM)) ||
-								(!(tag->status & TAG_BURSTING) && (tag->flag == LOCK_FLAG_ARM))) {
-						make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_LOCK_PREARMED, now);
-						print_debug("%02d/%02d/%4d %02d:%02d:%02d Lock Tag PREARMED: %u\n", 
-								ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-								ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-								tag->tnum); 
-					}
-				} else { /*non bursting*/
-					if ((tag->flag == LOCK_FLAG_ARM) && (armed_pulse | freshly)) {
-						make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_LOCK_ARMED, now);
-						print_debug("%02d/%02d/%4d %02d:%02d:%02d Lock Tag ARMED: %u\n", 
-								ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-								ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-								tag->tnum); 
-					} else if ((tag->flag == LOCK_FLAG_ALARM) && (alarm_pulse | freshly)) {
-						make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_LOCK_ALARM, now);
-						print_debug("%02d/%02d/%4d %02d:%02d:%02d Lock Tag ALARM: %u\n", 
-								ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-								ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-								tag->tnum); 
-						n_alarms++;
-					} 
-				} /*non bursting*/
-			} /*senior*/
-			if ((tag->status & TAG_BURSTED) && (tag->flag & LOCK_CONTACT_A))
-				tag->status &= ~TAG_BURSTED;
-		} /*IN processing*/
-	} /*for: traverse queue*/
+			} else { /*non bursting*/
+				if ((tag->flag == LOCK_FLAG_ARM) && (armed_pulse | freshly)) {
+					make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_LOCK_ARMED, now);
+					print_debug("%02d/%02d/%4d %02d:%02d:%02d Lock Tag ARMED: %u\n", 
+							ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
+							ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
+							tag->tnum); 
+				} else if ((tag->flag == LOCK_FLAG_ALARM) && (alarm_pulse | freshly)) {
+					make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_LOCK_ALARM, now);
+					print_debug("%02d/%02d/%4d %02d:%02d:%02d Lock Tag ALARM: %u\n", 
+							ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
+							ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
+							tag->tnum); 
+					n_alarms++;
+				} 
+			} /*non bursting*/
+		} /*senior*/
+		if ((tag->status & TAG_BURSTED) && (tag->flag & LOCK_CONTACT_A))
+			tag->status &= ~TAG_BURSTED;
+			} /*for: traverse queue*/
 	pthread_mutex_unlock(&tag_c->mutex_locker);
+	tag_pool_release(&tag_c->pool, &spent);
 	return n_alarms;
 }
 static uint32_t cargo_report_beat = 0;
 static uint32_t cargo_moving_beat = 0;
 void cargo_queue_processing(struct tag_control *tag_c, struct cargo_control *truck)
 {
-	struct Tag *tag, *tag1;
+	struct Tag *tag;
 	struct tq_head *tqueue;
-	time_t now, past;
+	void *spent = NULL;
+	time_t now;
 	struct tm tm1; 
 	struct tm *ptm;
 	bool report_pulse = false;
@@ -1095,10 +1118,9 @@ void cargo_queue_processing(struct tag_control *tag_c, struct cargo_control *tru
 	if (TAILQ_EMPTY(tqueue))
 		return;
 	now = time(NULL);
-	past = now - truck->tag_out_time;
 	ptm = localtime_r(&now, &tm1);
 	if (truck->sample_mode == CARGO_SAMPLE_IN_MOTION) {
-		if (am_i_moving(truck->min_speed)) {
+		if (reader_gps_moving(&rfid_gps, truck->min_speed)) {
 			if (++cargo_moving_beat < truck->motion_duration)
 				ready_to_sample = false;
 		} else {
@@ -1114,27 +1136,15 @@ void cargo_queue_processing(struct tag_control *tag_c, struct cargo_control *tru
 	}
 
 	pthread_mutex_lock(&tag_c->mutex_cargo);
+	if (tag_c->time_adjust)
+		tag_heap_retime(&tag_c->cargo_heap, truck->tag_out_time, now - 2);
+	tag_queue_aging(tag_c, tqueue, &tag_c->cargo_index, &tag_c->cargo_heap,
+			truck->tag_out_time, STATUS_RFID_TAG_OUT, "Cargo", now, &spent);
 	for (tag = tqueue->tqh_first; tag != NULL; tag = tag->link.tqe_next) {
-		if (tag->recent < past) {
-			if (tag->status & TAG_SENIOR) {
-				make_rfid_event(tag_c, tag, backtrack_gps_trail(now - tag->recent), STATUS_RFID_TAG_OUT, now);
-				print_debug("%02d/%02d/%4d %02d:%02d:%02d Cargo Tag OUT: %u\n", 
-						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-						tag->tnum); 
-			} 
-			tag1 = tag->link.tqe_next;
-			TAILQ_REMOVE(tqueue, tag, link);
-			memset(tag, 0, sizeof(*tag));
-			pthread_mutex_lock(&tag_c->mutex_recycle);
-			TAILQ_INSERT_TAIL(&tag_c->recycle_queue, tag, link);
-			pthread_mutex_unlock(&tag_c->mutex_recycle);
-			if (tag1 == NULL)
-				break;
-			tag = tag1;
-		} else if (ready_to_sample) { /*ready_to_sample*/
+		check_tag_battery(tag_c, tag, now, ptm);
+		if (ready_to_sample) { /*ready_to_sample*/
 			if ((tag->status & TAG_FRESH) && (tag->rssi >= truck->min_rssi)) {
-				make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_TAG_IN, now);
+				make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_TAG_IN, now);
 				print_debug("%02d/%02d/%4d %02d:%02d:%02d Cargo Tag IN: %u\n", 
 						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
 						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
@@ -1142,7 +1152,7 @@ void cargo_queue_processing(struct tag_control *tag_c, struct cargo_control *tru
 				tag->status &= ~TAG_FRESH;
 				tag->status |= TAG_SENIOR;
 			} else if (report_pulse && (tag->status & TAG_SENIOR)) { /*senior*/
-				make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_TAG_IN, now);
+				make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_TAG_IN, now);
 				print_debug("%02d/%02d/%4d %02d:%02d:%02d Cargo Tag IN: %u\n", 
 						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
 						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
@@ -1151,14 +1161,16 @@ void cargo_queue_processing(struct tag_control *tag_c, struct cargo_control *tru
 		} /*ready_to_sample*/
 	} /*for: traverse queue*/
 	pthread_mutex_unlock(&tag_c->mutex_cargo);
+	tag_pool_release(&tag_c->pool, &spent);
 }
 
 static uint32_t hightemp_beat = 0;
 void hightemp_queue_processing(struct tag_control *tag_c, struct high_temp_control *high_temp)
 {
-	struct Tag *tag, *tag1;
+	struct Tag *tag;
 	struct tq_head *tqueue;
-	time_t now, past;
+	void *spent = NULL;
+	time_t now;
 	struct tm tm1; 
 	struct tm *ptm;
 	bool ready_to_sample = false;
@@ -1167,8 +1179,6 @@ void hightemp_queue_processing(struct tag_control *tag_c, struct high_temp_contr
 	if (TAILQ_EMPTY(tqueue))
 		return;
 	now = time(NULL);
-	past = now - high_temp->tag_out_time;
-//	past = now - high_temp->report_cycle;
 
 	ptm = localtime_r(&now, &tm1);
 
@@ -1176,30 +1186,16 @@ void hightemp_queue_processing(struct tag_control *tag_c, struct high_temp_contr
 		ready_to_sample = true;
 	}
 	pthread_mutex_lock(&tag_c->mutex_hightemp);
+	if (tag_c->time_adjust)
+		tag_heap_retime(&tag_c->hightemp_heap, high_temp->tag_out_time, now - 2);
+	tag_queue_aging(tag_c, tqueue, &tag_c->hightemp_index, &tag_c->hightemp_heap,
+			high_temp->tag_out_time, STATUS_RFID_TAG_OUT, "High Temperature", now, &spent);
 
 	for (tag = tqueue->tqh_first; tag != NULL; tag = tag->link.tqe_next) {
 //		now = time(NULL);
-		if (tag->recent < past) {
-			if (tag->status & TAG_SENIOR) {
-				make_rfid_event(tag_c, tag, backtrack_gps_trail(now - tag->recent), STATUS_RFID_TAG_OUT, now);
-				print_debug("%02d/%02d/%4d %02d:%02d:%02d High Temperature Tag OUT: %u\n", 
-						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-						tag->tnum); 
-			} 
-			tag1 = tag->link.tqe_next;
-			TAILQ_REMOVE(tqueue, tag, link);
-			memset(tag, 0, sizeof(*tag));
-			pthread_mutex_lock(&tag_c->mutex_recycle);
-			TAILQ_INSERT_TAIL(&tag_c->recycle_queue, tag, link);
-			pthread_mutex_unlock(&tag_c->mutex_recycle);
-			if (tag1 == NULL)
-				break;
-			tag = tag1;
-//		} else if (ready_to_sample) { /*ready_to_sample*/
-//			if ((tag->status & TAG_FRESH) && (tag->rssi >= truck->min_rssi)) {			
-		} else if ((tag->status & TAG_FRESH)) {
-				make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_TAG_IN, now);
+		check_tag_battery(tag_c, tag, now, ptm);
+		if ((tag->status & TAG_FRESH)) {
+				make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_TAG_IN, now);
 				print_debug("%02d/%02d/%4d %02d:%02d:%02d High Temperature Tag IN: %u\n", 
 						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
 						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
@@ -1207,7 +1203,7 @@ void hightemp_queue_processing(struct tag_control *tag_c, struct high_temp_contr
 				tag->status &= ~TAG_FRESH;
 				tag->status |= TAG_SENIOR;
 		} else if (ready_to_sample && (tag->status & TAG_SENIOR)) { /*senior*/
-				make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_TAG_IN, now);
+				make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_TAG_IN, now);
 				print_debug("%02d/%02d/%4d %02d:%02d:%02d High Temperature Tag IN: %u\n", 
 						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
 						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
@@ -1216,6 +1212,7 @@ void hightemp_queue_processing(struct tag_control *tag_c, struct high_temp_contr
 //		} /*ready_to_sample*/
 	}
 	pthread_mutex_unlock(&tag_c->mutex_hightemp);	
+	tag_pool_release(&tag_c->pool, &spent);
 	if (ready_to_sample) 
 		hightemp_beat = 0;
 }
@@ -1224,10 +1221,10 @@ static uint32_t switch_open_beat = 0;
 static uint32_t switch_closed_beat = 0;
 void switch_queue_processing(struct tag_control *tag_c, struct switch_control *pswitch)
 {
-	struct Tag *tag, *tag1;
+	struct Tag *tag;
 	struct tq_head *tqueue;
-	int n_alarms = 0;
-	time_t now, past;
+	void *spent = NULL;
+	time_t now;
 	struct tm tm1; 
 	struct tm *ptm;
 	bool open_pulse = false;
@@ -1237,7 +1234,6 @@ void switch_queue_processing(struct tag_control *tag_c, struct switch_control *p
 	if (TAILQ_EMPTY(tqueue))
 		return;
 	now = time(NULL);
-	past = now - pswitch->tag_out_time;
 	ptm = localtime_r(&now, &tm1);
 	if (++switch_closed_beat == pswitch->closed_report_cycle) {
 		closed_pulse = true; 
@@ -1248,75 +1244,62 @@ void switch_queue_processing(struct tag_control *tag_c, struct switch_control *p
 		switch_open_beat = 0;
 	}
 	pthread_mutex_lock(&tag_c->mutex_switch);
+	if (tag_c->time_adjust)
+		tag_heap_retime(&tag_c->switch_heap, pswitch->tag_out_time, now - 2);
+	tag_queue_aging(tag_c, tqueue, &tag_c->switch_index, &tag_c->switch_heap,
+			pswitch->tag_out_time, STATUS_RFID_SWITCH_OUT, "Switch", now, &spent);
 	for (tag = tqueue->tqh_first; tag != NULL; tag = tag->link.tqe_next) {
-		if (tag->recent < past) {
-			if (tag->status & TAG_SENIOR) {
-				make_rfid_event(tag_c, tag, backtrack_gps_trail(now - tag->recent), STATUS_RFID_SWITCH_OUT, now);
-				print_debug("%02d/%02d/%4d %02d:%02d:%02d Switch Tag OUT: %u\n", 
+		check_tag_battery(tag_c, tag, now, ptm);
+		if (tag->status & TAG_FRESH) {
+			if (tag->flag != 0) {
+				make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_SWITCH_CLOSED, now);
+				print_debug("%02d/%02d/%4d %02d:%02d:%02d Switch Closed: %u\n", 
 						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
 						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
 						tag->tnum); 
-				++n_alarms;
-			} 
-			tag1 = tag->link.tqe_next;
-			TAILQ_REMOVE(tqueue, tag, link);
-			memset(tag, 0, sizeof(*tag));
-			pthread_mutex_lock(&tag_c->mutex_recycle);
-			TAILQ_INSERT_TAIL(&tag_c->recycle_queue, tag, link);
-			pthread_mutex_unlock(&tag_c->mutex_recycle);
-			if (tag1 == NULL)
-				break;
-			tag = tag1;
-		} else {
-			if (tag->status & TAG_FRESH) {
-				if (tag->flag != 0) {
-					make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_SWITCH_CLOSED, now);
-					print_debug("%02d/%02d/%4d %02d:%02d:%02d Switch Closed: %u\n", 
-							ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-							ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-							tag->tnum); 
-					tag->status |= TAG_SWITCH_CLOSED;
-				} else {
-					make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_SWITCH_OPEN, now);
-					print_debug("%02d/%02d/%4d %02d:%02d:%02d Switch Open: %u\n", 
-							ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-							ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-							tag->tnum); 
-					tag->status &= ~TAG_SWITCH_CLOSED;
-				}
-				tag->status &= ~TAG_FRESH;
-				tag->status |= TAG_SENIOR;
-			/*fresh*/
-			} else if (tag->status & TAG_SENIOR) {
-				if ((tag->flag != 0) && (!(tag->status & TAG_SWITCH_CLOSED) || closed_pulse)) {
-					make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_SWITCH_CLOSED, now);
-					print_debug("%02d/%02d/%4d %02d:%02d:%02d Switch Closed: %u\n", 
-							ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-							ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-							tag->tnum); 
-					tag->status |= TAG_SWITCH_CLOSED;
-				} else if ((tag->flag == 0) && ((tag->status & TAG_SWITCH_CLOSED) || open_pulse)) {
-					make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_SWITCH_OPEN, now);
-					print_debug("%02d/%02d/%4d %02d:%02d:%02d Switch Open: %u\n", 
-							ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-							ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-							tag->tnum); 
-					tag->status &= ~TAG_SWITCH_CLOSED;
-				}
-			} /*senior*/
-		}
+				tag->status |= TAG_SWITCH_CLOSED;
+			} else {
+				make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_SWITCH_OPEN, now);
+				print_debug("%02d/%02d/%4d %02d:%02d:%02d Switch Open: %u\n", 
+						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
+						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
+						tag->tnum); 
+				tag->status &= ~TAG_SWITCH_CLOSED;
+			}
+			tag->status &= ~TAG_FRESH;
+			tag->status |= TAG_SENIOR;
+		/*fresh*/
+		} else if (tag->status & TAG_SENIOR) {
+			if ((tag->flag != 0) && (!(tag->status & TAG_SWITCH_CLOSED) || closed_pulse)) {
+				make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_SWITCH_CLOSED, now);
+				print_debug("%02d/%02d/%4d %02d:%02d:%02d Switch Closed: %u\n", 
+						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
+						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
+						tag->tnum); 
+				tag->status |= TAG_SWITCH_CLOSED;
+			} else if ((tag->flag == 0) && ((tag->status & TAG_SWITCH_CLOSED) || open_pulse)) {
+				make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_SWITCH_OPEN, now);
+				print_debug("%02d/%02d/%4d %02d:%02d:%02d Switch Open: %u\n", 
+						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
+						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
+						tag->tnum); 
+				tag->status &= ~TAG_SWITCH_CLOSED;
+			}
+		} /*senior*/
 	} /*for: traverse queue*/
 	pthread_mutex_unlock(&tag_c->mutex_switch);
+	tag_pool_release(&tag_c->pool, &spent);
 }
 
 static uint32_t motion_open_beat = 0;
 //static uint32_t motion_closed_beat = 0;
 static int motion_queue_processing(struct tag_control *tag_c, struct motion_control *pmotion)
 {
-	struct Tag *tag, *tag1;
+	struct Tag *tag;
 	struct tq_head *tqueue;
+	void *spent = NULL;
 	int n_alarms = 0;
-	time_t now, past;
+	time_t now;
 	struct tm tm1; 
 	struct tm *ptm;
 	bool alarm_pulse = false;
@@ -1326,7 +1309,6 @@ static int motion_queue_processing(struct tag_control *tag_c, struct motion_cont
 	if (TAILQ_EMPTY(tqueue))
 		return 0;
 	now = time(NULL);
-	past = now - pmotion->tag_out_time;
 	ptm = localtime_r(&now, &tm1);
 /*	if (++motion_closed_beat == pmotion->closed_report_cycle) {
 		closed_pulse = true; 
@@ -1337,72 +1319,61 @@ static int motion_queue_processing(struct tag_control *tag_c, struct motion_cont
 		alarm_pulse = true; 
 		motion_open_beat = 0;
 	}
-	pthread_mutex_lock(&tag_c->mutex_switch);
+	pthread_mutex_lock(&tag_c->mutex_motion);
+	if (tag_c->time_adjust)
+		tag_heap_retime(&tag_c->motion_heap, pmotion->tag_out_time, now - 2);
+	tag_queue_aging(tag_c, tqueue, &tag_c->motion_index, &tag_c->motion_heap,
+			pmotion->tag_out_time, STATUS_RFID_TAG_OUT, "Motion", now, &spent);
 	for (tag = tqueue->tqh_first; tag != NULL; tag = tag->link.tqe_next) {
-		if (tag->recent < past) {
-			if (tag->status & TAG_SENIOR) {
-				make_rfid_event(tag_c, tag, backtrack_gps_trail(now - tag->recent), STATUS_RFID_TAG_OUT, now);
-				print_debug("%02d/%02d/%4d %02d:%02d:%02d Motion Tag OUT: %u\n", 
+		check_tag_battery(tag_c, tag, now, ptm);
+		if (tag->status & TAG_FRESH) {
+			if (tag->flag == 0x20) {
+				make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_MOTION_OPEN, now);
+//					make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_SWITCH_OPEN, now);
+				print_debug("%02d/%02d/%4d %02d:%02d:%02d Motion Open: %u\n", 
 						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
 						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
 						tag->tnum); 
-			} 
-			tag1 = tag->link.tqe_next;
-			TAILQ_REMOVE(tqueue, tag, link);
-			memset(tag, 0, sizeof(*tag));
-			pthread_mutex_lock(&tag_c->mutex_recycle);
-			TAILQ_INSERT_TAIL(&tag_c->recycle_queue, tag, link);
-			pthread_mutex_unlock(&tag_c->mutex_recycle);
-			if (tag1 == NULL)
-				break;
-			tag = tag1;
-		} else {
-			if (tag->status & TAG_FRESH) {
-				if (tag->flag == 0x20) {
-					make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_MOTION_OPEN, now);
-//					make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_SWITCH_OPEN, now);
-					print_debug("%02d/%02d/%4d %02d:%02d:%02d Motion Open: %u\n", 
-							ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-							ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-							tag->tnum); 
-					tag->status |= TAG_MOTION_OPEN;
-					n_alarms++;
-				} else {
-					make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_MOTION_CLOSED, now);
-//					make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_SWITCH_CLOSED, now);
-					print_debug("%02d/%02d/%4d %02d:%02d:%02d Motion Closed: %u\n", 
-							ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-							ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-							tag->tnum); 
-					tag->status &= ~TAG_MOTION_OPEN;
-				}
-				tag->status &= ~TAG_FRESH;
-				tag->status |= TAG_SENIOR;
-			/*fresh*/
-			} else if (tag->status & TAG_SENIOR) {
-				if ((tag->flag == 0) && (tag->status & TAG_MOTION_OPEN) ) {
-					make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_MOTION_CLOSED, now);
-//					make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_SWITCH_CLOSED, now);
-					print_debug("%02d/%02d/%4d %02d:%02d:%02d Motion Closed: %u\n", 
-							ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-							ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-							tag->tnum); 
-					tag->status &= ~TAG_MOTION_OPEN;
-					n_alarms++;
-				} else if (tag->flag == 0x20 && (!(tag->status & TAG_MOTION_OPEN) || alarm_pulse)) {
-					make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_MOTION_OPEN, now);
-//					make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_SWITCH_OPEN, now);
-					print_debug("%02d/%02d/%4d %02d:%02d:%02d Motion Open: %u\n", 
-							ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-							ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-							tag->tnum); 
-					tag->status |= TAG_MOTION_OPEN;
-					n_alarms++;
-				}
-			} /*senior*/
-		}
+				tag->status |= TAG_MOTION_OPEN;
+				gpsNoteMotionActivity();
+				n_alarms++;
+			} else {
+				make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_MOTION_CLOSED, now);
+//					make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_SWITCH_CLOSED, now);
+				print_debug("%02d/%02d/%4d %02d:%02d:%02d Motion Closed: %u\n", 
+						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
+						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
+						tag->tnum); 
+				tag->status &= ~TAG_MOTION_OPEN;
+			}
+			tag->status &= ~TAG_FRESH;
+			tag->status |= TAG_SENIOR;
+		/*fresh*/
+		} else if (tag->status & TAG_SENIOR) {
+			if ((tag->flag == 0) && (tag->status & TAG_MOTION_OPEN) ) {
+				make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_MOTION_CLOSED, now);
+//					make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_SWITCH_CLOSED, now);
+				print_debug("%02d/%02d/%4d %02d:%02d:%02d Motion Closed: %u\n", 
+						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
+						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
+						tag->tnum); 
+				tag->status &= ~TAG_MOTION_OPEN;
+				n_alarms++;
+			} else if (tag->flag == 0x20 && (!(tag->status & TAG_MOTION_OPEN) || alarm_pulse)) {
+				make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_MOTION_OPEN, now);
+//					make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_SWITCH_OPEN, now);
+				print_debug("%02d/%02d/%4d %02d:%02d:%02d Motion Open: %u\n", 
+						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
+						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
+						tag->tnum); 
+				tag->status |= TAG_MOTION_OPEN;
+				gpsNoteMotionActivity();
+				n_alarms++;
+			}
+		} /*senior*/
 	} /*for: traverse queue*/
-	pthread_mutex_unlock(&tag_c->mutex_switch);
+	pthread_mutex_unlock(&tag_c->mutex_motion);
+	tag_pool_release(&tag_c->pool, &spent);
 	return n_alarms;
 }
 
@@ -1410,10 +1381,11 @@ static uint32_t sensor_rpt_beat = 0;
 //static uint32_t motion_closed_beat = 0;
 static int sensor_queue_processing(struct tag_control *tag_c, struct sensor_control *psensor)
 {
-	struct Tag *tag, *tag1;
+	struct Tag *tag;
 	struct tq_head *tqueue;
+	void *spent = NULL;
 	int n_alarms = 0;
-	time_t now, past;
+	time_t now;
 	struct tm tm1; 
 	struct tm *ptm;
 	bool rpt_ready = false;
@@ -1424,7 +1396,6 @@ static int sensor_queue_processing(struct tag_control *tag_c, struct sensor_cont
 	if (TAILQ_EMPTY(tqueue))
 		return 0;
 	now = time(NULL);
-	past = now - psensor->tag_out_time;
 	ptm = localtime_r(&now, &tm1);
 /*	if (++motion_closed_beat == pmotion->closed_report_cycle) {
 		closed_pulse = true; 
@@ -1436,205 +1407,80 @@ static int sensor_queue_processing(struct tag_control *tag_c, struct sensor_cont
 		sensor_rpt_beat = 0;
 	}
 	pthread_mutex_lock(&tag_c->mutex_sensor);
+	if (tag_c->time_adjust)
+		tag_heap_retime(&tag_c->sensor_heap, psensor->tag_out_time, now - 2);
+	tag_queue_aging(tag_c, tqueue, &tag_c->sensor_index, &tag_c->sensor_heap,
+			psensor->tag_out_time, STATUS_RFID_TAG_OUT, "Sensor", now, &spent);
 	for (tag = tqueue->tqh_first; tag != NULL; tag = tag->link.tqe_next) {
-		if (tag->recent < past) {
-			if (tag->status & TAG_SENIOR) {
-				make_rfid_event(tag_c, tag, backtrack_gps_trail(now - tag->recent), STATUS_RFID_TAG_OUT, now);
-				print_debug("%02d/%02d/%4d %02d:%02d:%02d Sensor Tag OUT: %u\n", 
+		check_tag_battery(tag_c, tag, now, ptm);
+		if (tag->status & TAG_FRESH) {
+			if (tag->flag) {
+				make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_SENSOR_STATUS, now);
+//					make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_SWITCH_OPEN, now);
+				print_debug("%02d/%02d/%4d %02d:%02d:%02d Sensor: %u with flag %x\n", 
 						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
 						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-						tag->tnum); 
-			} 
-			tag1 = tag->link.tqe_next;
-			TAILQ_REMOVE(tqueue, tag, link);
-			memset(tag, 0, sizeof(*tag));
-			pthread_mutex_lock(&tag_c->mutex_recycle);
-			TAILQ_INSERT_TAIL(&tag_c->recycle_queue, tag, link);
-			pthread_mutex_unlock(&tag_c->mutex_recycle);
-			if (tag1 == NULL)
-				break;
-			tag = tag1;
-		} else {
-			if (tag->status & TAG_FRESH) {
-				if (tag->flag) {
-					make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_SENSOR_STATUS, now);
-//					make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_SWITCH_OPEN, now);
-					print_debug("%02d/%02d/%4d %02d:%02d:%02d Sensor: %u with flag %x\n", 
-							ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-							ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-							tag->tnum, tag->flag); 
-					pre_flag = tag->flag;
-				}
-				tag->status &= ~TAG_FRESH;
-				tag->status |= TAG_SENIOR;
-			} else if (tag->status & TAG_SENIOR) {
-				/* if the tag->flag being changed from the previous value */
-				/* report the new value of the flag immediately			 */
-				if (tag->flag != pre_flag){
-					make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_SENSOR_STATUS, now);
-//					make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_SWITCH_CLOSED, now);
-					print_debug("%02d/%02d/%4d %02d:%02d:%02d Sensor: %u with flag %x\n", 
-							ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-							ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-							tag->tnum, tag->flag); 
-					n_alarms++;
-					pre_flag = tag->flag;
-				}  else if (rpt_ready) { 
-				/* if the tag->flag are the same, 				 */
-				/* just report the event after the certain interval */
-					make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_SENSOR_STATUS, now);
-//					make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_SWITCH_CLOSED, now);
-					print_debug("%02d/%02d/%4d %02d:%02d:%02d Sensor: %u with flag %x\n", 
-							ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-							ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-							tag->tnum, tag->flag); 
-				}
-			} 
-		}
+						tag->tnum, tag->flag); 
+				pre_flag = tag->flag;
+			}
+			tag->status &= ~TAG_FRESH;
+			tag->status |= TAG_SENIOR;
+		} else if (tag->status & TAG_SENIOR) {
+			/* if the tag->flag being changed from the previous value */
+			/* report the new value of the flag immediately			 */
+			if (tag->flag != pre_flag){
+				make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_SENSOR_STATUS, now);
+//					make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_SWITCH_CLOSED, now);
+				print_debug("%02d/%02d/%4d %02d:%02d:%02d Sensor: %u with flag %x\n", 
+						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
+						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
+						tag->tnum, tag->flag); 
+				n_alarms++;
+				pre_flag = tag->flag;
+			}  else if (rpt_ready) { 
+			/* if the tag->flag are the same, 				 */
+			/* just report the event after the certain interval */
+				make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_SENSOR_STATUS, now);
+//					make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_SWITCH_CLOSED, now);
+				print_debug("%02d/%02d/%4d %02d:%02d:%02d Sensor: %u with flag %x\n", 
+						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
+						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
+						tag->tnum, tag->flag); 
+			}
+		} 
 	} /*for: traverse queue*/
 	pthread_mutex_unlock(&tag_c->mutex_sensor);
+	tag_pool_release(&tag_c->pool, &spent);
 	if (rpt_ready) 
 		rpt_ready = false;
 	return n_alarms;
 }
 
 static uint32_t battery_check_beat = 0;
-void battery_time_checking(struct tag_control *tag_c)
+/* Whether tag batteries are checked this period, always after a clock
+ * adjustment as before.  The checks are made by the queue processing. */
+bool battery_check_due(struct tag_control *tag_c)
 {
-	struct Tag *tag;
-	struct tq_head *tqueue;
-	time_t now;
-	struct tm tm1; 
-	struct tm *ptm;
-
-	if (rfid_queue_time_adjust)
-		goto start_checking;
+	if (tag_c->time_adjust)
+		return true;
 	if (tag_c->battery_maximum == 255)
-		return;
-	if (++battery_check_beat == tag_c->battery_alarm_cycle)
+		return false;
+	if (++battery_check_beat == tag_c->battery_alarm_cycle) {
 		battery_check_beat = 0;
-	else
-		return;
-start_checking:
-	now = time(NULL);
-	ptm = localtime_r(&now, &tm1);
-	tqueue = &tag_c->freezer_queue;
-	if (!TAILQ_EMPTY(tqueue)) {
-		pthread_mutex_lock(&tag_c->mutex_freezer);
-		for (tag = tqueue->tqh_first; tag != NULL; tag = tag->link.tqe_next) {
-			if (tag->battery > tag_c->battery_maximum) {
-				make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_BATTERY_ALERT, now);
-				print_debug("%02d/%02d/%4d %02d:%02d:%02d  Battery Alert: %u\n", 
-						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-						tag->tnum); 
-			}
-			if (rfid_queue_time_adjust)
-				tag->recent = now;
-		}
-		pthread_mutex_unlock(&tag_c->mutex_freezer);
+		return true;
 	}
-	tqueue = &tag_c->locker_queue;
-	if (!TAILQ_EMPTY(tqueue)) {
-		pthread_mutex_lock(&tag_c->mutex_locker);
-		for (tag = tqueue->tqh_first; tag != NULL; tag = tag->link.tqe_next) {
-			if (tag->battery > tag_c->battery_maximum) {
-				make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_BATTERY_ALERT, now);
-				print_debug("%02d/%02d/%4d %02d:%02d:%02d  Battery Alert: %u\n", 
-						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-						tag->tnum); 
-			}
-			if (rfid_queue_time_adjust)
-				tag->recent = now - 2;
-		}
-		pthread_mutex_unlock(&tag_c->mutex_locker);
-	}
-	tqueue = &tag_c->cargo_queue;
-	if (!TAILQ_EMPTY(tqueue)) {
-		pthread_mutex_lock(&tag_c->mutex_cargo);
-		for (tag = tqueue->tqh_first; tag != NULL; tag = tag->link.tqe_next) {
-			if (tag->battery > tag_c->battery_maximum) {
-				make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_BATTERY_ALERT, now);
-				print_debug("%02d/%02d/%4d %02d:%02d:%02d  Battery Alert: %u\n", 
-						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-						tag->tnum); 
-			}
-			if (rfid_queue_time_adjust)
-				tag->recent = now - 2;
-		}
-		pthread_mutex_unlock(&tag_c->mutex_cargo);
-	}
-	tqueue = &tag_c->switch_queue;
-	if (!TAILQ_EMPTY(tqueue)) {
-		pthread_mutex_lock(&tag_c->mutex_switch);
-		for (tag = tqueue->tqh_first; tag != NULL; tag = tag->link.tqe_next) {
-			if (tag->battery > tag_c->battery_maximum) {
-				make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_BATTERY_ALERT, now);
-				print_debug("%02d/%02d/%4d %02d:%02d:%02d  Battery Alert: %u\n", 
-						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-						tag->tnum); 
-			}
-			if (rfid_queue_time_adjust)
-				tag->recent = now - 2;
-		}
-		pthread_mutex_unlock(&tag_c->mutex_switch);
-	}
-
-	tqueue = &tag_c->hightemp_queue;
-	if (!TAILQ_EMPTY(tqueue)) {
-		pthread_mutex_lock(&tag_c->mutex_hightemp);
-		for (tag = tqueue->tqh_first; tag != NULL; tag = tag->link.tqe_next) {
-			if (tag->battery > tag_c->battery_maximum) {
-				make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_BATTERY_ALERT, now);
-				print_debug("%02d/%02d/%4d %02d:%02d:%02d  Battery Alert: %u\n", 
-						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-						tag->tnum); 
-			}
-			if (rfid_queue_time_adjust)
-				tag->recent = now - 2;
-		}
-		pthread_mutex_unlock(&tag_c->mutex_hightemp);
-	}
-
-	tqueue = &tag_c->motion_queue;
-	if (!TAILQ_EMPTY(tqueue)) {
-		pthread_mutex_lock(&tag_c->mutex_motion);
-		for (tag = tqueue->tqh_first; tag != NULL; tag = tag->link.tqe_next) {
-			if (tag->battery > tag_c->battery_maximum) {
-				make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_BATTERY_ALERT, now);
-				print_debug("%02d/%02d/%4d %02d:%02d:%02d  Battery Alert: %u\n", 
-						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-						tag->tnum); 
-			}
-			if (rfid_queue_time_adjust)
-				tag->recent = now - 2;
-		}
-		pthread_mutex_unlock(&tag_c->mutex_motion);
-	}
-	
-	tqueue = &tag_c->sensor_queue;
-	if (!TAILQ_EMPTY(tqueue)) {
-		pthread_mutex_lock(&tag_c->mutex_sensor);
-		for (tag = tqueue->tqh_first; tag != NULL; tag = tag->link.tqe_next) {
-			if (tag->battery > tag_c->battery_maximum) {
-				make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_BATTERY_ALERT, now);
-				print_debug("%02d/%02d/%4d %02d:%02d:%02d  Battery Alert: %u\n", 
-						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-						tag->tnum); 
-			}
-			if (rfid_queue_time_adjust)
-				tag->recent = now - 2;
-		}
-		pthread_mutex_unlock(&tag_c->mutex_sensor);
+	return false;
+}
+/* Caller holds the role mutex of the tag */
+void check_tag_battery(struct tag_control *tag_c, struct Tag *tag, time_t now, struct tm *ptm)
+{
+	if (tag_c->battery_pulse && tag->battery > tag_c->battery_maximum) {
+		make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_BATTERY_ALERT, now);
+		print_debug("%02d/%02d/%4d %02d:%02d:%02d  Battery Alert: %u\n", 
+				ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
+				ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
+				tag->tnum); 
 	}
-
-	rfid_queue_time_adjust = false;
 }
 /*int print_raw(unsigned char *cbuf, int len)
 {
@@ -1654,13 +1500,10 @@ static int freezer_alarm_beat = 0;
 static uint32_t freezer_alarm_flag = 0;
 int freezer_processing(struct tag_control *tag_c, struct freezer_control *freezer)
 {
-	int i;
 	int upcoming;
 	int n = 0, m = 0;
 	freezer_queue_processing(tag_c, freezer);
 	if (freezer->latched) {
-		for (i = 0; i < NUM_ZONES; i++) 
-			temp_sorted[i].sorted = false;
 		if (++freezer_report_beat == freezer->report_cycle) {
 			m = make_temperature_event(tag_c, freezer, 0);
 			freezer_report_beat = 0;
@@ -1704,9 +1547,10 @@ int freezer_processing(struct tag_control *tag_c, struct freezer_control *freeze
 static uint32_t humidity_beat = 0;
 static void humidity_queue_processing(struct tag_control *tag_c, struct humidity_control *phumidity)
 {
-	struct Tag *tag, *tag1;
+	struct Tag *tag;
 	struct tq_head *tqueue;
-	time_t now, past;
+	void *spent = NULL;
+	time_t now;
 	struct tm tm1; 
 	struct tm *ptm;
 	bool ready_to_sample = false;
@@ -1715,8 +1559,6 @@ static void humidity_queue_processing(struct tag_control *tag_c, struct humidity
 	if (TAILQ_EMPTY(tqueue))
 		return;
 	now = time(NULL);
-	past = now - phumidity->tag_out_time;
-//	past = now - high_temp->report_cycle;
 
 	ptm = localtime_r(&now, &tm1);
 
@@ -1724,30 +1566,15 @@ static void humidity_queue_processing(struct tag_control *tag_c, struct humidity
 		ready_to_sample = true;
 	}
 	pthread_mutex_lock(&tag_c->mutex_humidity);
+	if (tag_c->time_adjust)
+		tag_heap_retime(&tag_c->humidity_heap, phumidity->tag_out_time, now - 2);
+	tag_queue_aging(tag_c, tqueue, &tag_c->humidity_index, &tag_c->humidity_heap,
+			phumidity->tag_out_time, STATUS_RFID_TAG_OUT, "Humidity", now, &spent);
 
 	for (tag = tqueue->tqh_first; tag != NULL; tag = tag->link.tqe_next) {
 //		now = time(NULL);
-		if (tag->recent < past) {
-			if (tag->status & TAG_SENIOR) {
-				make_rfid_event(tag_c, tag, backtrack_gps_trail(now - tag->recent), STATUS_RFID_TAG_OUT, now);
-				print_debug("%02d/%02d/%4d %02d:%02d:%02d Humidity Tag OUT: %u\n", 
-						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
-						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
-						tag->tnum); 
-			} 
-			tag1 = tag->link.tqe_next;
-			TAILQ_REMOVE(tqueue, tag, link);
-			memset(tag, 0, sizeof(*tag));
-			pthread_mutex_lock(&tag_c->mutex_recycle);
-			TAILQ_INSERT_TAIL(&tag_c->recycle_queue, tag, link);
-			pthread_mutex_unlock(&tag_c->mutex_recycle);
-			if (tag1 == NULL)
-				break;
-			tag = tag1;
-//		} else if (ready_to_sample) { /*ready_to_sample*/
-//			if ((tag->status & TAG_FRESH) && (tag->rssi >= truck->min_rssi)) {			
-		} else if ((tag->status & TAG_FRESH)) {
-				make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_TAG_IN, now);
+		if ((tag->status & TAG_FRESH)) {
+				make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_TAG_IN, now);
 				print_debug("%02d/%02d/%4d %02d:%02d:%02d Humidity Tag IN: %u\n", 
 						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
 						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
@@ -1755,7 +1582,7 @@ static void humidity_queue_processing(struct tag_control *tag_c, struct humidity
 				tag->status &= ~TAG_FRESH;
 				tag->status |= TAG_SENIOR;
 		} else if (ready_to_sample && (tag->status & TAG_SENIOR)) { /*senior*/
-				make_rfid_event(tag_c, tag, &gpsFresh.point, STATUS_RFID_TAG_IN, now);
+				make_rfid_event(tag_c, tag, &rfid_gps.fresh.point, STATUS_RFID_TAG_IN, now);
 				print_debug("%02d/%02d/%4d %02d:%02d:%02d Humidity Tag IN: %u\n", 
 						ptm->tm_mon+1, ptm->tm_mday, ptm->tm_year+1900, 
 						ptm->tm_hour, ptm->tm_min, ptm->tm_sec, 
@@ -1764,6 +1591,7 @@ static void humidity_queue_processing(struct tag_control *tag_c, struct humidity
 //		} /*ready_to_sample*/
 	}
 	pthread_mutex_unlock(&tag_c->mutex_humidity);	
+	tag_pool_release(&tag_c->pool, &spent);
 	if (ready_to_sample) 
 		humidity_beat = 0;
 }
@@ -1809,22 +1637,17 @@ static void EncodeInt16(unsigned char *outbuf, int value)
 }
 int read_temperature(struct freezer_control *freezer, unsigned char *pzone)
 {
-	int i, l, m, mid, hi, lo;
+	int i, mid, hi, lo;
 	int n_zones = 0;
 	uint32_t zone_mask = 0; 
 	freezer->alarm_summary = 0;	
 	for (i = 0; i < freezer->divisor; i++) {
 		zone_mask = 1 << i;
 		if (freezer->t_zone[i].tnum > 0) {
-			memcpy(&temp_sorted[i], &freezer->t_zone[i], sizeof(struct temp_record));
-			l = freezer->t_zone[i].count - 1;
-			quicksort(temp_sorted[i].t, 0, l);
-			temp_sorted[i].sorted = true;
-			m = (l + 1) >> 1;
-			mid = (temp_sorted[i].t[m] << 1) - 500;
+			mid = (sample_window_median(&freezer->t_zone[i].t) << 1) - 500;
 			if (mid < freezer->t_zone[i].high && mid > freezer->t_zone[i].low) {
-				hi = (temp_sorted[i].t[l] << 1) - 500;	
-				lo = (temp_sorted[i].t[0] << 1) - 500;	
+				hi = (sample_window_max(&freezer->t_zone[i].t) << 1) - 500;	
+				lo = (sample_window_min(&freezer->t_zone[i].t) << 1) - 500;	
 				*pzone = (unsigned char)(i & 0xFF);
 				EncodeInt16(pzone + 1, hi);
 				EncodeInt16(pzone + 3, mid);
@@ -1840,7 +1663,7 @@ int read_temperature(struct freezer_control *freezer, unsigned char *pzone)
 }
 int read_temperature_alarm(struct freezer_control *freezer, unsigned char *pzone, int alarm_type)
 {
-	int i, l, m, mid, hi, lo;
+	int i, mid, hi, lo;
 	int n_zones = 0;
 	uint32_t zone_mask = 0; 
 	int compare;
@@ -1848,15 +1671,7 @@ int read_temperature_alarm(struct freezer_control *freezer, unsigned char *pzone
 	for (i = 0; i < freezer->divisor; i++) {
 		zone_mask = 1 << i;
 		if (freezer->t_zone[i].tnum > 0) {
-			if (!temp_sorted[i].sorted) {
-				memcpy(&temp_sorted[i], &freezer->t_zone[i], sizeof(struct temp_record));
-				l = freezer->t_zone[i].count - 1;
-				quicksort(temp_sorted[i].t, 0, l);
-				temp_sorted[i].sorted = true;
-			} else
-				l = freezer->t_zone[i].count - 1;
-			m = (l + 1) >> 1;
-			mid = (temp_sorted[i].t[m] << 1) - 500;
+			mid = (sample_window_median(&freezer->t_zone[i].t) << 1) - 500;
 			if (mid >= freezer->t_zone[i].high)
 				compare = 1;
 			else if (mid <= freezer->t_zone[i].low)
@@ -1865,8 +1680,8 @@ int read_temperature_alarm(struct freezer_control *freezer, unsigned char *pzone
 				compare = 0;
 			if ((compare > 0 && alarm_type == FREEZER_ALARM_HIGH) ||
 					(compare < 0 && alarm_type == FREEZER_ALARM_LOW)) {
-				hi = (temp_sorted[i].t[l] << 1) - 500;	
-				lo = (temp_sorted[i].t[0] << 1) - 500;	
+				hi = (sample_window_max(&freezer->t_zone[i].t) << 1) - 500;	
+				lo = (sample_window_min(&freezer->t_zone[i].t) << 1) - 500;	
 				*pzone = (unsigned char)(i & 0xFF);
 				EncodeInt16(pzone + 1, hi);
 				EncodeInt16(pzone + 3, mid);
@@ -1893,7 +1708,7 @@ int make_temperature_event(struct tag_control *tag_c, struct freezer_control *fr
 	now = time(NULL);
 	memset(pkt->data, 0, sizeof(pkt->data));
 	EncodeUInt32(pkt->data + 2, (uint32_t)now);
-	gpsPointEncode8(pkt->data + 6, &gpsFresh.point);
+	gpsPointEncode8(pkt->data + 6, &rfid_gps.fresh.point);
 /*	EncodeUInt32(pkt->data + 19, freezer->primary_id);
 	EncodeUInt16(pkt->data + 18, tag_c->customer_id);
 	EncodeUInt32(pkt->data + 14, tag_c->reader_type);
@@ -1924,7 +1739,7 @@ int make_temperature_event(struct tag_control *tag_c, struct freezer_control *fr
 				ptm->tm_hour, ptm->tm_min, ptm->tm_sec); 
 		/* toggle the pin */
 		if(trig_alarm_pin) {
-			system("/usr/local/bin/disalarm");
+			gpio_out_set(GPIO_OUT_ALARM, false);
 			trig_alarm_pin = false;
 		}
 	} else if (alarm_type == FREEZER_ALARM_HIGH) {
@@ -1935,7 +1750,7 @@ int make_temperature_event(struct tag_control *tag_c, struct freezer_control *fr
 				ptm->tm_hour, ptm->tm_min, ptm->tm_sec); 
 		/* toggle the pin */
 		if (!trig_alarm_pin) {
-			system("/usr/local/bin/trig_alarm");
+			gpio_out_set(GPIO_OUT_ALARM, true);
 			trig_alarm_pin = true;
 		}
 	} else if (alarm_type == FREEZER_ALARM_LOW) {
@@ -1946,7 +1761,7 @@ int make_temperature_event(struct tag_control *tag_c, struct freezer_control *fr
 				ptm->tm_hour, ptm->tm_min, ptm->tm_sec); 
 		/* toggle the pin */
 		if (!trig_alarm_pin) {
-			system("/usr/local/bin/trig_alarm");
+			gpio_out_set(GPIO_OUT_ALARM, true);
 			trig_alarm_pin = true;
 		}
 	}
@@ -2000,7 +1815,7 @@ void make_rfid_event(struct tag_control *tag_c, struct Tag * tag, GPSPoint_t *co
 		hightemp_min_2 = propGetUInt32AtIndex(PROP_RFID_HIGHTEMP_ID_RANGE_2, 0, 1);
        	hightemp_max_2 = propGetUInt32AtIndex(PROP_RFID_HIGHTEMP_ID_RANGE_2, 1, 99);
 		if ((tag->tnum >= hightemp_min && tag->tnum <= hightemp_max) ||(tag->tnum >= hightemp_min_2 && tag->tnum <= hightemp_max_2))
-			t = HighTemp_tag_processing(tag);
+			t = pt1000_temperature(tag->temp);
 // if it's the normal temperature tag 
 		else
 			t = (tag->temp << 1) - 500;	
@@ -2020,7 +1835,7 @@ void make_rfid_event(struct tag_control *tag_c, struct Tag * tag, GPSPoint_t *co
 }
 void sample_temperature(struct freezer_control *freezer, struct Tag *tag)
 {
-	int zone, i;
+	int zone;
 
 	if (!freezer->is_zone0 && tag->tnum == freezer->primary_id)
 		return;
@@ -2028,86 +1843,18 @@ void sample_temperature(struct freezer_control *freezer, struct Tag *tag)
 		zone = tag->tnum - freezer->primary_id;
 	if (freezer->t_zone[zone].tnum == 0)
 		freezer->t_zone[zone].tnum = tag->tnum;
-	i = freezer->t_zone[zone].next;
-	freezer->t_zone[zone].t[i] = tag->temp;
-	if (i == NUM_TEMPERATURES - 1)
-		freezer->t_zone[zone].next = 0; 
-	else
-		++freezer->t_zone[zone].next;
-	if (freezer->t_zone[zone].count < NUM_TEMPERATURES)
-		++freezer->t_zone[zone].count;
-}
-static int gps_trail_next = 0;
-static bool gps_trail_length = 0;
-static bool gps_trail_valid = false;
-void update_gps_trail(void)
-{
-	GPS_t * gps_latest;
-	gps_latest = gpsGetLastGPS(&gpsFleeting, USHRT_MAX);
-	if (gps_latest == (GPS_t *)0) {
-		if (gps_trail_valid) {
-			gps_trail_next = 0;
-			gps_trail_length = 0;
-			gps_trail_valid = false;
-		}
-	} else {
-		gpsCopy(&gpsFresh, &gpsFleeting);
-		gps_trail_valid = true;
-		if (gps_trail_length < GPS_TRAIL_LENGTH)
-			gps_trail_length++;
-		gps_trail[gps_trail_next++] = gpsFleeting.point;
-		if (gps_trail_next == GPS_TRAIL_LENGTH)
-			gps_trail_next = 0;
-	}
-}
-GPSPoint_t * backtrack_gps_trail(int backward_time)
-{
-	int back_index, index;
-
-	if (!gps_trail_valid)
-		return (&gpsFresh.point);
-	back_index = backward_time / RFID_MAIN_PERIOD;
-	if (back_index <= 0)
-		return (&gpsFresh.point);
-	if (back_index > gps_trail_length) {
-		if (gps_trail_length < GPS_TRAIL_LENGTH)
-			return (&gps_trail[0]);
-		else
-			return (&gps_trail[gps_trail_next]);
-	}
-	else { 
-		if (gps_trail_next >= back_index)
-			index = gps_trail_next - back_index;
-		else
-			index = gps_trail_next + GPS_TRAIL_LENGTH - back_index;
-		return &gps_trail[index];
-	}
+	sample_window_add(&freezer->t_zone[zone].t, tag->temp);
 }
-bool am_i_moving(uint32_t speed)
-{
-	return (gps_trail_valid && (gpsFleeting.speedKPH > speed));
-}
-static uint32_t rssi_sort[NUM_RSSI];
+/* the latest sample stands in for the median until the window fills */
 uint32_t find_median_rssi(struct freezer_control *freezer)
 {
-	int goal;
-	if (freezer->rssi_samples == 0)
-		return 0;
-	else if (freezer->rssi_samples < NUM_RSSI)
-		return freezer->rssi_sample[freezer->rssi_samples - 1];
-	else {
-		memcpy(rssi_sort, freezer->rssi_sample, NUM_RSSI * sizeof(uint32_t));
-		goal = quick_select(rssi_sort, 0, (NUM_RSSI - 1), (NUM_RSSI >> 1));
-		return rssi_sort[goal];
-	}
+	if (freezer->rssi.count < NUM_RSSI)
+		return sample_window_latest(&freezer->rssi);
+	return sample_window_median(&freezer->rssi);
 }
 void sample_rssi(struct freezer_control *freezer, uint32_t rssi) 
 {
-	freezer->rssi_sample[freezer->rssi_point++] = rssi;
-	if (freezer->rssi_point == NUM_RSSI)
-		freezer->rssi_point = 0;
-	if (freezer->rssi_samples < NUM_RSSI)
-		++freezer->rssi_samples;
+	sample_window_add(&freezer->rssi, rssi);
 }
 /* indicate thread should stop */
 void rfid_stop(void)
@@ -2119,19 +1866,22 @@ void rfid_port_close(void)
 {
 	close(rfidCom.read_fd);
 }
+/* Report (and reset) tags dropped since the last call because the tag pool
+ * and role quota were exhausted.  Returns false if none were dropped. */
+bool rfid_tag_pool_exhausted(uint32_t *since, uint32_t *dropped)
+{
+	return tag_pool_exhausted(&tag_control_1.pool, since, dropped);
+}
 void reset_freezer_rssi_record(struct freezer_control *freezer) 
 {
-	int i;
-	for (i = 0; i < NUM_RSSI; i++)
-		freezer->rssi_sample[i] = 0;
-	freezer->rssi_point = 0;
-	freezer->rssi_samples = 0;
+	sample_window_init(&freezer->rssi, NUM_RSSI);
 	freezer->fading_count = 0;
 }
 void reset_freezer_zone(struct freezer_control *freezer, int zn) 
 {
 	Key_t r = PROP_TEMP_RANGE_0 + zn;
 	memset(&freezer->t_zone[zn], 0, sizeof(struct temp_record));
+	sample_window_init(&freezer->t_zone[zn].t, NUM_TEMPERATURES);
 	freezer->t_zone[zn].low = propGetUInt32AtIndex(r, 0, 0);
 	freezer->t_zone[zn].high = propGetUInt32AtIndex(r, 1, 99);
 }
@@ -2141,6 +1891,7 @@ void reset_freezer_zones(struct freezer_control *freezer)
 	Key_t r = PROP_TEMP_RANGE_0;
 	memset(freezer->t_zone, 0, sizeof(freezer->t_zone));
 	for (i = 0; i < NUM_ZONES; i++, r++) {
+		sample_window_init(&freezer->t_zone[i].t, NUM_TEMPERATURES);
 		freezer->t_zone[i].low = propGetUInt32AtIndex(r, 0, 0);
 		freezer->t_zone[i].high = propGetUInt32AtIndex(r, 1, 99);
 	}
@@ -2179,8 +1930,8 @@ void init_freezer_parameter(struct freezer_control *freezer)
 		freezer->permanently = true;
 		freezer->primary_id = n;
 	}
-	memset(freezer->t_zone, 0, sizeof(freezer->t_zone));
-	freezer->alarm_summary = 0;
+	reset_freezer_zones(freezer);
+	reset_freezer_rssi_record(freezer);
 }
 void init_tag_parameter(struct tag_control *tag_c)
 {
@@ -2446,52 +2197,109 @@ static void init_humidity_parameter(struct humidity_control *p_humidity)
 		p_humidity->report_cycle = LONG_MAX;
 }
 
-int quickpartition(uint32_t *A, int b, int e)
+/* Insert [lower, upper] into the sorted range table, minus any part already
+ * claimed by an earlier (higher priority) role. */
+static void add_role_range(struct tag_control *tag_c, int *n, struct role_range *r, uint32_t lower, uint32_t upper)
 {
-	uint32_t X;
-	int i, j, m;
-	if (b >= e)
-		return b;
-	m = A[e];
-	i = b;
-	for (j = b; j < e; j++) {
-		if (A[j] <= m) {
-			if (j > i) {
-				X = A[i];
-				A[i] = A[j];
-				A[j] = X;
-			}
-			++i;
-		}
+	uint32_t e_lower, e_upper;
+	int i;
+
+	if (upper == 0 || lower > upper)
+		return;
+	for (i = 0; i < *n; i++) {
+		/* copy, inserting below shifts the table */
+		e_lower = tag_c->ranges[i].id_lower;
+		e_upper = tag_c->ranges[i].id_upper;
+		if (lower > e_upper || upper < e_lower)
+			continue;
+		printf("RFID role %x range %u-%u overlaps role %x range %u-%u\n",
+				r->role, lower, upper, tag_c->ranges[i].role, e_lower, e_upper);
+		if (lower < e_lower)
+			add_role_range(tag_c, n, r, lower, e_lower - 1);
+		if (upper > e_upper)
+			add_role_range(tag_c, n, r, e_upper + 1, upper);
+		return;
 	}
-	if (i < e) {
-		X = A[e];
-		A[e] = A[i];
-		A[i] = X;
+	if (*n >= MAX_ROLE_RANGES) {
+		printf("RFID role table full, range %u-%u ignored\n", lower, upper);
+		return;
 	}
-	return i;
+	for (i = *n; i > 0 && tag_c->ranges[i - 1].id_lower > lower; i--)
+		tag_c->ranges[i] = tag_c->ranges[i - 1];
+	tag_c->ranges[i] = *r;
+	tag_c->ranges[i].id_lower = lower;
+	tag_c->ranges[i].id_upper = upper;
+	(*n)++;
 }
-void quicksort(uint32_t *A, int b, int e)
+/* Compile the configured tag number ranges of all roles into a sorted table.
+ * Roles are added in the order parse_tag used to test them, so where ranges
+ * overlap the earlier role keeps the tags, as before. */
+static void init_role_table(struct tag_control *tag_c)
 {
-	int pivot;
-	if (b < e) {
-		pivot = quickpartition(A, b, e);
-		if (pivot > b)
-			quicksort(A, b,  (pivot - 1));
-		if (pivot < e)
-			quicksort(A, (pivot + 1), e);
-	}
+	struct role_range r;
+	int n = 0;
+
+	tag_c->num_ranges = 0;
+	__sync_synchronize();
+	if (tag_c->role & ROLE_FREEZER) {
+		r = (struct role_range){0, 0, ROLE_FREEZER, freezer1.tag_in_time, freezer1.tag_out_time,
+			&tag_c->freezer_queue, &tag_c->freezer_index, &tag_c->freezer_heap, &tag_c->mutex_freezer};
+		add_role_range(tag_c, &n, &r, freezer1.id_lower, freezer1.id_upper);
+	}
+	if (tag_c->role & ROLE_LOCKER) {
+		r = (struct role_range){0, 0, ROLE_LOCKER, locker1.tag_in_time, locker1.tag_out_time,
+			&tag_c->locker_queue, &tag_c->locker_index, &tag_c->locker_heap, &tag_c->mutex_locker};
+		add_role_range(tag_c, &n, &r, locker1.id_lower, locker1.id_upper);
+	}
+	if (tag_c->role & ROLE_CARGO) {
+		r = (struct role_range){0, 0, ROLE_CARGO, truck1.tag_in_time, truck1.tag_out_time,
+			&tag_c->cargo_queue, &tag_c->cargo_index, &tag_c->cargo_heap, &tag_c->mutex_cargo};
+		add_role_range(tag_c, &n, &r, truck1.id_lower, truck1.id_upper);
+	}
+	if (tag_c->role & ROLE_SWITCH) {
+		r = (struct role_range){0, 0, ROLE_SWITCH, switch1.tag_in_time, switch1.tag_out_time,
+			&tag_c->switch_queue, &tag_c->switch_index, &tag_c->switch_heap, &tag_c->mutex_switch};
+		add_role_range(tag_c, &n, &r, switch1.id_lower, switch1.id_upper);
+	}
+	if (tag_c->role & ROLE_HIGHTEMP) {
+		r = (struct role_range){0, 0, ROLE_HIGHTEMP, high_temp.tag_in_time, high_temp.tag_out_time,
+			&tag_c->hightemp_queue, &tag_c->hightemp_index, &tag_c->hightemp_heap, &tag_c->mutex_hightemp};
+		add_role_range(tag_c, &n, &r, high_temp.id_lower, high_temp.id_upper);
+		add_role_range(tag_c, &n, &r, high_temp.id_lower_2, high_temp.id_upper_2);
+	}
+	if (tag_c->role & ROLE_MOTION) {
+		r = (struct role_range){0, 0, ROLE_MOTION, motion.tag_in_time, motion.tag_out_time,
+			&tag_c->motion_queue, &tag_c->motion_index, &tag_c->motion_heap, &tag_c->mutex_motion};
+		add_role_range(tag_c, &n, &r, motion.id_lower, motion.id_upper);
+	}
+	if (tag_c->role & ROLE_SENSOR) {
+		r = (struct role_range){0, 0, ROLE_SENSOR, sensor.tag_in_time, sensor.tag_out_time,
+			&tag_c->sensor_queue, &tag_c->sensor_index, &tag_c->sensor_heap, &tag_c->mutex_sensor};
+		add_role_range(tag_c, &n, &r, sensor.id_lower, sensor.id_upper);
+	}
+	if (tag_c->role & ROLE_HUMIDITY) {
+		r = (struct role_range){0, 0, ROLE_HUMIDITY, humidity.tag_in_time, humidity.tag_out_time,
+			&tag_c->humidity_queue, &tag_c->humidity_index, &tag_c->humidity_heap, &tag_c->mutex_humidity};
+		add_role_range(tag_c, &n, &r, humidity.id_lower, humidity.id_upper);
+	}
+	/* publish to the reader thread only once the table is complete */
+	__sync_synchronize();
+	tag_c->num_ranges = n;
 }
-int quick_select(uint32_t *A, int b, int e, int rank)
+/* Binary search for the role range holding tnum */
+struct role_range *search_role(struct tag_control *tag_c, uint32_t tnum)
 {
-	int pivot;
-	if (b == e)
-		return b; 
-	pivot = quickpartition(A, b, e);
-	if (pivot == rank)
-		return pivot;
-	else if (pivot > rank)
-		return quick_select(A, b, (pivot - 1), rank);
-	else
-		return quick_select(A, (pivot + 1), e, rank);
+	int lo = 0, hi = tag_c->num_ranges - 1, mid;
+
+	__sync_synchronize();
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		if (tnum < tag_c->ranges[mid].id_lower)
+			hi = mid - 1;
+		else if (tnum > tag_c->ranges[mid].id_upper)
+			lo = mid + 1;
+		else
+			return &tag_c->ranges[mid];
+	}
+	return NULL;
 }
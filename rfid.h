@@ -2,3 +2,4 @@ extern bool rfid_queue_time_adjust;
 int rfid_initialize(void);
 void rfid_stop(void);
 void rfid_port_close(void);
+bool rfid_tag_pool_exhausted(uint32_t *since, uint32_t *dropped);
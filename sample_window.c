@@ -0,0 +1,100 @@
+/* Sliding window order statistics for the RFID and QDAC readers.
+ * The window keeps its samples twice: in a ring, to know which sample is
+ * the oldest, and in ascending order, so the median, the extremes or any
+ * other rank are read directly.  Each new sample replaces the oldest one in
+ * the sorted copy by a binary search and a short move, instead of copying
+ * and sorting the whole window every time a statistic is wanted.  Windows
+ * are a handful of samples long, where this beats a skip list or a pair of
+ * heaps and needs no allocation.  A window is not locked; it is protected
+ * by whatever protects the record that holds it. */
+#include <stdint.h>
+#include <string.h>
+#include "sample_window.h"
+
+/* first position in the sorted copy whose sample is not below 'v' */
+static int window_lower_bound(const struct sample_window *w, int32_t v)
+{
+	int lo = 0, hi = w->count, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) >> 1;
+		if (w->sorted[mid] < v)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+void sample_window_init(struct sample_window *w, int size)
+{
+	memset(w, 0, sizeof(struct sample_window));
+	if (size < 1)
+		size = 1;
+	else if (size > SAMPLE_WINDOW_MAX)
+		size = SAMPLE_WINDOW_MAX;
+	w->size = size;
+}
+
+void sample_window_add(struct sample_window *w, int32_t v)
+{
+	int out, in;
+
+	if (w->count == w->size) {
+		/* drop the oldest sample from the sorted copy */
+		out = window_lower_bound(w, w->ring[w->next]);
+		memmove(&w->sorted[out], &w->sorted[out + 1], (w->count - out - 1) * sizeof(int32_t));
+		w->sum -= w->ring[w->next];
+		--w->count;
+	}
+	in = window_lower_bound(w, v);
+	memmove(&w->sorted[in + 1], &w->sorted[in], (w->count - in) * sizeof(int32_t));
+	w->sorted[in] = v;
+	++w->count;
+	w->sum += v;
+	w->ring[w->next] = v;
+	if (++w->next == w->size)
+		w->next = 0;
+}
+
+/* sample of the given rank, 0 being the lowest; 0 if the window is empty */
+int32_t sample_window_rank(const struct sample_window *w, int rank)
+{
+	if (w->count == 0)
+		return 0;
+	if (rank < 0)
+		rank = 0;
+	else if (rank >= w->count)
+		rank = w->count - 1;
+	return w->sorted[rank];
+}
+
+/* upper median of an even window */
+int32_t sample_window_median(const struct sample_window *w)
+{
+	return sample_window_rank(w, w->count >> 1);
+}
+
+int32_t sample_window_min(const struct sample_window *w)
+{
+	return sample_window_rank(w, 0);
+}
+
+int32_t sample_window_max(const struct sample_window *w)
+{
+	return sample_window_rank(w, w->count - 1);
+}
+
+int32_t sample_window_latest(const struct sample_window *w)
+{
+	if (w->count == 0)
+		return 0;
+	return w->ring[(w->next == 0) ? (w->size - 1) : (w->next - 1)];
+}
+
+int32_t sample_window_mean(const struct sample_window *w)
+{
+	if (w->count == 0)
+		return 0;
+	return w->sum / (int32_t)w->count;
+}
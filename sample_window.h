@@ -0,0 +1,25 @@
+#ifndef _SAMPLE_WINDOW_H
+#define _SAMPLE_WINDOW_H
+#include <stdint.h>
+
+/* sliding window over the most recent samples of a tag */
+#define SAMPLE_WINDOW_MAX	16	/* largest window length */
+
+struct sample_window {
+	uint16_t size;			/* window length */
+	uint16_t count;			/* samples held, up to 'size' */
+	uint16_t next;			/* ring slot of the next sample */
+	int32_t sum;
+	int32_t ring[SAMPLE_WINDOW_MAX];	/* arrival order */
+	int32_t sorted[SAMPLE_WINDOW_MAX];	/* the same samples, ascending */
+};
+
+void sample_window_init(struct sample_window *w, int size);
+void sample_window_add(struct sample_window *w, int32_t v);
+int32_t sample_window_rank(const struct sample_window *w, int rank);
+int32_t sample_window_median(const struct sample_window *w);
+int32_t sample_window_min(const struct sample_window *w);
+int32_t sample_window_max(const struct sample_window *w);
+int32_t sample_window_latest(const struct sample_window *w);
+int32_t sample_window_mean(const struct sample_window *w);
+#endif
@@ -75,6 +75,7 @@
 #include "io.h"
 #include "comport.h"
 
+#include "checksum.h"
 #include "cerrors.h"
 #include "propman.h"
 #include "statcode.h"
@@ -275,6 +276,20 @@ static void _propertyPostSET(PropertyRefresh_t mode, Key_t key, UInt8 *args, int
 {
     if (mode & PROP_REFRESH_SET) {
         switch (key) {
+            case PROP_MOTION_START_TYPE:
+            case PROP_MOTION_START:
+            case PROP_MOTION_IN_MOTION:
+            case PROP_MOTION_STOP:
+            case PROP_MOTION_STOP_TYPE:
+            case PROP_MOTION_DORMANT_INTRVL:
+            case PROP_MOTION_DORMANT_COUNT:
+            case PROP_MOTION_EXCESS_SPEED: {
+                // rebuild the motion config snapshot on the next fix
+                motionConfigChanged();
+            } break;
+            case PROP_GPS_DISTANCE_DELTA: {
+                odomConfigChanged();
+            } break;
             case PROP_STATE_DEVICE_ID: {
                 // change host/device name
                 const char *s = propGetDeviceID(0); // propGetString(PROP_STATE_DEVICE_ID,"");
@@ -312,6 +327,7 @@ static void _propertyPostSET(PropertyRefresh_t mode, Key_t key, UInt8 *args, int
 // ----------------------------------------------------------------------------
 
 /* status "ping" */
+#define PING_GPS_TIMEOUT_MS 5000L       // wait this long for a fresh fix
 CommandError_t startupPingStatus(PacketPriority_t priority, StatusCode_t code, int ndx)
 {
     ClientPacketType_t pktType = DEFAULT_EVENT_FORMAT;
@@ -319,7 +335,12 @@ CommandError_t startupPingStatus(PacketPriority_t priority, StatusCode_t code, i
     /* initialize an event in anticipation that the status code is valid */
     GPS_t gps;
     Event_t evRcd;
-    evSetEventDefaults(&evRcd, code, 0L, gpsGetLastGPS(&gps,-1));
+    GPS_t *fix = gpsIsReceiverOff()? (GPS_t*)0 : gpsAquire(&gps, PING_GPS_TIMEOUT_MS);
+    if (!fix) {
+        // no fresh fix in time (or the receiver is off), report the last one
+        fix = gpsGetLastGPS(&gps, -1);
+    }
+    evSetEventDefaults(&evRcd, code, 0L, fix);
 
     /* check specified status code */
     if ((code == STATUS_LOCATION) || (code == STATUS_WAYMARK) || (code == STATUS_QUERY)) {
@@ -1137,6 +1158,11 @@ int startupDMTP(int argc, char *argv[], utBool startThread)
 	logStartThread();
 #endif
 
+	/* verify the RFID/QDAC frame CRC kernels */
+	if (!cksumSelfTest()) {
+		logCRITICAL(LOGSRC,"CRC self test failed, reader frames will be rejected");
+	}
+
 	/* header */
 	_printBanner();
 //	system("run_led_on &");
@@ -0,0 +1,351 @@
+/* Tag store and GPS helpers shared by the RFID and QDAC readers.
+ * Each reader keeps its own queues, roles and frame decoder; what they
+ * have in common lives here, so both readers get the same lookups, tag
+ * pool, aging and event positions.  Only the tag pool locks, its own
+ * mutex: an index or heap is guarded by the mutex of its queue, and a
+ * reader_gps belongs to one reader thread. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <time.h>
+#include "stdtypes.h"
+#include "gpstools.h"
+#include "gps.h"
+#include "tagreader.h"
+
+static inline uint32_t tag_hash(uint32_t key)
+{
+	return (key * 2654435761U) >> (32 - TAG_INDEX_BITS);
+}
+
+void *tag_index_search(struct tag_index *tindex, uint32_t key)
+{
+	uint32_t i;
+
+	for (i = tag_hash(key); tindex->slot[i].tag != NULL; i = (i + 1) & TAG_INDEX_MASK) {
+		if (tindex->slot[i].key == key)
+			return tindex->slot[i].tag;
+	}
+	return NULL;
+}
+
+void tag_index_add(struct tag_index *tindex, uint32_t key, void *tag)
+{
+	uint32_t i = tag_hash(key);
+
+	while (tindex->slot[i].tag != NULL)
+		i = (i + 1) & TAG_INDEX_MASK;
+	tindex->slot[i].key = key;
+	tindex->slot[i].tag = tag;
+	tindex->count++;
+}
+
+/* Backward-shift deletion, so lookups never need tombstones */
+void tag_index_remove(struct tag_index *tindex, uint32_t key, void *tag)
+{
+	uint32_t i, j, k;
+
+	for (i = tag_hash(key); tindex->slot[i].tag != tag; i = (i + 1) & TAG_INDEX_MASK) {
+		if (tindex->slot[i].tag == NULL)
+			return;
+	}
+	for (j = (i + 1) & TAG_INDEX_MASK; tindex->slot[j].tag != NULL; j = (j + 1) & TAG_INDEX_MASK) {
+		k = tag_hash(tindex->slot[j].key);
+		/* move slot j into the hole at i unless its home k lies cyclically in (i, j] */
+		if ((i <= j)? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+		tindex->slot[i] = tindex->slot[j];
+		i = j;
+	}
+	tindex->slot[i].tag = NULL;
+	tindex->count--;
+}
+
+struct tag_slab {
+	struct tag_slab *next;
+	long long tags[];		/* 'tags_per_slab' records of 'tag_size' bytes */
+};
+
+/* Add a slab of tags to the free list, unless the pool is at its ceiling.
+ * Caller holds the pool mutex, or is initializing. */
+static int tag_pool_grow(struct tag_pool *pool)
+{
+	struct tag_slab *slab;
+	char *rec;
+	uint32_t i;
+
+	if (pool->num_tags + pool->tags_per_slab > pool->max_tags)
+		return -1;
+	slab = malloc(sizeof(struct tag_slab) + pool->tags_per_slab * pool->tag_size);
+	if (slab == NULL)
+		return -1;
+	memset(slab, 0, sizeof(struct tag_slab) + pool->tags_per_slab * pool->tag_size);
+	rec = (char *)slab->tags;
+	for (i = 0; i < pool->tags_per_slab; i++, rec += pool->tag_size) {
+		*(void **)rec = pool->free;
+		pool->free = rec;
+	}
+	slab->next = pool->slabs;
+	pool->slabs = slab;
+	pool->num_tags += pool->tags_per_slab;
+	return 0;
+}
+
+/* Set up an empty pool with 'initial_slabs' slabs; the rest are added as
+ * tags are needed.  Returns -1 if not even one slab could be allocated. */
+int tag_pool_init(struct tag_pool *pool, size_t tag_size, uint32_t tags_per_slab,
+		uint32_t max_tags, uint32_t role_quota, uint32_t initial_slabs)
+{
+	uint32_t n;
+
+	pool->tag_size = tag_size;
+	pool->tags_per_slab = tags_per_slab;
+	pool->slabs = NULL;
+	pool->free = NULL;
+	pool->num_tags = 0;
+	pool->tags_dropped = 0;
+	pool->max_tags = (max_tags < tags_per_slab)? tags_per_slab : max_tags;
+	pool->role_quota = (role_quota == 0 || role_quota > TAG_HEAP_SIZE)? TAG_HEAP_SIZE : role_quota;
+	for (n = 0; n < initial_slabs; n++) {
+		if (tag_pool_grow(pool) < 0)
+			break;
+	}
+	return (pool->num_tags > 0)? 0 : -1;
+}
+
+void tag_pool_free(struct tag_pool *pool)
+{
+	struct tag_slab *slab;
+
+	pthread_mutex_lock(&pool->mutex);
+	while ((slab = pool->slabs) != NULL) {
+		pool->slabs = slab->next;
+		free(slab);
+	}
+	pool->free = NULL;
+	pool->num_tags = 0;
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+/* Take a free tag, growing the pool if there is none.  NULL at the ceiling. */
+void *tag_pool_alloc(struct tag_pool *pool)
+{
+	void *tag;
+
+	pthread_mutex_lock(&pool->mutex);
+	if (pool->free == NULL)
+		tag_pool_grow(pool);
+	tag = pool->free;
+	if (tag != NULL) {
+		pool->free = *(void **)tag;
+		*(void **)tag = NULL;
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	return tag;
+}
+
+/* Put a tag, already off its queue and index, on a 'spent' list */
+void tag_pool_spend(void **spent, void *tag)
+{
+	*(void **)tag = *spent;
+	*spent = tag;
+}
+
+/* Return a 'spent' list to the pool, under one lock */
+void tag_pool_release(struct tag_pool *pool, void **spent)
+{
+	void *last = *spent;
+
+	if (last == NULL)
+		return;
+	while (*(void **)last != NULL)
+		last = *(void **)last;
+	pthread_mutex_lock(&pool->mutex);
+	*(void **)last = pool->free;
+	pool->free = *spent;
+	pthread_mutex_unlock(&pool->mutex);
+	*spent = NULL;
+}
+
+/* Count a tag that found no room.  True for the first one since the drops
+ * were last reported, so the reader can log the start of the shortage. */
+bool tag_pool_drop(struct tag_pool *pool, time_t now)
+{
+	if (__sync_fetch_and_add(&pool->tags_dropped, 1) != 0)
+		return false;
+	pool->exhausted_time = now;
+	return true;
+}
+
+/* Report (and reset) the tags dropped since the last call.  Returns false
+ * if none were dropped. */
+bool tag_pool_exhausted(struct tag_pool *pool, uint32_t *since, uint32_t *dropped)
+{
+	if (pool->tags_dropped == 0)
+		return false;
+	*since = (uint32_t)pool->exhausted_time;
+	*dropped = __sync_lock_test_and_set(&pool->tags_dropped, 0);
+	return (*dropped > 0);
+}
+
+/* Tag-out deadlines.  Hearing a known tag only moves its 'recent' time; its
+ * heap entry is re-armed lazily once it reaches the top, so the reader
+ * thread touches the heap only when a tag is added or evicted.  Caller
+ * holds the role mutex of the heap. */
+static inline void heap_place(struct tag_heap *theap, uint32_t i, struct tag_timer *timer)
+{
+	theap->slot[i] = timer;
+	timer->hpos = i;
+}
+
+static void heap_up(struct tag_heap *theap, uint32_t i)
+{
+	struct tag_timer *timer = theap->slot[i];
+	uint32_t parent;
+
+	while (i > 0) {
+		parent = (i - 1) / 2;
+		if (theap->slot[parent]->deadline <= timer->deadline)
+			break;
+		heap_place(theap, i, theap->slot[parent]);
+		i = parent;
+	}
+	heap_place(theap, i, timer);
+}
+
+static void heap_down(struct tag_heap *theap, uint32_t i)
+{
+	struct tag_timer *timer = theap->slot[i];
+	uint32_t child;
+
+	while ((child = 2 * i + 1) < theap->count) {
+		if (child + 1 < theap->count && theap->slot[child + 1]->deadline < theap->slot[child]->deadline)
+			child++;
+		if (timer->deadline <= theap->slot[child]->deadline)
+			break;
+		heap_place(theap, i, theap->slot[child]);
+		i = child;
+	}
+	heap_place(theap, i, timer);
+}
+
+void tag_heap_arm(struct tag_heap *theap, struct tag_timer *timer, void *tag, time_t *recent, time_t deadline)
+{
+	timer->tag = tag;
+	timer->recent = recent;
+	timer->deadline = deadline;
+	theap->slot[theap->count] = timer;
+	heap_up(theap, theap->count++);
+}
+
+void tag_heap_disarm(struct tag_heap *theap, struct tag_timer *timer)
+{
+	struct tag_timer *last;
+	uint32_t i = timer->hpos;
+
+	if (i >= theap->count || theap->slot[i] != timer)
+		return;
+	last = theap->slot[--theap->count];
+	if (last == timer)
+		return;
+	heap_place(theap, i, last);
+	heap_up(theap, i);
+	heap_down(theap, last->hpos);
+}
+
+/* Pop the next tag whose tag-out time has passed (last heard more than
+ * 'out_time' ago), re-arming on the way the tags heard since they were
+ * armed.  Returns NULL when no tag is due. */
+void *tag_heap_expire(struct tag_heap *theap, time_t now, int out_time)
+{
+	struct tag_timer *timer;
+
+	while (theap->count > 0) {
+		timer = theap->slot[0];
+		if (timer->deadline >= now)
+			break;
+		if (*timer->recent + out_time >= now) {
+			timer->deadline = *timer->recent + out_time;
+			heap_down(theap, 0);
+			continue;
+		}
+		tag_heap_disarm(theap, timer);
+		return timer->tag;
+	}
+	return NULL;
+}
+
+/* After the clock was set, restart every tag of a role as last heard at
+ * 'recent'.  All deadlines become equal, so the heap order still holds. */
+void tag_heap_retime(struct tag_heap *theap, int out_time, time_t recent)
+{
+	uint32_t i;
+
+	for (i = 0; i < theap->count; i++) {
+		*theap->slot[i]->recent = recent;
+		theap->slot[i]->deadline = recent + out_time;
+	}
+}
+
+/* Earliest deadline of a role, 0 if no tag is armed */
+time_t tag_heap_next(struct tag_heap *theap)
+{
+	return (theap->count > 0)? theap->slot[0]->deadline : 0;
+}
+
+/* Disarm and return the least recently heard tag that 'evictable' accepts,
+ * for the caller to take off its queue and index and reuse.  NULL if none. */
+void *tag_heap_evict(struct tag_heap *theap, bool (*evictable)(void *tag))
+{
+	struct tag_timer *lru = NULL;
+	uint32_t i;
+
+	for (i = 0; i < theap->count; i++) {
+		if (!(*evictable)(theap->slot[i]->tag))
+			continue;
+		if (lru == NULL || *theap->slot[i]->recent < *lru->recent)
+			lru = theap->slot[i];
+	}
+	if (lru == NULL)
+		return NULL;
+	tag_heap_disarm(theap, lru);
+	return lru->tag;
+}
+
+void reader_gps_init(struct reader_gps *rgps)
+{
+	gpsClear(&rgps->fresh);
+	gpsClear(&rgps->fleeting);
+	rgps->generation = 0;		/* nothing published yet */
+	rgps->valid = false;
+}
+
+void reader_gps_update(struct reader_gps *rgps)
+{
+	UInt32 gen = gpsGetFixGeneration();
+
+	/* nothing new from the GPS thread, keep the copy we have */
+	if (gen == rgps->generation)
+		return;
+	rgps->generation = gen;
+	/* peek, a power saving fix belongs to the GPS event loop */
+	rgps->valid = (gpsPeekLastGPS(&rgps->fleeting, USHRT_MAX) != (GPS_t *)0);
+	if (rgps->valid)
+		gpsCopy(&rgps->fresh, &rgps->fleeting);
+}
+
+/* position at system time 'when', from the GPS fix history */
+GPSPoint_t *reader_gps_point_at(struct reader_gps *rgps, time_t when)
+{
+	if (rgps->valid && gpsHistoryPointAt(when, &rgps->backtrack))
+		return (&rgps->backtrack);
+	return (&rgps->fresh.point);
+}
+
+bool reader_gps_moving(struct reader_gps *rgps, uint32_t speed)
+{
+	return (rgps->valid && (rgps->fleeting.speedKPH > speed));
+}
@@ -0,0 +1,90 @@
+#ifndef _TAGREADER_H
+#define _TAGREADER_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+#include <pthread.h>
+#include "stdtypes.h"
+#include "gpstools.h"
+
+/* parts shared by the RFID and QDAC readers */
+
+/* open-addressing (linear probing) index of a tag queue, by tag number */
+#define TAG_INDEX_BITS 10
+#define TAG_INDEX_SIZE (1 << TAG_INDEX_BITS)	/* at least twice the tags indexed */
+#define TAG_INDEX_MASK (TAG_INDEX_SIZE - 1)
+struct tag_index {
+	struct {
+		uint32_t key;			/* kept here, so a probe does not touch the tag */
+		void *tag;			/* NULL: empty slot */
+	} slot[TAG_INDEX_SIZE];
+	uint32_t count;
+};
+
+void *tag_index_search(struct tag_index *tindex, uint32_t key);
+void tag_index_add(struct tag_index *tindex, uint32_t key, void *tag);
+void tag_index_remove(struct tag_index *tindex, uint32_t key, void *tag);
+
+/* tag records of a reader, allocated in slabs up to a ceiling and shared by
+ * its roles.  A free record is linked through its first pointer, so a tag
+ * struct must not expect anything of its first member once released. */
+struct tag_slab;
+struct tag_pool {
+	pthread_mutex_t mutex;		/* statically initialized by the reader */
+	size_t tag_size;		/* bytes per tag record */
+	uint32_t tags_per_slab;
+	struct tag_slab *slabs;
+	void *free;			/* free records, under mutex */
+	uint32_t num_tags;
+	uint32_t max_tags;
+	uint32_t role_quota;		/* the most tags one role may hold */
+	volatile uint32_t tags_dropped;	/* since the last tag_pool_exhausted() */
+	volatile time_t exhausted_time;
+};
+
+int tag_pool_init(struct tag_pool *pool, size_t tag_size, uint32_t tags_per_slab,
+		uint32_t max_tags, uint32_t role_quota, uint32_t initial_slabs);
+void tag_pool_free(struct tag_pool *pool);
+void *tag_pool_alloc(struct tag_pool *pool);
+void tag_pool_spend(void **spent, void *tag);
+void tag_pool_release(struct tag_pool *pool, void **spent);
+bool tag_pool_drop(struct tag_pool *pool, time_t now);
+bool tag_pool_exhausted(struct tag_pool *pool, uint32_t *since, uint32_t *dropped);
+
+/* tag-out deadline of a tag, kept in the tag record */
+struct tag_timer {
+	time_t deadline;		/* tag-out time the tag is armed for */
+	uint32_t hpos;			/* position in its role's tag_heap */
+	void *tag;			/* the record this timer is part of */
+	time_t *recent;			/* when the tag was last heard */
+};
+
+/* binary min-heap of a role's tags, by tag-out deadline */
+#define TAG_HEAP_SIZE (TAG_INDEX_SIZE / 2)	/* the largest role quota */
+struct tag_heap {
+	struct tag_timer *slot[TAG_HEAP_SIZE];
+	uint32_t count;
+};
+
+void tag_heap_arm(struct tag_heap *theap, struct tag_timer *timer, void *tag, time_t *recent, time_t deadline);
+void tag_heap_disarm(struct tag_heap *theap, struct tag_timer *timer);
+void *tag_heap_expire(struct tag_heap *theap, time_t now, int out_time);
+void tag_heap_retime(struct tag_heap *theap, int out_time, time_t recent);
+time_t tag_heap_next(struct tag_heap *theap);
+void *tag_heap_evict(struct tag_heap *theap, bool (*evictable)(void *tag));
+
+/* a reader's view of the GPS, refreshed once per processing period */
+struct reader_gps {
+	GPS_t fresh;			/* the last fix, or the last valid one */
+	GPS_t fleeting;
+	GPSPoint_t backtrack;
+	UInt32 generation;		/* 'gpsGetFixGeneration' of 'fleeting' */
+	bool valid;			/* 'fleeting' is a current fix */
+};
+
+void reader_gps_init(struct reader_gps *rgps);
+void reader_gps_update(struct reader_gps *rgps);
+GPSPoint_t *reader_gps_point_at(struct reader_gps *rgps, time_t when);
+bool reader_gps_moving(struct reader_gps *rgps, uint32_t speed);
+#endif
@@ -365,6 +365,27 @@ int threadConditionNotify(threadCond_t *cond)
 	}
 }
 
+/* notify all threads waiting on condition */
+int threadConditionNotifyAll(threadCond_t *cond)
+{
+	if (cond->didInit == MAGIC_INIT_VALUE) {
+#if defined(TARGET_WINCE)
+		/* release one count per waiter */
+		EnterCriticalSection(&(cond->numWaitersLock));
+		int numWaiters = cond->numWaiters;
+		LeaveCriticalSection(&(cond->numWaitersLock));
+		if (numWaiters > 0) {
+			ReleaseSemaphore(cond->semaphore, numWaiters, 0);
+		}
+#else
+		pthread_cond_broadcast(&(cond->semaphore));
+#endif
+		return 0;
+	} else {
+		return -1;
+	}
+}
+
 // ----------------------------------------------------------------------------
 
 /* sleep for the specified amount of milliseconds */
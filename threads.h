@@ -102,6 +102,7 @@ typedef struct
 #define CONDITION_WAIT(C,M)         threadConditionWait((C),(M));
 #define CONDITION_TIMED_WAIT(C,M,T) threadConditionTimedWait((C),(M),(T));
 #define CONDITION_NOTIFY(C)         threadConditionNotify(C);
+#define CONDITION_NOTIFY_ALL(C)     threadConditionNotifyAll(C);
 
 // ----------------------------------------------------------------------------
 // global definitions 
@@ -110,7 +111,6 @@ typedef struct
 #define TIMER_PROTOCOL_2	106		//protocol timer 2
 #define TIMER_GPS_1		102		//gps timer 1
 #define TIMER_UPDATE		103		//update timer
-#define TIMER_RFID_1		104		//rfid timer 1
 #define TIMER_NETWORK_MANAGER	105		//network manager timer
 #define TIMER_POWER_SAVING	107		//power-saving timer 
 // ----------------------------------------------------------------------------
@@ -149,6 +149,7 @@ void threadConditionFree(threadCond_t *cond);
 int threadConditionWait(threadCond_t *cond, threadMutex_t *mutex);
 int threadConditionTimedWait(threadCond_t *cv, threadMutex_t *mutex, struct timespec *tm);
 int threadConditionNotify(threadCond_t *cond);
+int threadConditionNotifyAll(threadCond_t *cond);
 
 // ----------------------------------------------------------------------------
 
@@ -0,0 +1,166 @@
+// ----------------------------------------------------------------------------
+// Description:
+//  u-blox UBX binary protocol framing, message builder and navigation
+//  solution decoder.
+// Notes:
+//  - Only the messages needed to build a 'GPS_t' are decoded: UBX-NAV-PVT
+//    (position, velocity, time, fix status) and UBX-NAV-DOP.
+//  - All multi-byte UBX fields are little-endian.
+// ----------------------------------------------------------------------------
+
+#define SKIP_TRANSPORT_MEDIA_CHECK // only if TRANSPORT_MEDIA not used in this file
+#include "defaults.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stdtypes.h"
+#include "utctools.h"
+#include "gpstools.h"
+#include "ubx.h"
+
+// ----------------------------------------------------------------------------
+
+#define UBX_U2(P,N)     ((UInt16)((P)[N] | ((P)[(N)+1] << 8)))
+#define UBX_U4(P,N)     ((UInt32)((P)[N] | ((P)[(N)+1] << 8) | ((P)[(N)+2] << 16) | ((UInt32)(P)[(N)+3] << 24)))
+#define UBX_I4(P,N)     ((Int32)UBX_U4(P,N))
+
+/* NAV-PVT flags */
+#define PVT_VALID_DATE  0x01
+#define PVT_VALID_TIME  0x02
+#define PVT_GNSS_FIX_OK 0x01
+#define PVT_DIFF_SOLN   0x02
+
+// ----------------------------------------------------------------------------
+
+/* 8-bit Fletcher checksum over class, id, length and payload */
+static void _ubxChecksum(const UInt8 *data, int len, UInt8 *ckA, UInt8 *ckB)
+{
+    UInt8 a = 0, b = 0;
+    int i;
+    for (i = 0; i < len; i++) {
+        a += data[i];
+        b += a;
+    }
+    *ckA = a;
+    *ckB = b;
+}
+
+/* locate the next valid UBX frame in 'buf' */
+// Returns UBX_FRAME_OK with the frame at 'buf[*start]' ('*frameLen' bytes,
+// including sync and checksum).  Otherwise returns UBX_FRAME_NONE, and
+// '*start' is the offset of the first byte which should be kept for the
+// next call (the beginning of a partial frame, or 'len' if nothing is useful).
+// Frames with a bad checksum are skipped.
+int ubxNextFrame(const UInt8 *buf, int len, int *start, int *frameLen)
+{
+    int i = 0;
+    while (i < len) {
+        if (buf[i] != UBX_SYNC_1) {
+            i++;
+            continue;
+        }
+        if ((i + 1) >= len) {
+            break; // partial sync
+        }
+        if (buf[i + 1] != UBX_SYNC_2) {
+            i++;
+            continue;
+        }
+        if ((i + UBX_HEADER_SIZE) > len) {
+            break; // partial header
+        }
+        int plen = UBX_U2(buf, i + 4);
+        if (plen > UBX_MAX_PAYLOAD) {
+            i++;
+            continue;
+        }
+        if ((i + plen + UBX_OVERHEAD) > len) {
+            break; // partial frame
+        }
+        UInt8 ckA, ckB;
+        _ubxChecksum(&buf[i + 2], plen + 4, &ckA, &ckB);
+        if ((buf[i + UBX_HEADER_SIZE + plen] == ckA) && (buf[i + UBX_HEADER_SIZE + plen + 1] == ckB)) {
+            *start = i;
+            *frameLen = plen + UBX_OVERHEAD;
+            return UBX_FRAME_OK;
+        }
+        i++; // bad checksum
+    }
+    *start = i;
+    return UBX_FRAME_NONE;
+}
+
+/* build a UBX message into 'buf' */
+// Returns the message length, or -1 if 'buf' is too small
+int ubxBuildMessage(UInt8 *buf, int maxLen, UInt8 cls, UInt8 id, const UInt8 *payload, int payloadLen)
+{
+    if ((payloadLen + UBX_OVERHEAD) > maxLen) {
+        return -1;
+    }
+    buf[0] = UBX_SYNC_1;
+    buf[1] = UBX_SYNC_2;
+    buf[2] = cls;
+    buf[3] = id;
+    buf[4] = (UInt8)(payloadLen & 0xFF);
+    buf[5] = (UInt8)((payloadLen >> 8) & 0xFF);
+    if (payloadLen > 0) {
+        memcpy(&buf[UBX_HEADER_SIZE], payload, payloadLen);
+    }
+    _ubxChecksum(&buf[2], payloadLen + 4, &buf[UBX_HEADER_SIZE + payloadLen], &buf[UBX_HEADER_SIZE + payloadLen + 1]);
+    return payloadLen + UBX_OVERHEAD;
+}
+
+// ----------------------------------------------------------------------------
+
+/* decode a UBX-NAV-PVT payload into 'gps' */
+// Returns true if the payload holds a valid 2D/3D fix with valid date/time.
+// The fix time, position, altitude, speed, heading, PDOP and accuracy are
+// only updated for a valid fix.
+utBool ubxDecodeNavPVT(const UInt8 *payload, int len, GPS_t *gps)
+{
+    YMDHMS_t yh;
+
+    if (len < UBX_NAV_PVT_SIZE) {
+        return utFalse;
+    }
+    UInt8 valid   = payload[11];
+    UInt8 fixType = payload[20];
+    UInt8 flags   = payload[21];
+    if (((valid & (PVT_VALID_DATE | PVT_VALID_TIME)) != (PVT_VALID_DATE | PVT_VALID_TIME)) ||
+        !(flags & PVT_GNSS_FIX_OK) || (fixType < 2) || (fixType > 4)) {
+        // no fix (0), dead-reckoning only (1), or time only (5)
+        return utFalse;
+    }
+
+    memset(&yh, 0, sizeof(yh));
+    yh.wYear   = UBX_U2(payload, 4);
+    yh.wMonth  = payload[6];
+    yh.wDay    = payload[7];
+    yh.wHour   = payload[8];
+    yh.wMinute = payload[9];
+    yh.wSecond = payload[10];
+    gps->fixtime         = (time_t)utcYmdHmsToSeconds(&yh);
+    gps->point.longitude = (double)UBX_I4(payload, 24) / 10000000.0;
+    gps->point.latitude  = (double)UBX_I4(payload, 28) / 10000000.0;
+    gps->altitude        = (float)UBX_I4(payload, 36) / 1000.0;    // mm above MSL
+    gps->accuracy        = (float)UBX_U4(payload, 40) / 1000.0;    // mm
+    gps->speedKPH        = (float)UBX_I4(payload, 60) * 0.0036;    // mm/s
+    gps->heading         = (float)UBX_I4(payload, 64) / 100000.0;  // 1e-5 deg
+    gps->pdop            = (float)UBX_U2(payload, 76) / 100.0;
+    gps->fixtype         = (flags & PVT_DIFF_SOLN)? 2 : 1;
+    return utTrue;
+}
+
+/* decode a UBX-NAV-DOP payload into 'gps' */
+utBool ubxDecodeNavDOP(const UInt8 *payload, int len, GPS_t *gps)
+{
+    if (len < UBX_NAV_DOP_SIZE) {
+        return utFalse;
+    }
+    gps->pdop = (float)UBX_U2(payload, 6)  / 100.0;
+    gps->vdop = (float)UBX_U2(payload, 10) / 100.0;
+    gps->hdop = (float)UBX_U2(payload, 12) / 100.0;
+    return utTrue;
+}
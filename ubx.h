@@ -0,0 +1,55 @@
+// ----------------------------------------------------------------------------
+// Description:
+//  u-blox UBX binary protocol framing, message builder and navigation
+//  solution decoder.
+// ----------------------------------------------------------------------------
+
+#ifndef _UBX_H
+#define _UBX_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stdtypes.h"
+#include "gpstools.h"
+
+// ----------------------------------------------------------------------------
+
+/* frame layout: sync(2) class(1) id(1) length(2) payload(length) ck_a ck_b */
+#define UBX_SYNC_1                  0xB5
+#define UBX_SYNC_2                  0x62
+#define UBX_HEADER_SIZE             6
+#define UBX_OVERHEAD                (UBX_HEADER_SIZE + 2)
+#define UBX_MAX_PAYLOAD             256     // larger frames are skipped
+
+/* message classes/ids */
+#define UBX_CLASS_NAV               0x01
+#define UBX_CLASS_ACK               0x05
+#define UBX_CLASS_CFG               0x06
+#define UBX_NAV_DOP                 0x04
+#define UBX_NAV_PVT                 0x07
+#define UBX_CFG_PRT                 0x00
+#define UBX_CFG_MSG                 0x01
+#define UBX_CFG_RATE                0x08
+
+#define UBX_NAV_PVT_SIZE            92
+#define UBX_NAV_DOP_SIZE            18
+
+/* 'ubxNextFrame' return codes */
+#define UBX_FRAME_NONE              0       // no complete frame buffered
+#define UBX_FRAME_OK                1       // valid frame at '*start'
+
+// ----------------------------------------------------------------------------
+
+int ubxNextFrame(const UInt8 *buf, int len, int *start, int *frameLen);
+int ubxBuildMessage(UInt8 *buf, int maxLen, UInt8 cls, UInt8 id, const UInt8 *payload, int payloadLen);
+
+utBool ubxDecodeNavPVT(const UInt8 *payload, int len, GPS_t *gps);
+utBool ubxDecodeNavDOP(const UInt8 *payload, int len, GPS_t *gps);
+
+// ----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+}
+#endif
+#endif